@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+// Measures the time to locate and apply the hunks of a patch to a large file held in
+// memory, with each of the options which change how lines are compared or written:
+// none at all, -D, each --newline-output and -l.
+//
+// Usage: bench_apply_modes [number of hunks] [iterations]
+//
+// The patched file is written to a temporary file.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <patch/applier.h>
+#include <patch/file.h>
+#include <patch/hunk.h>
+#include <patch/line_buffer.h>
+#include <patch/options.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static std::string line_of_file(int64_t line_number, bool patched = false)
+{
+    return "line number " + std::to_string(line_number) + (patched ? " of the file which was patched" : " of the file being patched");
+}
+
+// A file with hunks every ten lines. A line which the patch does not know about is put before
+// every other hunk, so that half of them are found a line after where they are expected.
+static void generate_input(int number_of_hunks, std::string& content, Patch::Patch& patch)
+{
+    // The lines of the hunks refer to content kept by the patch, as they do when parsed.
+    patch.arena = std::make_shared<Patch::Arena>();
+    auto& arena = *patch.arena;
+
+    std::ostringstream file;
+    for (int64_t i = 0; i < number_of_hunks; ++i) {
+        if (i % 2)
+            file << "a line which is not in the patch\n";
+
+        const int64_t start = i * 10 + 1;
+        for (int64_t j = 0; j < 10; ++j)
+            file << line_of_file(start + j) << (j % 2 ? "\r\n" : "\n");
+
+        Patch::Hunk hunk;
+        hunk.old_file_range.start_line = start;
+        hunk.old_file_range.number_of_lines = 7;
+        hunk.new_file_range = hunk.old_file_range;
+        for (int64_t j = 0; j < 7; ++j) {
+            const auto newline = j % 2 ? Patch::NewLine::CRLF : Patch::NewLine::LF;
+            if (j == 3) {
+                hunk.lines.emplace_back('-', Patch::LineView(arena.copy(line_of_file(start + j)), newline));
+                hunk.lines.emplace_back('+', Patch::LineView(arena.copy(line_of_file(start + j, true)), newline));
+            } else {
+                hunk.lines.emplace_back(' ', Patch::LineView(arena.copy(line_of_file(start + j)), newline));
+            }
+        }
+        patch.hunks.push_back(std::move(hunk));
+    }
+
+    content = file.str();
+}
+
+static double apply_patch_ms(const Patch::LineBuffer& lines, const Patch::Patch& original_patch, const Patch::Options& options)
+{
+    auto patch = original_patch;
+    auto out_file = Patch::File::create_temporary();
+    Patch::RejectWriter reject_writer(patch);
+    std::ostringstream output;
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto result = Patch::apply_patch(out_file, reject_writer, lines, patch, options, output);
+    const auto end = std::chrono::steady_clock::now();
+
+    if (result.failed_hunks != 0)
+        throw std::runtime_error("Failed to apply patch: " + output.str());
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    const int number_of_hunks = argc > 1 ? std::atoi(argv[1]) : 200000;
+    const int iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    std::string content;
+    Patch::Patch patch(Patch::Format::Unified);
+    generate_input(number_of_hunks, content, patch);
+    const Patch::LineBuffer lines(std::move(content), true);
+
+    auto report = [&](const char* name, const Patch::Options& options) {
+        std::vector<double> times;
+        for (int i = 0; i < iterations; ++i)
+            times.push_back(apply_patch_ms(lines, patch, options));
+        std::sort(times.begin(), times.end());
+
+        std::cout << name << ": " << number_of_hunks << " hunks, "
+                  << "median " << times[times.size() / 2] << "ms, min " << times.front() << "ms\n";
+    };
+
+    Patch::Options options;
+    options.force = true;
+    report("plain", options);
+
+    Patch::Options define = options;
+    define.define_macro = "BENCH";
+    report("-D", define);
+
+    Patch::Options lf = options;
+    lf.newline_output = Patch::Options::NewlineOutput::LF;
+    report("--newline-output=lf", lf);
+
+    Patch::Options crlf = options;
+    crlf.newline_output = Patch::Options::NewlineOutput::CRLF;
+    report("--newline-output=crlf", crlf);
+
+    Patch::Options keep = options;
+    keep.newline_output = Patch::Options::NewlineOutput::Keep;
+    report("--newline-output=preserve", keep);
+
+    Patch::Options ignore_whitespace = options;
+    ignore_whitespace.ignore_whitespace = true;
+    report("-l", ignore_whitespace);
+
+    return 0;
+}
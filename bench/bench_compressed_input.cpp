@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+// Measures the end to end time of applying a large patch given as plain text, and
+// compressed with each of the formats supported by this build of patch.
+//
+// Usage: bench_compressed_input [number of hunks] [iterations]
+//
+// The compressed patches are created with the gzip, xz and zstd tools, which must be
+// found on the PATH. Files are written to the current working directory.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <patch/cmdline.h>
+#include <patch/compression.h>
+#include <patch/file.h>
+#include <patch/options.h>
+#include <patch/patch.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static void generate_input(int number_of_hunks)
+{
+    Patch::File file("bench.txt", std::ios_base::out | std::ios_base::trunc);
+    Patch::File patch("bench.diff", std::ios_base::out | std::ios_base::trunc);
+
+    patch << "--- a/bench.txt\n+++ b/bench.txt\n";
+    for (int64_t i = 0; i < number_of_hunks; ++i) {
+        const int64_t start = i * 10 + 1;
+        for (int64_t j = 0; j < 10; ++j)
+            file << "line number " << (start + j) << " of the file being patched\n";
+
+        patch << "@@ -" << start << ",7 +" << start << ",7 @@\n";
+        for (int64_t j = 0; j < 7; ++j) {
+            if (j == 3) {
+                patch << "-line number " << (start + j) << " of the file being patched\n";
+                patch << "+line number " << (start + j) << " of the file which was patched\n";
+            } else {
+                patch << " line number " << (start + j) << " of the file being patched\n";
+            }
+        }
+    }
+}
+
+static double apply_patch_ms(const std::string& patch_path, const std::string& original_content)
+{
+    {
+        Patch::File file("bench.txt", std::ios_base::out | std::ios_base::trunc);
+        file << original_content;
+    }
+
+    const char* args[] = { "patch", "-i", patch_path.c_str(), "bench.txt" };
+    Patch::OptionHandler handler;
+    Patch::CmdLine cmdline(4, args);
+    Patch::CmdLineParser cmdline_parser(cmdline);
+    cmdline_parser.parse(handler);
+    handler.apply_defaults();
+
+    // Discard the output of patch while it is being timed.
+    std::ostringstream output;
+    auto* cout_buffer = std::cout.rdbuf(output.rdbuf());
+
+    const auto start = std::chrono::steady_clock::now();
+    const int rc = Patch::process_patch(handler.options());
+    const auto end = std::chrono::steady_clock::now();
+
+    std::cout.rdbuf(cout_buffer);
+    if (rc != 0)
+        throw std::runtime_error("Failed to apply " + patch_path + ": " + output.str());
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    const int number_of_hunks = argc > 1 ? std::atoi(argv[1]) : 50000;
+    const int iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    generate_input(number_of_hunks);
+    const auto original_content = Patch::File("bench.txt", std::ios_base::in).read_all_as_string();
+
+    struct Input {
+        Patch::Compression compression;
+        const char* path;
+        const char* command;
+    };
+
+    const std::vector<Input> inputs {
+        { Patch::Compression::None, "bench.diff", nullptr },
+        { Patch::Compression::Gzip, "bench.diff.gz", "gzip -c bench.diff > bench.diff.gz" },
+        { Patch::Compression::Xz, "bench.diff.xz", "xz -c bench.diff > bench.diff.xz" },
+        { Patch::Compression::Zstd, "bench.diff.zst", "zstd -q -c bench.diff > bench.diff.zst" },
+    };
+
+    for (const auto& input : inputs) {
+        if (!Patch::supports_decompression(input.compression)) {
+            std::cout << Patch::to_string(input.compression) << ": not supported by this build\n";
+            continue;
+        }
+
+        if (input.command && std::system(input.command) != 0) {
+            std::cout << Patch::to_string(input.compression) << ": unable to compress patch\n";
+            continue;
+        }
+
+        std::vector<double> times;
+        for (int i = 0; i < iterations; ++i)
+            times.push_back(apply_patch_ms(input.path, original_content));
+        std::sort(times.begin(), times.end());
+
+        std::cout << Patch::to_string(input.compression) << ": " << number_of_hunks << " hunks, "
+                  << "median " << times[times.size() / 2] << "ms, min " << times.front() << "ms\n";
+    }
+
+    Patch::File file("bench.txt", std::ios_base::out | std::ios_base::trunc);
+    file << original_content;
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+// Measures the time to check whether a patch touching a large tree of files applies
+// with --dry-run, compared to actually applying it.
+//
+// Usage: bench_dry_run [number of files] [hunks per file] [iterations]
+//
+// Files are written to a directory named 'bench_tree' in the current working directory.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <patch/cmdline.h>
+#include <patch/file.h>
+#include <patch/options.h>
+#include <patch/patch.h>
+#include <patch/system.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static std::string file_path(int file)
+{
+    return "bench_tree/dir" + std::to_string(file % 16) + "/file" + std::to_string(file) + ".txt";
+}
+
+static void generate_tree(int number_of_files, int hunks_per_file)
+{
+    Patch::File patch("bench_tree.diff", std::ios_base::out | std::ios_base::trunc);
+
+    for (int f = 0; f < number_of_files; ++f) {
+        const auto path = file_path(f);
+        Patch::ensure_parent_directories(path);
+        Patch::File file(path, std::ios_base::out | std::ios_base::trunc);
+
+        patch << "--- a/" << path << "\n+++ b/" << path << "\n";
+        for (int64_t i = 0; i < hunks_per_file; ++i) {
+            const int64_t start = i * 10 + 1;
+            for (int64_t j = 0; j < 10; ++j)
+                file << "line number " << (start + j) << " of the file being patched\n";
+
+            patch << "@@ -" << start << ",7 +" << start << ",7 @@\n";
+            for (int64_t j = 0; j < 7; ++j) {
+                if (j == 3) {
+                    patch << "-line number " << (start + j) << " of the file being patched\n";
+                    patch << "+line number " << (start + j) << " of the file which was patched\n";
+                } else {
+                    patch << " line number " << (start + j) << " of the file being patched\n";
+                }
+            }
+        }
+    }
+}
+
+static double run_patch_ms(bool dry_run)
+{
+    std::vector<const char*> args { "patch", "-p1", "-i", "bench_tree.diff" };
+    if (dry_run)
+        args.push_back("--dry-run");
+
+    Patch::OptionHandler handler;
+    Patch::CmdLine cmdline(static_cast<int>(args.size()), args.data());
+    Patch::CmdLineParser cmdline_parser(cmdline);
+    cmdline_parser.parse(handler);
+    handler.apply_defaults();
+
+    // Discard the output of patch while it is being timed.
+    std::ostringstream output;
+    auto* cout_buffer = std::cout.rdbuf(output.rdbuf());
+
+    const auto start = std::chrono::steady_clock::now();
+    const int rc = Patch::process_patch(handler.options());
+    const auto end = std::chrono::steady_clock::now();
+
+    std::cout.rdbuf(cout_buffer);
+    if (rc != 0)
+        throw std::runtime_error("Failed to apply patch: " + output.str());
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    const int number_of_files = argc > 1 ? std::atoi(argv[1]) : 2000;
+    const int hunks_per_file = argc > 2 ? std::atoi(argv[2]) : 50;
+    const int iterations = argc > 3 ? std::atoi(argv[3]) : 5;
+
+    generate_tree(number_of_files, hunks_per_file);
+
+    auto report = [&](const char* name, bool dry_run) {
+        std::vector<double> times;
+        for (int i = 0; i < iterations; ++i) {
+            // A real run changes the tree, so the tree needs to be regenerated for each run.
+            if (!dry_run)
+                generate_tree(number_of_files, hunks_per_file);
+            times.push_back(run_patch_ms(dry_run));
+        }
+        std::sort(times.begin(), times.end());
+
+        std::cout << name << ": " << number_of_files << " files, " << hunks_per_file << " hunks each, "
+                  << "median " << times[times.size() / 2] << "ms, min " << times.front() << "ms\n";
+        return times[times.size() / 2];
+    };
+
+    const auto dry_run = report("dry run", true);
+    const auto apply = report("apply", false);
+    std::cout << "dry run speedup: " << apply / dry_run << "x\n";
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+// Measures the allocations made and time taken to parse a patch with many hunks, and then
+// to free it, for each of the formats whose hunks have lines.
+//
+// Usage: bench_parse_patch [number of hunks] [iterations]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <patch/file.h>
+#include <patch/hunk.h>
+#include <patch/parser.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static std::atomic<size_t> s_allocation_count { 0 };
+static std::atomic<size_t> s_free_count { 0 };
+
+void* operator new(std::size_t size)
+{
+    ++s_allocation_count;
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr)
+        ++s_free_count;
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    ::operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    ::operator delete(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    ::operator delete(ptr);
+}
+
+static std::string line_of_file(int64_t line_number, bool patched = false)
+{
+    return "line number " + std::to_string(line_number) + (patched ? " of the file which was patched" : " of the file being patched");
+}
+
+static std::string generate_unified(int number_of_hunks)
+{
+    std::ostringstream patch;
+    patch << "--- a/file.txt\n+++ b/file.txt\n";
+    for (int64_t i = 0; i < number_of_hunks; ++i) {
+        const int64_t start = i * 10 + 1;
+        patch << "@@ -" << start << ",7 +" << start << ",7 @@\n";
+        for (int64_t j = 0; j < 7; ++j) {
+            if (j == 3)
+                patch << '-' << line_of_file(start + j) << "\n+" << line_of_file(start + j, true) << '\n';
+            else
+                patch << ' ' << line_of_file(start + j) << '\n';
+        }
+    }
+    return patch.str();
+}
+
+static std::string generate_context(int number_of_hunks)
+{
+    std::ostringstream patch;
+    patch << "*** a/file.txt\n--- b/file.txt\n";
+    for (int64_t i = 0; i < number_of_hunks; ++i) {
+        const int64_t start = i * 10 + 1;
+        patch << "***************\n*** " << start << ',' << start + 6 << " ****\n";
+        for (int64_t j = 0; j < 7; ++j)
+            patch << (j == 3 ? "! " : "  ") << line_of_file(start + j) << '\n';
+        patch << "--- " << start << ',' << start + 6 << " ----\n";
+        for (int64_t j = 0; j < 7; ++j)
+            patch << (j == 3 ? "! " : "  ") << line_of_file(start + j, j == 3) << '\n';
+    }
+    return patch.str();
+}
+
+static std::string generate_normal(int number_of_hunks)
+{
+    std::ostringstream patch;
+    for (int64_t i = 0; i < number_of_hunks; ++i) {
+        const int64_t line = i * 10 + 4;
+        patch << line << 'c' << line << "\n< " << line_of_file(line) << "\n---\n> " << line_of_file(line, true) << '\n';
+    }
+    return patch.str();
+}
+
+struct Measurement {
+    size_t allocations;
+    size_t frees;
+    double parse_ms;
+    double free_ms;
+};
+
+static Measurement measure(const std::string& content, int number_of_hunks)
+{
+    Patch::File file = Patch::File::create_temporary_with_content(content);
+
+    Measurement measurement {};
+    std::unique_ptr<Patch::Patch> patch(new Patch::Patch);
+
+    const auto allocations = s_allocation_count.load();
+    auto start = std::chrono::steady_clock::now();
+    *patch = Patch::parse_patch(file);
+    auto end = std::chrono::steady_clock::now();
+    measurement.allocations = s_allocation_count.load() - allocations;
+    measurement.parse_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    if (patch->hunks.size() != static_cast<size_t>(number_of_hunks)) {
+        std::cerr << "Expected " << number_of_hunks << " hunks, parsed " << patch->hunks.size() << '\n';
+        std::exit(1);
+    }
+
+    const auto frees = s_free_count.load();
+    start = std::chrono::steady_clock::now();
+    patch.reset();
+    end = std::chrono::steady_clock::now();
+    measurement.frees = s_free_count.load() - frees;
+    measurement.free_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    return measurement;
+}
+
+int main(int argc, char** argv)
+{
+    const int number_of_hunks = argc > 1 ? std::atoi(argv[1]) : 100000;
+    const int iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    auto report = [&](const char* name, const std::string& content) {
+        std::vector<Measurement> measurements;
+        for (int i = 0; i < iterations; ++i)
+            measurements.push_back(measure(content, number_of_hunks));
+
+        std::sort(measurements.begin(), measurements.end(), [](const Measurement& a, const Measurement& b) { return a.parse_ms < b.parse_ms; });
+        const auto parse_ms = measurements[measurements.size() / 2].parse_ms;
+        std::sort(measurements.begin(), measurements.end(), [](const Measurement& a, const Measurement& b) { return a.free_ms < b.free_ms; });
+        const auto free_ms = measurements[measurements.size() / 2].free_ms;
+
+        std::cout << name << ": " << number_of_hunks << " hunks, " << measurements.front().allocations << " allocations, "
+                  << measurements.front().frees << " frees, parse median " << parse_ms << "ms, free median " << free_ms << "ms\n";
+    };
+
+    report("unified", generate_unified(number_of_hunks));
+    report("context", generate_context(number_of_hunks));
+    report("normal", generate_normal(number_of_hunks));
+
+    return 0;
+}
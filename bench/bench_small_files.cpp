@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+// Measures the time to write out many small files, as is done once patching has finished:
+// one at a time through File, on the write-behind threads, and in batches (with io_uring,
+// where supported).
+//
+// Usage: bench_small_files [number of files] [size of each file] [iterations]
+//
+// Files are written to a directory named 'bench_small_files' in the current working directory.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <patch/file.h>
+#include <patch/system.h>
+#include <patch/write_behind.h>
+#include <string>
+#include <vector>
+
+static std::string file_path(int file)
+{
+    return "bench_small_files/dir" + std::to_string(file % 16) + "/file" + std::to_string(file) + ".txt";
+}
+
+static void write_with_file(const std::vector<Patch::filesystem::FileContent>& files)
+{
+    for (const auto& content : files) {
+        Patch::File file(content.path, std::ios_base::out | std::ios_base::trunc);
+        file.write(content.content.data(), content.content.size());
+    }
+}
+
+static void write_behind(const std::vector<Patch::filesystem::FileContent>& files)
+{
+    Patch::WriteBehind write_behind(4);
+    for (const auto& content : files) {
+        const auto* file_content = &content;
+        write_behind.run(content.path, [file_content] {
+            Patch::File file(file_content->path, std::ios_base::out | std::ios_base::trunc);
+            file.write(file_content->content.data(), file_content->content.size());
+        });
+    }
+    write_behind.wait();
+}
+
+static void write_in_batches(const std::vector<Patch::filesystem::FileContent>& files)
+{
+    Patch::filesystem::write_files(files);
+}
+
+int main(int argc, char** argv)
+{
+    const int number_of_files = argc > 1 ? std::atoi(argv[1]) : 20000;
+    const int file_size = argc > 2 ? std::atoi(argv[2]) : 1024;
+    const int iterations = argc > 3 ? std::atoi(argv[3]) : 5;
+
+    const std::string content(static_cast<size_t>(file_size), 'x');
+    std::vector<Patch::filesystem::FileContent> files;
+    for (int i = 0; i < number_of_files; ++i) {
+        files.push_back({ file_path(i), content });
+        Patch::ensure_parent_directories(files.back().path);
+    }
+
+    // Check up front, so the batched times are not mistaken for those of io_uring.
+    if (!Patch::filesystem::write_files({}))
+        std::cout << "io_uring is not supported here, only writing one at a time\n";
+
+    auto report = [&](const char* name, const std::function<void(const std::vector<Patch::filesystem::FileContent>&)>& write) {
+        std::vector<double> times;
+        for (int i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            write(files);
+            const auto end = std::chrono::steady_clock::now();
+            times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        std::sort(times.begin(), times.end());
+
+        std::cout << name << ": " << number_of_files << " files of " << file_size << " bytes, "
+                  << "median " << times[times.size() / 2] << "ms, min " << times.front() << "ms\n";
+    };
+
+    report("one at a time", write_with_file);
+    report("write-behind", write_behind);
+    if (Patch::filesystem::write_files({}))
+        report("in batches", write_in_batches);
+
+    return 0;
+}
@@ -6,6 +6,7 @@
 #include <iostream>
 #include <istream>
 #include <patch/hunk.h>
+#include <patch/line_buffer.h>
 #include <patch/options.h>
 #include <vector>
 
@@ -17,11 +18,17 @@ class RejectWriter {
 public:
     explicit RejectWriter(const Patch& patch, File& reject_file, Options::RejectFormat reject_format = Options::RejectFormat::Default)
         : m_patch(patch)
-        , m_reject_file(reject_file)
+        , m_reject_file(&reject_file)
         , m_reject_format(reject_format)
     {
     }
 
+    // Only count the rejected hunks, without writing them anywhere.
+    explicit RejectWriter(const Patch& patch)
+        : m_patch(patch)
+    {
+    }
+
     void write_reject_file(const Hunk& hunk);
 
     int rejected_hunks() const { return m_rejected_hunks; }
@@ -31,7 +38,7 @@ private:
 
     const Patch& m_patch;
     int m_rejected_hunks { 0 };
-    File& m_reject_file;
+    File* m_reject_file { nullptr };
     Options::RejectFormat m_reject_format { Options::RejectFormat::Default };
 };
 
@@ -41,7 +48,31 @@ struct Result {
     bool all_hunks_applied_perfectly;
 };
 
-Result apply_patch(File& out_file, RejectWriter& reject_writer, const std::vector<Line>& input_lines, Patch& patch, const Options& options = {}, std::ostream& out = std::cout);
+// Whether the patched content of a file is used. For a dry run it is only needed to show
+// it on stdout, or to check whether a file being removed is left empty.
+bool needs_patched_output(const Patch& patch, const Options& options);
+
+// Locate and apply the hunks of the patch, writing the result to the given file. The out
+// file is not used if the patched output is not needed. The lines may either be a vector of
+// lines, or a LineBuffer.
+template<typename Lines>
+Result apply_patch(File& out_file, RejectWriter& reject_writer, const Lines& input_lines, Patch& patch, const Options& options = {}, std::ostream& out = std::cout);
+
+// As apply_patch, but reading the lines of the input file as they are needed rather than
+// holding the whole file, so that only up to around twice options.max_offset lines (which
+// must not be negative) are held at once. Unlike apply_patch, a hunk is never found before
+// the end of the hunk applied before it.
+Result apply_patch_streaming(File& out_file, RejectWriter& reject_writer, File& input_file, Patch& patch, const Options& options = {}, std::ostream& out = std::cout);
+
+// Write the result of running the commands of an ed script on the given lines. Throws if
+// any command refers to a line which is not in the file. Nothing is written if the patched
+// output is not needed.
+template<typename Lines>
+void apply_ed_script(File& out_file, const Lines& input_lines, const Patch& patch, const Options& options = {});
+
+// Write the content of a file which the patch creates as a whole, where every hunk only
+// adds lines.
+void write_added_lines(File& out_file, const Patch& patch, const Options& options = {});
 
 void reverse(Patch& patch);
 
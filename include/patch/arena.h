@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <patch/string_view.h>
+#include <type_traits>
+#include <vector>
+
+namespace Patch {
+
+// Memory for many small things which are all freed at once, such as the lines of the hunks of
+// a patch. Memory is handed out from a few large blocks in turn, and is only freed along with
+// the arena, a block at a time, rather than piece by piece.
+class Arena {
+public:
+    Arena() = default;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // The alignment can be no more than that of anything allocated with new.
+    void* allocate(size_t size, size_t alignment)
+    {
+        const size_t start = (m_used + alignment - 1) & ~(alignment - 1);
+        if (start > m_capacity || size > m_capacity - start)
+            return allocate_in_new_block(size, alignment);
+
+        m_used = start + size;
+        return m_block + start;
+    }
+
+    // A copy of the given content which lives as long as the arena does.
+    StringView copy(StringView content)
+    {
+        if (content.empty())
+            return {};
+
+        auto* characters = static_cast<char*>(allocate(content.size(), 1));
+        std::copy(content.begin(), content.end(), characters);
+        return { characters, content.size() };
+    }
+
+    size_t number_of_blocks() const { return m_blocks.size(); }
+
+private:
+    void* allocate_in_new_block(size_t size, size_t alignment);
+
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    char* m_block { nullptr };
+    size_t m_used { 0 };
+    size_t m_capacity { 0 };
+};
+
+// Allocates from an arena, so that a container using it does not need to be freed. Without
+// an arena, this allocates as std::allocator does.
+template<typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    // A container always uses the arena of the one it was copied or moved from, as that is
+    // where its elements refer to.
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    ArenaAllocator() = default;
+
+    explicit ArenaAllocator(Arena* arena)
+        : m_arena(arena)
+    {
+    }
+
+    template<typename U>
+    // NOLINTNEXTLINE(google-explicit-constructor)
+    ArenaAllocator(const ArenaAllocator<U>& other)
+        : m_arena(other.arena())
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        if (!m_arena)
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* pointer, size_t)
+    {
+        if (!m_arena)
+            ::operator delete(pointer);
+    }
+
+    Arena* arena() const { return m_arena; }
+
+    friend bool operator==(const ArenaAllocator& a, const ArenaAllocator& b)
+    {
+        return a.m_arena == b.m_arena;
+    }
+
+    friend bool operator!=(const ArenaAllocator& a, const ArenaAllocator& b)
+    {
+        return a.m_arena != b.m_arena;
+    }
+
+private:
+    Arena* m_arena { nullptr };
+};
+
+} // namespace Patch
@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#pragma once
+
+#include <patch/hunk.h>
+#include <patch/options.h>
+#include <patch/string_view.h>
+#include <string>
+
+namespace Patch {
+
+class File;
+
+// Whether this build of patch is able to apply git binary patches. Doing so requires zlib.
+bool supports_git_binary_patches();
+
+// Decode a single line of data from a git binary patch, appending the decoded bytes to the
+// output. Each line starts with a character giving the number of bytes encoded by the line,
+// followed by the data encoded in base85. Returns false if the line is malformed.
+bool decode_base85_line(StringView line, std::string& output);
+
+// Git's name for a blob with the given content (the SHA-1 of the content with a header).
+std::string git_object_id(StringView content);
+
+// Apply a git binary patch to the content of the file being patched, writing the result to
+// the output file. The hunk is decompressed and applied in chunks, so that neither the
+// decompressed literal nor delta is ever held in memory as a whole.
+//
+// Returns false if the patch does not apply to the given content.
+bool apply_git_binary_patch(File& out_file, StringView input, Patch& patch, const Options& options = {});
+
+} // namespace Patch
@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <patch/string_view.h>
+
+namespace Patch {
+
+class File;
+
+enum class Compression {
+    None,
+    Gzip,
+    Xz,
+    Zstd,
+};
+
+// Determine how some input has been compressed from the magic bytes at the start of it.
+Compression detect_compression(StringView magic);
+
+const char* to_string(Compression compression);
+
+// Whether this build of patch is able to decompress input of the given format.
+bool supports_decompression(Compression compression);
+
+// Reads the next chunk of input into the buffer, returning 0 at the end of the input.
+using InputReader = std::function<size_t(char* buffer, size_t size)>;
+
+// Write all of the input to the output file, decompressing it chunk by chunk as it is read.
+void decompress(Compression compression, const InputReader& read, File& output);
+
+} // namespace Patch
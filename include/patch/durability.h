@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Patch {
+
+class File;
+
+// Keeps track of what has been changed on disk while patching so that, for --durable,
+// it can all be flushed to disk together once everything has been written rather than
+// waiting for each file in turn.
+class DurableWrites {
+public:
+    explicit DurableWrites(bool enabled)
+        : m_enabled(enabled)
+    {
+    }
+
+    bool enabled() const { return m_enabled; }
+
+    // The content of the file at the given path has been written through the given file,
+    // which starts being written out to disk straight away.
+    void wrote(const std::string& path, File& file);
+
+    // The metadata of the file (e.g its permissions) has been changed.
+    void changed_metadata(const std::string& path);
+
+    // The path has been added, removed or renamed, so the directories containing it need
+    // to be written out.
+    void changed_entry(const std::string& path);
+
+    void renamed(const std::string& old_path, const std::string& new_path);
+
+    struct Summary {
+        size_t files { 0 };
+        size_t directories { 0 };
+        bool synced_filesystem { false };
+    };
+
+    // Wait for everything changed to be written out to disk.
+    Summary sync();
+
+private:
+    bool m_enabled;
+    std::mutex m_mutex;
+
+    // Whether the metadata needs to be written out as well as the content of each file.
+    std::unordered_map<std::string, bool> m_files;
+    std::unordered_set<std::string> m_directories;
+};
+
+} // namespace Patch
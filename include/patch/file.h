@@ -6,6 +6,7 @@
 #include <cinttypes>
 #include <cstdio>
 #include <ios>
+#include <patch/system.h>
 #include <system_error>
 
 namespace Patch {
@@ -57,12 +58,30 @@ public:
         return *this;
     }
 
+    void write(const char* content, size_t size)
+    {
+        fwrite(content, size, m_file);
+    }
+
+    size_t read(char* buffer, size_t size);
+
+    void rewind();
+
+    // A file for one of the standard streams of the process (such as stdin), which is left
+    // open once the file is closed.
+    static File standard_stream(FILE* stream, std::ios_base::openmode mode);
+
     static File create_temporary();
 
     static File create_temporary(FILE* initial_content);
 
     static File create_temporary_with_content(const std::string& initial_content);
 
+#ifndef _WIN32
+    // A file to read the given (non-empty) content from, which must outlive the file.
+    static File from_memory(const char* content, size_t size);
+#endif
+
     static void touch(const std::string& name)
     {
         File file(name, std::ios_base::out);
@@ -75,6 +94,10 @@ public:
         write_entire_contents_to(file.m_file);
     }
 
+    // As write_entire_contents_to, for a file which has only just been opened to write to,
+    // letting the kernel copy the content without reading it in where it is able to.
+    void copy_entire_contents_to(File& file);
+
     bool get_line(std::string& line, NewLine* newline = nullptr);
 
     bool open(const std::string& path, std::ios_base::openmode mode);
@@ -83,6 +106,11 @@ public:
 
     void seekg(const fpos_t& pos);
 
+    // The position in the file as the number of bytes from the start of it.
+    int64_t offset();
+
+    void seek_to_offset(int64_t offset);
+
     void clear()
     {
         m_is_eof = false;
@@ -112,6 +140,15 @@ public:
 
     uintmax_t size();
 
+    // The status of the open file, without looking up its path again.
+    filesystem::Status status();
+
+    // Flush anything written and start writing it to disk, without waiting for that to finish.
+    void start_writeback();
+
+    // Whether all of the content of the file is in memory, see filesystem::is_in_memory().
+    bool is_in_memory();
+
 private:
     static FILE* cfile_open_impl(const std::string& path, std::ios_base::openmode mode);
 
@@ -131,6 +168,12 @@ private:
     FILE* m_file { nullptr };
     bool m_is_bad { false };
     bool m_is_eof { false };
+
+#ifndef _WIN32
+    // Buffer which lines are read into by getline(3) before being copied to the caller.
+    char* m_line_buffer { nullptr };
+    size_t m_line_buffer_size { 0 };
+#endif
 };
 
 } // namespace Patch
@@ -3,9 +3,12 @@
 
 #pragma once
 
+#include <patch/arena.h>
 #include <patch/file.h>
+#include <patch/string_view.h>
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -46,39 +49,77 @@ struct Line {
     NewLine newline { NewLine::LF };
 };
 
-struct PatchLine {
-    PatchLine(char op, const Line& l)
-        : operation(op)
-        , line(l)
+// A line which refers to content held elsewhere, such as in a LineBuffer.
+struct LineView {
+    LineView() = default;
+
+    LineView(StringView content_, NewLine newline_)
+        : content(content_)
+        , newline(newline_)
     {
     }
 
-    PatchLine(char op, Line&& l)
-        : operation(op)
-        , line(std::move(l))
+    // NOLINTNEXTLINE(google-explicit-constructor)
+    LineView(const Line& line)
+        : content(line.content)
+        , newline(line.newline)
     {
     }
 
-    PatchLine(char op, const std::string& l)
+    StringView content;
+    NewLine newline { NewLine::LF };
+};
+
+// A line of a hunk. The content of the line is not held by the line itself, but (for a parsed
+// patch) by the arena of the patch that the hunk is a part of.
+struct PatchLine {
+    PatchLine(char op, LineView l)
         : operation(op)
-        , line(l, NewLine::LF)
+        , line(l)
     {
     }
 
-    PatchLine(char op, std::string&& l)
+    PatchLine(char op, StringView content)
         : operation(op)
-        , line(std::move(l), NewLine::LF)
+        , line(content, NewLine::LF)
     {
     }
 
+    // The line would refer to content which is about to go away.
+    PatchLine(char op, Line&& l) = delete;
+
     char operation;
-    Line line;
+    LineView line;
 };
 
+using PatchLines = std::vector<PatchLine, ArenaAllocator<PatchLine>>;
+
 struct Hunk {
     Range old_file_range;
     Range new_file_range;
-    std::vector<PatchLine> lines;
+    PatchLines lines;
+};
+
+// A command of an ed script, acting on the lines from the start to the end line (inclusive).
+// Text is only given for the 'a' (append), 'c' (change) and 'i' (insert) commands.
+struct EdCommand {
+    char command { 'a' };
+    LineNumber start_line { 0 };
+    LineNumber end_line { 0 };
+    std::vector<Line> lines;
+};
+
+// A hunk of a git binary patch. The data is kept compressed as it is given in the
+// patch, and is only inflated when it is applied.
+struct BinaryHunk {
+    enum class Type {
+        Literal,
+        Delta,
+    };
+
+    Type type { Type::Literal };
+    uint64_t size { 0 }; // Of the data once inflated.
+    std::string data;
 };
 
 enum class Operation {
@@ -87,7 +128,6 @@ enum class Operation {
     Copy,
     Delete,
     Add,
-    Binary,
 };
 
 struct Patch {
@@ -107,16 +147,31 @@ struct Patch {
     std::string old_file_path;
     std::string new_file_path;
 
-    // NOTE: We currently do not do anything with this timestamp (yet). However,
-    //       we still keep this information for use in reject file output. In
-    //       the future we should parse this information as a proper timestamp.
+    // Kept as written for use in reject file output, see parse_timestamp() for
+    // the time which they give.
     std::string old_file_time;
     std::string new_file_time;
 
     uint16_t old_file_mode { 0 };
     uint16_t new_file_mode { 0 };
 
+    // The (possibly abbreviated) ids of the old and new file given in a git index line.
+    std::string old_object_id;
+    std::string new_object_id;
+
     std::vector<Hunk> hunks;
+
+    // Where the lines of the hunks and their content are kept, so that they are freed all at
+    // once along with the patch. This is shared between copies of the patch, as the lines of
+    // their hunks refer to it.
+    std::shared_ptr<Arena> arena;
+
+    // The commands of an ed script, in the order given by the script.
+    std::vector<EdCommand> ed_commands;
+
+    // A git binary patch has a hunk to apply the change, optionally followed by a hunk to reverse it.
+    bool is_git_binary { false };
+    std::vector<BinaryHunk> binary_hunks;
 };
 
 } // namespace Patch
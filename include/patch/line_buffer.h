@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <patch/hunk.h>
+#include <patch/string_view.h>
+#include <string>
+#include <vector>
+
+namespace Patch {
+
+// The lines of a file, kept compactly as the content of the file in one buffer along with
+// where each line starts and what newline it ends with. This takes a handful of bytes per
+// line rather than a string each, and keeps lines next to each other in memory so that
+// they are quick to search through.
+//
+// A hash of the content of each line can also be kept, which lets lines be compared with
+// one another without looking at their content in most cases.
+class LineBuffer {
+public:
+    LineBuffer() = default;
+
+    explicit LineBuffer(std::string content, bool with_hashes = false);
+
+    size_t size() const { return m_newlines.size(); }
+    bool empty() const { return m_newlines.empty(); }
+
+    LineView operator[](size_t index) const
+    {
+        const auto newline = static_cast<NewLine>(m_newlines[index]);
+        const auto start = offset(index);
+        const auto length = offset(index + 1) - start - newline_size(newline);
+        return { StringView(m_content.data() + start, length), newline };
+    }
+
+    // As operator[], but throws if there is no such line.
+    LineView at(size_t index) const;
+
+    bool has_hashes() const { return m_has_hashes; }
+
+    uint32_t hash(size_t index) const { return m_hashes[index]; }
+
+    static uint32_t hash(StringView content);
+
+    // Everything in the buffer, exactly as it was given.
+    const std::string& content() const { return m_content; }
+
+    // The content of the given lines along with their newlines, exactly as they were given.
+    StringView content_of(size_t start, size_t count) const
+    {
+        const auto begin = offset(start);
+        return { m_content.data() + begin, offset(start + count) - begin };
+    }
+
+    // Whether any line ends with the given newline.
+    bool has_newline(NewLine newline) const { return m_newline_kinds & (1u << static_cast<unsigned>(newline)); }
+
+private:
+    static size_t newline_size(NewLine newline)
+    {
+        return newline == NewLine::CRLF ? 2 : newline == NewLine::LF ? 1 : 0;
+    }
+
+    // Where each line starts, and where the last one ends. Files of less than 4GiB (which
+    // is nearly all of them) only need half the space for each.
+    size_t offset(size_t index) const
+    {
+        return m_offsets.empty() ? static_cast<size_t>(m_wide_offsets[index]) : m_offsets[index];
+    }
+
+    std::string m_content;
+    std::vector<uint32_t> m_offsets;
+    std::vector<uint64_t> m_wide_offsets;
+
+    // The NewLine of each line, and a bit for each kind of NewLine found.
+    std::vector<uint8_t> m_newlines;
+    unsigned m_newline_kinds { 0 };
+
+    bool m_has_hashes { false };
+    std::vector<uint32_t> m_hashes;
+};
+
+} // namespace Patch
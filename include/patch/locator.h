@@ -5,7 +5,9 @@
 
 #include <cstdint>
 #include <patch/hunk.h>
+#include <patch/line_buffer.h>
 #include <patch/patch.h>
+#include <patch/string_view.h>
 #include <string>
 #include <vector>
 
@@ -31,14 +33,22 @@ struct Location {
 
 LineNumber expected_line_number(const Hunk& hunk);
 
-Location locate_hunk(const std::vector<Line>& content, const Hunk& hunk, bool ignore_whitespace = false, LineNumber offset = 0, LineNumber max_fuzz = 2);
+// Find where the hunk applies to the content, searching outwards from where the hunk says it
+// should be (moved by the given offset). A hunk is not looked for more than max_offset lines
+// away from there, unless max_offset is negative.
+//
+// The content may either be a vector of lines, or a LineBuffer. Where a LineBuffer has the
+// hash of each line, lines are only compared with those of the hunk with the same hash.
+template<typename Lines>
+Location locate_hunk(const Lines& content, const Hunk& hunk, bool ignore_whitespace = false, LineNumber offset = 0, LineNumber max_fuzz = 2, LineNumber max_offset = -1);
 
-bool matches_ignoring_whitespace(const std::string& as, const std::string& bs);
+bool matches_ignoring_whitespace(StringView as, StringView bs);
 
-bool matches(const Line& line1, const Line& line2, bool ignore_whitespace);
+bool matches(LineView line1, LineView line2, bool ignore_whitespace);
 
-bool has_prerequisite(const std::vector<Line>& lines, const std::string& prerequisite);
+template<typename Lines>
+bool has_prerequisite(const Lines& lines, const std::string& prerequisite);
 
-bool has_prerequisite(const Line& line, const std::string& prerequisite);
+bool has_prerequisite(LineView line, const std::string& prerequisite);
 
 } // namespace Patch
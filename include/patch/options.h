@@ -34,6 +34,12 @@ struct Options {
         No,
     };
 
+    enum class SetTime {
+        Never,
+        Local,
+        UTC,
+    };
+
     enum class QuotingStyle {
         Unset,
         Literal,
@@ -76,6 +82,13 @@ struct Options {
     QuotingStyle quoting_style { QuotingStyle::Unset };
     std::string backup_suffix;
     std::string backup_prefix;
+    int jobs { 1 };
+    bool show_stats { false };
+    bool durable { false };
+    bool skip_unchanged { false };
+    SetTime set_time { SetTime::Never };
+    int max_offset { -1 };
+    bool filter { false };
 };
 
 class OptionHandler : public CmdLineParser::Handler {
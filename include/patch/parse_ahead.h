@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <patch/hunk.h>
+#include <patch/parser.h>
+#include <patch/thread_pool.h>
+#include <string>
+#include <vector>
+
+namespace Patch {
+
+class File;
+
+// Parses the patches in a patch file on a few threads, ahead of them being needed. The patch
+// file is split up wherever a patch looks like it starts, and each of those is parsed with a
+// parser of its own from there onwards, just as it would be if everything before it had been
+// parsed first. Where a patch really starts is only known once the one before it has been
+// parsed, so the parser only takes what was parsed ahead from a place it reaches itself.
+class ParseAhead {
+public:
+    // Parse everything in the file from where it is now, which is at the given line.
+    ParseAhead(File& file, size_t line_number, Format format, int strip, size_t number_of_threads);
+
+    // Discards anything which is still waiting to be parsed.
+    ~ParseAhead();
+
+    ParseAhead(const ParseAhead&) = delete;
+    ParseAhead& operator=(const ParseAhead&) = delete;
+
+    // A patch parsed starting from a place in the patch file. The header or body of the patch
+    // can not be used if parsing it failed or reached the end of the file, as how the parser
+    // is left after either is not known.
+    struct Parsed {
+        Patch patch;
+        PatchHeaderInfo info;
+        bool should_parse_body { false };
+
+        bool has_header { false };
+        int64_t header_end { 0 };
+        size_t header_end_line_number { 0 };
+
+        bool has_body { false };
+        int64_t body_end { 0 };
+        size_t body_end_line_number { 0 };
+    };
+
+    // Take the patch parsed from the given place in the patch file, if one was.
+    bool take(int64_t offset, size_t line_number, Format format, int strip, Parsed& parsed);
+
+private:
+    struct Start {
+        int64_t offset;
+        size_t line_number;
+    };
+
+    static std::vector<Start> find_starts(const std::string& content, size_t first_line_number);
+
+    Parsed parse(const Start& start) const;
+
+    void parse_more();
+
+    // Where the content starts in the patch file, which the offsets of the starts are from.
+    int64_t m_offset;
+    std::string m_content;
+    std::vector<Start> m_starts;
+    Format m_format;
+    int m_strip;
+
+    // What has been given to be parsed for the starts following those already taken.
+    size_t m_next_start { 0 };
+    std::deque<std::future<Parsed>> m_parsing;
+    size_t m_max_parsing;
+
+    ThreadPool m_pool;
+};
+
+} // namespace Patch
@@ -5,8 +5,10 @@
 
 #include <cstdint>
 #include <istream>
+#include <memory>
 #include <patch/file.h>
 #include <patch/hunk.h>
+#include <patch/string_view.h>
 #include <string>
 #include <vector>
 
@@ -18,13 +20,45 @@ struct PatchHeaderInfo {
     Format format { Format::Unknown };
 };
 
+// Where the body of a patch is in the patch file.
+struct PatchBodyRange {
+    fpos_t start {};
+    fpos_t end {};
+    size_t start_line_number { 0 };
+    size_t end_line_number { 0 };
+};
+
+class ParseAhead;
+
 class Parser {
 public:
-    explicit Parser(File& file);
+    // A parser for the patches in the file from where it is now, which is at the given line.
+    explicit Parser(File& file, size_t line_number = 1);
+
+    ~Parser();
+
+    Parser(const Parser&) = delete;
+    Parser& operator=(const Parser&) = delete;
+
+    // Parse the patches in the rest of the file on the given number of threads ahead of them
+    // being needed, rather than one after another as they are needed. Which patches are found
+    // and any errors in them are just as they would be otherwise. What is parsed ahead is only
+    // used if the patches are then parsed with the given format and strip.
+    void parse_ahead(Format format, int strip, size_t number_of_threads);
 
     bool parse_patch_header(Patch& patch, PatchHeaderInfo& header_info, int strip = -1);
     void parse_patch_body(Patch& patch);
 
+    // Advance past the body of the patch, only counting its lines rather than parsing
+    // them. This is much cheaper than parsing the body for patches which are not going
+    // to be applied, but still finds each of the hunks and their ranges. Where the body
+    // is in the patch is returned so that its lines can be parsed should they be needed.
+    PatchBodyRange skip_patch_body(Patch& patch);
+
+    // Parse the lines of a patch whose body was skipped, going back to where the parser
+    // was afterwards.
+    void parse_skipped_patch_body(Patch& patch, const PatchBodyRange& body);
+
     size_t line_number() const { return m_line_number; }
 
     void print_header_info(const PatchHeaderInfo& header_info, std::ostream& out);
@@ -33,21 +67,55 @@ public:
 
 private:
     bool get_line(std::string& line, NewLine* newline = nullptr);
-
-    Patch parse_context_patch(Patch& patch);
-    Patch parse_unified_patch(Patch& patch);
-    Patch parse_normal_patch(Patch& patch);
-    void parse_context_hunk(std::vector<PatchLine>& old_lines, LineNumber& old_start_line, std::vector<PatchLine>& new_lines, LineNumber& new_start_line);
+    static LineView patch_line_content(Arena& arena, const std::string& line, size_t prefix_length, NewLine newline);
+
+    void parse_context_patch(Patch& patch);
+    void parse_unified_patch(Patch& patch);
+    void parse_normal_patch(Patch& patch);
+    void parse_git_binary_patch(Patch& patch);
+    void parse_ed_patch(Patch& patch);
+
+    // The old or new part of a context hunk. Only the number of lines (and how many of
+    // them are changes) is kept when skipping over the body of a patch.
+    struct ContextHunkPart {
+        PatchLines lines;
+        LineNumber start_line { 0 };
+        size_t number_of_lines { 0 };
+        size_t number_of_changes { 0 };
+
+        // Ready the part for the next hunk, keeping the room for its lines.
+        void clear()
+        {
+            lines.clear();
+            start_line = 0;
+            number_of_lines = 0;
+            number_of_changes = 0;
+        }
+    };
+
+    // The given line is only read into, so that its room is kept from one hunk to the next.
+    void parse_context_hunk(ContextHunkPart& old_part, ContextHunkPart& new_part, Arena& arena, std::string& line);
+
+    bool take_parsed_header(Patch& patch, PatchHeaderInfo& header_info, int strip, bool& should_parse_body);
 
     size_t m_line_number { 1 };
+    bool m_skip_line_content { false };
     File& m_file;
+
+    std::unique_ptr<ParseAhead> m_parse_ahead;
+
+    // Where the body of the patch whose header was last taken from m_parse_ahead ends, if it
+    // was parsed ahead too.
+    bool m_has_parsed_body { false };
+    int64_t m_parsed_body_end { 0 };
+    size_t m_parsed_body_end_line_number { 0 };
 };
 
 class LineParser {
 public:
-    explicit LineParser(const std::string& line)
-        : m_current(line.cbegin())
-        , m_end(line.cend())
+    explicit LineParser(StringView line)
+        : m_current(line.begin())
+        , m_end(line.end())
     {
     }
 
@@ -73,19 +141,22 @@ public:
 
     bool parse_git_extended_info(Patch& patch, int strip);
 
+    StringView remaining() const { return { m_current, m_end }; }
+
 private:
-    std::string::const_iterator m_current;
-    std::string::const_iterator m_end;
+    const char* m_current;
+    const char* m_end;
 };
 
 Patch parse_patch(File& file, Format format = Format::Unknown, int strip = -1);
 
-bool parse_unified_range(Hunk& hunk, const std::string& line);
-bool parse_normal_range(Hunk& hunk, const std::string& line);
+bool parse_unified_range(Hunk& hunk, StringView line);
+bool parse_normal_range(Hunk& hunk, StringView line);
+bool parse_ed_command(EdCommand& command, StringView line);
 
-std::string strip_path(const std::string& path, int amount);
+std::string strip_path(StringView path, int amount);
 std::string parse_path(const std::string& input, int strip);
 
-bool string_to_line_number(const std::string& str, LineNumber& output);
+bool string_to_line_number(StringView str, LineNumber& output);
 
 } // namespace Patch
@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <patch/hunk.h>
+#include <patch/line_buffer.h>
+#include <vector>
+
+namespace Patch {
+
+// The lines of a file as it is being changed, made up of runs of lines either from the
+// original file or added to it. Lines are never copied into the table: lines from the
+// original file are referred to by their position, and added lines by a view of them,
+// so added lines must outlive the table unless they are given to it to own.
+//
+// The original lines may be held either as a vector of lines, or as a LineBuffer.
+template<typename Lines>
+class BasicPieceTable {
+public:
+    struct Piece {
+        bool is_original;
+        size_t start;
+        size_t count;
+    };
+
+    // A replacement of the lines from 'start' up to 'end'.
+    struct Edit {
+        size_t start;
+        size_t end;
+        std::vector<Piece> replacement;
+    };
+
+    explicit BasicPieceTable(const Lines& original);
+
+    // The number of lines currently in the table.
+    size_t size() const { return m_size; }
+
+    // Add lines to a list of pieces to be used as the replacement for some lines.
+    void append_original(std::vector<Piece>& pieces, size_t line) const;
+    void append_added(std::vector<Piece>& pieces, LineView line);
+    void append_added(std::vector<Piece>& pieces, const Line& line);
+    void append_added(std::vector<Piece>& pieces, Line&& line);
+
+    // Replace 'count' lines starting from 'start' (as currently numbered) with the given
+    // pieces. Throws if the lines are past the end of the table.
+    void replace(size_t start, size_t count, const std::vector<Piece>& replacement);
+
+    // Apply a list of edits which all refer to the lines as currently numbered, in order
+    // of the lines they change rather than the order they were made, in a single pass
+    // over the table. Where an edit overlaps the lines changed by an edit before it,
+    // only the lines past that edit are replaced.
+    void apply(std::vector<Edit>& edits);
+
+    // Call the given function for every line in order, from the start of the table to the end.
+    template<typename Function>
+    void for_each_line(Function function) const
+    {
+        for_each_line(m_pieces, function);
+    }
+
+    // Call the given function for every line of the given pieces, such as those of an edit
+    // which has not been applied to the table.
+    template<typename Function>
+    void for_each_line(const std::vector<Piece>& pieces, Function function) const
+    {
+        for (const auto& piece : pieces) {
+            for (size_t i = piece.start; i < piece.start + piece.count; ++i) {
+                if (piece.is_original)
+                    function(m_original[i]);
+                else
+                    function(m_added[i]);
+            }
+        }
+    }
+
+    // Call original(start, count) for each run of lines from the original file, and added(line)
+    // for each added line, in order from the start of the table to the end.
+    template<typename Original, typename Added>
+    void for_each_run(Original original, Added added) const
+    {
+        for (const auto& piece : m_pieces) {
+            if (piece.is_original) {
+                original(piece.start, piece.count);
+                continue;
+            }
+
+            for (size_t i = piece.start; i < piece.start + piece.count; ++i)
+                added(m_added[i]);
+        }
+    }
+
+private:
+    static void append(std::vector<Piece>& pieces, const Piece& piece);
+
+    // Split the pieces so that one starts at the given line, returning its index.
+    size_t split_at(size_t line);
+
+    const Lines& m_original;
+    std::vector<LineView> m_added;
+    std::deque<Line> m_owned;
+
+    std::vector<Piece> m_pieces;
+    size_t m_size { 0 };
+};
+
+using PieceTable = BasicPieceTable<std::vector<Line>>;
+
+extern template class BasicPieceTable<std::vector<Line>>;
+extern template class BasicPieceTable<LineBuffer>;
+
+} // namespace Patch
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Patch {
+
+// A bounded queue between exactly one producer thread and one consumer thread.
+//
+// Pushing and popping only touch the atomic indices while the queue is neither full nor
+// empty. A thread only blocks (and takes the mutex) when it has to wait for the other.
+template<typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity)
+        : m_slots(capacity + 1)
+    {
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    void push(T value)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        const size_t next = increment(tail);
+
+        if (next == m_head.load(std::memory_order_acquire))
+            wait_for([&] { return next != m_head.load(); });
+
+        m_slots[tail] = std::move(value);
+        m_tail.store(next);
+        wake_waiter();
+    }
+
+    T pop()
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+
+        if (head == m_tail.load(std::memory_order_acquire))
+            wait_for([&] { return head != m_tail.load(); });
+
+        T value = std::move(m_slots[head]);
+        m_head.store(increment(head));
+        wake_waiter();
+        return value;
+    }
+
+private:
+    size_t increment(size_t index) const { return index + 1 == m_slots.size() ? 0 : index + 1; }
+
+    template<typename Predicate>
+    void wait_for(Predicate predicate)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        // The other side checks for a waiter after updating its index (both sequentially
+        // consistent), so either it sees that there is a waiter here, or the predicate
+        // sees the updated index. Both sides may briefly be waiting at once (one having
+        // been woken but not yet returned), so waiters are counted rather than flagged.
+        ++m_waiters;
+        m_condition.wait(lock, predicate);
+        --m_waiters;
+    }
+
+    void wake_waiter()
+    {
+        if (m_waiters.load() == 0)
+            return;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_condition.notify_all();
+    }
+
+    std::vector<T> m_slots;
+    std::atomic<size_t> m_head { 0 };
+    std::atomic<size_t> m_tail { 0 };
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::atomic<int> m_waiters { 0 };
+};
+
+} // namespace Patch
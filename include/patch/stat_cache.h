@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#pragma once
+
+#include <mutex>
+#include <patch/system.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Patch {
+
+// The status of the paths used while patching, looked up at most once each for a run of
+// patch. Anything patch changes on the filesystem must either be done through here or
+// be reported with invalidate() so that nothing out of date is returned.
+class StatCache {
+public:
+    bool exists(const std::string& path) { return status(path).exists; }
+    bool is_regular_file(const std::string& path) { return status(path).is_regular_file; }
+    filesystem::perms get_permissions(const std::string& path) { return status(path).permissions; }
+
+    // Remember the status of a file which has been opened from the given path.
+    void update(const std::string& path, const filesystem::Status& status);
+
+    // Forget about a path which has been changed.
+    void invalidate(const std::string& path);
+
+    // As Patch::ensure_parent_directories, but without trying to create any directory
+    // which has already been created or seen to exist.
+    void ensure_parent_directories(const std::string& file_path);
+
+    // As Patch::remove_file_and_empty_parent_folders, forgetting about the file and its
+    // parent directories.
+    void remove_file_and_empty_parent_folders(const std::string& path);
+
+    // As Patch::remove_empty_parent_folders, forgetting about the parent directories.
+    void remove_empty_parent_folders(const std::string& path);
+
+    void rename(const std::string& old_path, const std::string& new_path);
+
+    void permissions(const std::string& path, filesystem::perms permissions);
+
+private:
+    filesystem::Status status(const std::string& path);
+    void forget_parent_directories(const std::string& path);
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, filesystem::Status> m_statuses;
+    std::unordered_set<std::string> m_directories;
+};
+
+} // namespace Patch
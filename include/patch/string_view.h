@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace Patch {
+
+// A non-owning view over a sequence of characters. This is a (much) reduced version
+// of C++17's std::string_view, which we cannot use as we still support C++11.
+class StringView {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    StringView() = default;
+
+    StringView(const char* characters, size_t length)
+        : m_characters(characters)
+        , m_length(length)
+    {
+    }
+
+    StringView(const char* begin, const char* end)
+        : m_characters(begin)
+        , m_length(static_cast<size_t>(end - begin))
+    {
+    }
+
+    // NOLINTNEXTLINE(google-explicit-constructor)
+    StringView(const char* cstring)
+        : m_characters(cstring)
+        , m_length(std::strlen(cstring))
+    {
+    }
+
+    // NOLINTNEXTLINE(google-explicit-constructor)
+    StringView(const std::string& string)
+        : m_characters(string.data())
+        , m_length(string.size())
+    {
+    }
+
+    const char* data() const { return m_characters; }
+    size_t size() const { return m_length; }
+    bool empty() const { return m_length == 0; }
+
+    const char* begin() const { return m_characters; }
+    const char* end() const { return m_characters + m_length; }
+
+    char operator[](size_t index) const { return m_characters[index]; }
+
+    StringView substr(size_t start, size_t length = npos) const
+    {
+        if (start > m_length)
+            start = m_length;
+        return { m_characters + start, std::min(length, m_length - start) };
+    }
+
+    bool starts_with(StringView prefix) const
+    {
+        return m_length >= prefix.m_length && std::equal(prefix.begin(), prefix.end(), begin());
+    }
+
+    bool ends_with(StringView suffix) const
+    {
+        return m_length >= suffix.m_length && std::equal(suffix.begin(), suffix.end(), end() - suffix.m_length);
+    }
+
+    std::string to_string() const { return { m_characters, m_length }; }
+
+    friend bool operator==(StringView a, StringView b)
+    {
+        return a.m_length == b.m_length && std::equal(a.begin(), a.end(), b.begin());
+    }
+
+    friend bool operator!=(StringView a, StringView b)
+    {
+        return !(a == b);
+    }
+
+private:
+    const char* m_characters { "" };
+    size_t m_length { 0 };
+};
+
+} // namespace Patch
@@ -5,6 +5,7 @@
 
 #include <cstdint>
 #include <cstdio>
+#include <patch/string_view.h>
 #include <string>
 #include <vector>
 
@@ -12,14 +13,27 @@ namespace Patch {
 
 FILE* create_temporary_file();
 
+// Open another file for what the given file refers to, with the given fopen mode. Closing
+// one of the files leaves the other open.
+FILE* duplicate_file(FILE* file, const std::string& mode);
+
 std::string read_tty_until_enter();
 
 void chdir(const std::string& path);
 
+// Look up relative paths given to the functions here (and to File) from the given directory
+// rather than the current working directory, without changing the working directory of the
+// process. An empty path goes back to using the current working directory. Either way, any
+// directories which were looked up from the previous base directory are forgotten.
+void set_base_directory(const std::string& path);
+
 std::string current_path();
 
 void remove_file_and_empty_parent_folders(std::string path);
 
+// Remove each directory leading up to the given path which has been left empty.
+void remove_empty_parent_folders(std::string path);
+
 void ensure_parent_directories(const std::string& file_path);
 
 namespace filesystem {
@@ -113,8 +127,87 @@ void permissions(const std::string& path, perms permissions);
 
 perms get_permissions(const std::string& path);
 
+// As std::fopen, but looking up relative paths from the base directory.
+FILE* fopen(const std::string& path, const std::string& mode);
+
 uintmax_t file_size(FILE* file);
 
+// Copy the entire content of one file to another, both of which must have only just been
+// opened, leaving them at unspecified positions. Returns false without having copied anything
+// if this can not be done any quicker than reading and writing the content through stdio.
+bool copy_file_contents(FILE* from, FILE* to);
+
+// Start writing out what has been written to the file to disk, without waiting for it.
+void start_writeback(FILE* file);
+
+// Start reading the content of the regular file at the given path into memory, without
+// waiting for it. Returns false if this was not done, such as where it is not supported.
+bool prefetch(const std::string& path);
+
+// Whether all of the content of the file is already in memory, so that reading it does not
+// need to wait for the disk. Returns false where this can not be told.
+bool is_in_memory(FILE* file);
+
+// What to write to a file, replacing anything that it had before.
+struct FileContent {
+    std::string path;
+    StringView content;
+};
+
+// Write out many files at once. Where io_uring is supported by the kernel, the files are
+// opened, written and closed in batches with only a few system calls for each batch.
+// Otherwise false is returned without having written anything, so that the files can be
+// written one at a time instead. Should one of the files fail to be written, the rest of
+// its batch is still written (as they have already been truncated), but nothing after it.
+bool write_files(const std::vector<FileContent>& files);
+
+// Wait for the content of the file at the given path to be written to disk, along with
+// the rest of its metadata (such as permissions) if requested. Returns false if there is
+// no longer any such file.
+bool sync_file(const std::string& path, bool include_metadata);
+
+// Wait for any changes to the entries of a directory to be written to disk. Returns false
+// if there is no longer any such directory.
+bool sync_directory(const std::string& path);
+
+// Write out every change made to the filesystem containing the given path, returning
+// false if this is not supported.
+bool sync_filesystem(const std::string& path);
+
+// Identifies the filesystem which a path is on, or 0 if this is not known.
+uintmax_t device_id(const std::string& path);
+
+// A point in time, as the number of seconds and nanoseconds since the epoch.
+struct FileTime {
+    int64_t seconds { 0 };
+    uint32_t nanoseconds { 0 };
+};
+
+inline bool operator==(const FileTime& left, const FileTime& right)
+{
+    return left.seconds == right.seconds && left.nanoseconds == right.nanoseconds;
+}
+
+inline bool operator!=(const FileTime& left, const FileTime& right)
+{
+    return !(left == right);
+}
+
+// What is known about a path from a single stat (following symlinks).
+struct Status {
+    bool exists { false };
+    bool is_regular_file { false };
+    perms permissions { perms::unknown };
+    FileTime modification_time;
+};
+
+// Set both the access and modification time of a file.
+void set_modification_time(const std::string& path, const FileTime& time);
+
+Status status(const std::string& path);
+
+Status status(FILE* file);
+
 } // namespace filesystem
 
 #ifdef _WIN32
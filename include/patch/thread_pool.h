@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Patch {
+
+// A fixed number of threads running work in the order that it is given.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t number_of_threads);
+
+    // Waits for any work which has already started to finish, discarding the rest.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void enqueue(std::function<void()> work);
+
+    // Run the given function on the pool, with the result (or exception thrown) given by the future.
+    template<typename Function>
+    auto submit(Function function) -> std::future<decltype(function())>
+    {
+        using Result = decltype(function());
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(function));
+        auto future = task->get_future();
+        enqueue([task] { (*task)(); });
+        return future;
+    }
+
+private:
+    void run();
+
+    std::mutex m_mutex;
+    std::condition_variable m_work_available;
+    std::deque<std::function<void()>> m_queue;
+    bool m_stopping { false };
+    std::vector<std::thread> m_threads;
+};
+
+} // namespace Patch
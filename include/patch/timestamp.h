@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#pragma once
+
+#include <patch/system.h>
+#include <string>
+
+namespace Patch {
+
+// Parse the timestamp given after a path in the header of a patch. This is either in the
+// format written by diff -u (e.g "2022-06-26 15:43:50.743831486 +1200") or the format
+// traditionally written by diff -c (e.g "Sun Jun 26 15:43:50 2022").
+//
+// A timestamp which does not give its offset from UTC is taken to be in local time, or
+// in UTC if assume_utc is set. Returns false if the timestamp is not understood.
+bool parse_timestamp(const std::string& timestamp, bool assume_utc, filesystem::FileTime& time);
+
+} // namespace Patch
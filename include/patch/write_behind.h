@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Patch {
+
+// Writes files out on a few threads of their own, so that whoever has the files to write is
+// not held up by each of them in turn. Writes to the same path are always done on the same
+// thread, in the order they were given. Only a limited number of writes are queued up at
+// once, beyond which giving another waits for one of them to start.
+class WriteBehind {
+public:
+    explicit WriteBehind(size_t number_of_threads, size_t queue_capacity = 64);
+
+    // Waits for every write which has been given to be done.
+    ~WriteBehind();
+
+    WriteBehind(const WriteBehind&) = delete;
+    WriteBehind& operator=(const WriteBehind&) = delete;
+
+    // Run the given function to write to the path. The threads are only started once there
+    // is something for them to do.
+    void run(const std::string& path, std::function<void()> write);
+
+    // Wait for every write given so far to be done. If any of them threw, the exception of the
+    // first of them (in the order they were given) is rethrown, and none given after it which
+    // had not yet started are done.
+    void wait();
+
+private:
+    struct Write {
+        size_t sequence;
+        std::function<void()> function;
+    };
+
+    void thread_main(size_t index);
+
+    size_t m_number_of_threads;
+    size_t m_queue_capacity;
+
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+
+    // The writes waiting for each of the threads.
+    std::vector<std::deque<Write>> m_queues;
+    size_t m_queued { 0 };
+    size_t m_running { 0 };
+    size_t m_next_sequence { 0 };
+
+    std::exception_ptr m_error;
+    size_t m_error_sequence { 0 };
+
+    bool m_stopping { false };
+    std::vector<std::thread> m_threads;
+};
+
+} // namespace Patch
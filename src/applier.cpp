@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright 2022-2026 Shannon Booth <shannon.ml.booth@gmail.com>
 
+#include <algorithm>
 #include <cmath>
 #include <istream>
 #include <limits>
@@ -9,26 +10,32 @@
 #include <patch/file.h>
 #include <patch/formatter.h>
 #include <patch/hunk.h>
+#include <patch/line_buffer.h>
 #include <patch/locator.h>
 #include <patch/options.h>
 #include <patch/patch.h>
+#include <patch/piece_table.h>
 #include <sstream>
+#include <stdexcept>
 #include <system_error>
+#include <utility>
 
 namespace Patch {
 
+// Writes lines with the newlines asked for by the given NewlineOutput option, which is a
+// template parameter so that the option does not need to be checked for every line.
+// Native newlines are always written as LF.
+template<Options::NewlineOutput newline_output>
 class LineWriter {
 public:
-    LineWriter(File& file, const Options& options)
+    explicit LineWriter(File& file)
         : m_file(file)
-        , m_options(options)
     {
     }
 
-    LineWriter& operator<<(const Line& line)
+    LineWriter& operator<<(const LineView& line)
     {
-        m_file << line.content;
-        *this << line.newline;
+        *this << line.content << line.newline;
         return *this;
     }
 
@@ -38,30 +45,41 @@ public:
         return *this;
     }
 
-    LineWriter& operator<<(const std::string& content)
+    LineWriter& operator<<(StringView content)
     {
-        m_file << content;
+        m_file.write(content.data(), content.size());
         return *this;
     }
 
-    LineWriter& operator<<(NewLine newline)
+    // Write the given lines of the original file.
+    void write_lines(const std::vector<Line>& lines, size_t start, size_t count)
     {
-        if (newline == NewLine::None)
-            return *this;
+        for (size_t i = start; i < start + count; ++i)
+            *this << lines[i];
+    }
 
-        if (m_options.newline_output == Options::NewlineOutput::Native
-            || m_options.newline_output == Options::NewlineOutput::LF) {
-            m_file << '\n';
-            return *this;
+    // Write the given lines of the original file. Where none of their newlines need to be
+    // changed, they are written exactly as they are all at once.
+    void write_lines(const LineBuffer& lines, size_t start, size_t count)
+    {
+        if (newline_output == Options::NewlineOutput::Keep
+            || (newline_output == Options::NewlineOutput::LF && !lines.has_newline(NewLine::CRLF))
+            || (newline_output == Options::NewlineOutput::CRLF && !lines.has_newline(NewLine::LF))) {
+            *this << lines.content_of(start, count);
+            return;
         }
 
-        if (m_options.newline_output == Options::NewlineOutput::CRLF) {
-            m_file << "\r\n";
+        for (size_t i = start; i < start + count; ++i)
+            *this << lines[i];
+    }
+
+    LineWriter& operator<<(NewLine newline)
+    {
+        if (newline == NewLine::None)
             return *this;
-        }
 
-        if (newline == NewLine::CRLF)
-            m_file << "\r\n";
+        if (newline_output == Options::NewlineOutput::CRLF || (newline_output == Options::NewlineOutput::Keep && newline == NewLine::CRLF))
+            m_file.write("\r\n", 2);
         else
             m_file << '\n';
 
@@ -70,10 +88,28 @@ public:
 
 private:
     File& m_file;
-    const Options& m_options;
 };
 
-static LineNumber write_define_hunk(LineWriter& output, const Hunk& hunk, const Location& location, const std::vector<Line>& lines, const std::string& define)
+// Call Apply<newline_output>::run() with the given arguments, for the NewlineOutput option
+// given. This is how which newlines are written is chosen once (such as for each file), rather
+// than for every line as it is written.
+template<template<Options::NewlineOutput> class Apply, typename... Args>
+static auto with_newline_output(const Options& options, Args&&... args) -> decltype(Apply<Options::NewlineOutput::LF>::run(std::forward<Args>(args)...))
+{
+    switch (options.newline_output) {
+    case Options::NewlineOutput::CRLF:
+        return Apply<Options::NewlineOutput::CRLF>::run(std::forward<Args>(args)...);
+    case Options::NewlineOutput::Keep:
+        return Apply<Options::NewlineOutput::Keep>::run(std::forward<Args>(args)...);
+    case Options::NewlineOutput::Native:
+    case Options::NewlineOutput::LF:
+        break;
+    }
+    return Apply<Options::NewlineOutput::LF>::run(std::forward<Args>(args)...);
+}
+
+template<typename Lines>
+static typename BasicPieceTable<Lines>::Edit define_hunk_edit(BasicPieceTable<Lines>& table, const Hunk& hunk, const Location& location, const Lines& lines, const std::string& define)
 {
     enum class DefineState {
         Outside,
@@ -82,69 +118,77 @@ static LineNumber write_define_hunk(LineWriter& output, const Hunk& hunk, const
         InsideELSE,
     };
 
+    typename BasicPieceTable<Lines>::Edit edit { static_cast<size_t>(location.line_number), 0, {} };
+    auto& replacement = edit.replacement;
+
     DefineState define_state = DefineState::Outside;
-    auto line_number = static_cast<size_t>(location.line_number);
+    auto line_number = edit.start;
 
     for (const auto& patch_line : hunk.lines) {
         if (patch_line.operation == ' ') {
-            const auto& line = lines.at(line_number);
-            ++line_number;
+            const auto line = lines.at(line_number);
             if (define_state != DefineState::Outside) {
-                output << "#endif" << line.newline;
+                table.append_added(replacement, Line("#endif", line.newline));
                 define_state = DefineState::Outside;
             }
-            output << line;
+            table.append_original(replacement, line_number);
+            ++line_number;
         } else if (patch_line.operation == '+') {
             if (define_state == DefineState::Outside) {
                 define_state = DefineState::InsideIFDEF;
-                output << "#ifdef " << define << patch_line.line.newline;
+                table.append_added(replacement, Line("#ifdef " + define, patch_line.line.newline));
             } else if (define_state == DefineState::InsideIFNDEF) {
                 define_state = DefineState::InsideELSE;
-                output << "#else" << patch_line.line.newline;
+                table.append_added(replacement, Line("#else", patch_line.line.newline));
             }
-            output << patch_line.line;
+            table.append_added(replacement, patch_line.line);
         } else if (patch_line.operation == '-') {
-            const auto& line = lines.at(line_number);
-            ++line_number;
+            const auto line = lines.at(line_number);
 
             if (define_state == DefineState::Outside) {
                 define_state = DefineState::InsideIFNDEF;
-                output << "#ifndef " << define << line.newline;
+                table.append_added(replacement, Line("#ifndef " + define, line.newline));
             } else if (define_state == DefineState::InsideIFDEF) {
                 define_state = DefineState::InsideELSE;
-                output << "#else" << line.newline;
+                table.append_added(replacement, Line("#else", line.newline));
             }
-            output << line;
+            table.append_original(replacement, line_number);
+            ++line_number;
         }
     }
 
     if (define_state != DefineState::Outside) {
         const auto newline = lines.empty() ? NewLine::LF : lines.at(lines.size() - 1).newline;
-        output << "#endif" << newline;
+        table.append_added(replacement, Line("#endif", newline));
     }
 
-    return static_cast<LineNumber>(line_number);
+    edit.end = line_number;
+    return edit;
 }
 
-static LineNumber write_hunk(LineWriter& output, const Hunk& hunk, const Location& location, const std::vector<Line>& lines, const std::string& define)
+// The located hunk as a replacement of the lines of the original file that it covers.
+template<typename Lines>
+static typename BasicPieceTable<Lines>::Edit hunk_edit(BasicPieceTable<Lines>& table, const Hunk& hunk, const Location& location, const Lines& lines, const std::string& define)
 {
     if (!define.empty())
-        return write_define_hunk(output, hunk, location, lines, define);
+        return define_hunk_edit(table, hunk, location, lines, define);
 
-    auto line_number = static_cast<size_t>(location.line_number);
+    typename BasicPieceTable<Lines>::Edit edit { static_cast<size_t>(location.line_number), 0, {} };
+    auto line_number = edit.start;
 
     for (const auto& patch_line : hunk.lines) {
         if (patch_line.operation == ' ') {
-            output << lines.at(line_number);
+            table.append_original(edit.replacement, line_number);
             ++line_number;
         } else if (patch_line.operation == '+') {
-            output << patch_line.line;
+            table.append_added(edit.replacement, patch_line.line);
         } else if (patch_line.operation == '-') {
             ++line_number;
         }
     }
 
-    return static_cast<LineNumber>(line_number);
+    edit.end = line_number;
+    return edit;
 }
 
 static void print_hunk_statistics(std::ostream& out, size_t hunk_num, bool skipped, const Location& location, const Hunk& hunk, LineNumber offset_old_lines_to_new, LineNumber offset_error)
@@ -228,14 +272,19 @@ ReverseHandling check_how_to_handle_reversed_patch(std::ostream& out, const Opti
 
 void RejectWriter::write_reject_file(const Hunk& hunk)
 {
+    if (!m_reject_file) {
+        ++m_rejected_hunks;
+        return;
+    }
+
     if (should_write_as_unified()) {
         if (m_rejected_hunks == 0)
-            write_patch_header_as_unified(m_patch, m_reject_file);
-        write_hunk_as_unified(hunk, m_reject_file);
+            write_patch_header_as_unified(m_patch, *m_reject_file);
+        write_hunk_as_unified(hunk, *m_reject_file);
     } else {
         if (m_rejected_hunks == 0)
-            write_patch_header_as_context(m_patch, m_reject_file);
-        write_hunk_as_context(hunk, m_reject_file);
+            write_patch_header_as_context(m_patch, *m_reject_file);
+        write_hunk_as_context(hunk, *m_reject_file);
     }
     ++m_rejected_hunks;
 }
@@ -250,13 +299,168 @@ bool RejectWriter::should_write_as_unified() const
         || (m_reject_format == Options::RejectFormat::Default && m_patch.format == Format::Unified);
 }
 
-Result apply_patch(File& out_file, RejectWriter& reject_writer, const std::vector<Line>& lines, Patch& patch, const Options& options, std::ostream& out)
+bool needs_patched_output(const Patch& patch, const Options& options)
 {
-    if (options.reverse_patch)
-        reverse(patch);
+    return !options.dry_run || patch.operation == Operation::Delete || options.out_file_path == "-";
+}
+
+namespace {
+
+// Locates hunks in the lines of a file held in memory, writing the patched file in one
+// pass once every hunk has been located.
+template<typename Lines, Options::NewlineOutput newline_output>
+class InMemoryTarget {
+public:
+    InMemoryTarget(const Lines& lines, const Options& options)
+        : m_lines(lines)
+        , m_options(options)
+        , m_table(lines)
+    {
+    }
+
+    Location locate(const Hunk& hunk, LineNumber offset) const
+    {
+        return locate_hunk(m_lines, hunk, m_options.ignore_whitespace, offset, m_options.max_fuzz, m_options.max_offset);
+    }
+
+    void apply(const Hunk& hunk, const Location& location)
+    {
+        m_edits.push_back(hunk_edit(m_table, hunk, location, m_lines, m_options.define_macro));
+    }
+
+    void finish(File& out_file)
+    {
+        m_table.apply(m_edits);
+
+        LineWriter<newline_output> output(out_file);
+        m_table.for_each_run([this, &output](size_t start, size_t count) {
+            output.write_lines(m_lines, start, count);
+        }, [&output](const LineView& line) {
+            output << line;
+        });
+    }
+
+private:
+    const Lines& m_lines;
+    const Options& m_options;
+
+    // Each located hunk is recorded as an edit to the lines of the file.
+    BasicPieceTable<Lines> m_table;
+    std::vector<typename BasicPieceTable<Lines>::Edit> m_edits;
+};
+
+// Locates hunks in a file as it is read, holding only the lines that a hunk may still be
+// found in. Lines before those are written out as soon as nothing can be found in them,
+// which is anything before the end of the last hunk applied, or before where the next
+// hunk is looked for.
+template<Options::NewlineOutput newline_output>
+class StreamingTarget {
+public:
+    StreamingTarget(File& input_file, File& out_file, const Options& options, bool write_output)
+        : m_input(input_file)
+        , m_output(out_file)
+        , m_options(options)
+        , m_write_output(write_output)
+    {
+    }
+
+    Location locate(const Hunk& hunk, LineNumber offset)
+    {
+        const LineNumber expected = expected_line_number(hunk) - 1 + offset;
+        const LineNumber old_lines = std::count_if(hunk.lines.begin(), hunk.lines.end(), [](const PatchLine& line) {
+            return line.operation != '+';
+        });
+
+        write_until(expected - m_options.max_offset);
+        // One line past where the hunk could be found is enough to tell whether there is
+        // anything after it, which matters for a hunk that expects an empty file.
+        read_until(expected + m_options.max_offset + old_lines + 1);
+
+        auto location = locate_hunk(m_window, hunk, m_options.ignore_whitespace, offset - m_window_start, m_options.max_fuzz, m_options.max_offset);
+        if (location.is_found())
+            location.line_number += m_window_start;
+        return location;
+    }
+
+    void apply(const Hunk& hunk, const Location& location)
+    {
+        // Any hunk which would be put before what has already been written out (which can
+        // only be a hunk with no lines to find) is put as close to it as it can be.
+        Location in_window = location;
+        in_window.line_number = std::max<LineNumber>(location.line_number - m_window_start, 0);
+
+        PieceTable table(m_window);
+        const auto edit = hunk_edit(table, hunk, in_window, m_window, m_options.define_macro);
+
+        // The lines of the replacement refer to the window, so it is written out before
+        // anything is removed from the window.
+        for (size_t i = 0; i < std::min(edit.start, m_window.size()); ++i)
+            m_output << m_window[i];
+        table.for_each_line(edit.replacement, [this](const LineView& line) {
+            m_output << line;
+        });
+        drop(std::min(edit.end, m_window.size()));
+    }
+
+    void finish()
+    {
+        write_until(std::numeric_limits<LineNumber>::max());
+    }
+
+private:
+    // Read lines into the window until it reaches the given line, or the end of the file.
+    void read_until(LineNumber end)
+    {
+        Line line;
+        while (m_window_start + static_cast<LineNumber>(m_window.size()) < end && m_input && m_input.get_line(line.content, &line.newline))
+            m_window.push_back(std::move(line));
+    }
 
-    LineWriter output(out_file, options);
-    LineNumber line_number = 0; // NOTE: relative to 'old' file.
+    // Write out the lines of the file before the given line (if the output is wanted), going
+    // on to read any which have not been read yet.
+    void write_until(LineNumber end)
+    {
+        const auto count = static_cast<size_t>(std::min<LineNumber>(std::max<LineNumber>(end - m_window_start, 0), static_cast<LineNumber>(m_window.size())));
+        if (m_write_output) {
+            for (size_t i = 0; i < count; ++i)
+                m_output << m_window[i];
+        }
+        drop(count);
+
+        if (!m_window.empty())
+            return;
+
+        Line line;
+        while (m_window_start < end && m_input && m_input.get_line(line.content, &line.newline)) {
+            if (m_write_output)
+                m_output << line;
+            ++m_window_start;
+        }
+    }
+
+    void drop(size_t count)
+    {
+        m_window.erase(m_window.begin(), m_window.begin() + static_cast<std::ptrdiff_t>(count));
+        m_window_start += static_cast<LineNumber>(count);
+    }
+
+    File& m_input;
+    LineWriter<newline_output> m_output;
+    const Options& m_options;
+    bool m_write_output;
+
+    // The lines of the file from m_window_start which are still held.
+    std::vector<Line> m_window;
+    LineNumber m_window_start { 0 };
+};
+
+} // namespace
+
+// Locate each hunk of the patch in the target, applying those that are found and writing
+// a reject for the rest.
+template<typename Target>
+static Result apply_hunks(Target& target, RejectWriter& reject_writer, Patch& patch, const Options& options, std::ostream& out, bool write_output)
+{
     LineNumber offset_old_lines_to_new = 0;
     LineNumber offset_error = 0;
 
@@ -266,13 +470,13 @@ Result apply_patch(File& out_file, RejectWriter& reject_writer, const std::vecto
     for (size_t hunk_num = 0; hunk_num < patch.hunks.size(); ++hunk_num) {
         auto& hunk = patch.hunks[hunk_num];
 
-        auto location = locate_hunk(lines, hunk, options.ignore_whitespace, offset_error, options.max_fuzz);
+        auto location = target.locate(hunk, offset_error);
 
         // POSIX specifies that until a hunk successfully applies, patch should check if the patch given is reversed.
         if (hunk_num == 0 && should_check_if_patch_is_reversed(location, options)) {
             // The first hunk is not applying perfectly. We need to verify whether it looks reversed.
             reverse(hunk);
-            auto reversed_location = locate_hunk(lines, hunk, options.ignore_whitespace, offset_error, options.max_fuzz);
+            auto reversed_location = target.locate(hunk, offset_error);
 
             // Consider the patch potentially reversed if:
             //  * The reversed hunk applied perfectly.
@@ -302,13 +506,8 @@ Result apply_patch(File& out_file, RejectWriter& reject_writer, const std::vecto
 
         if (!skip_remaining_hunks && location.is_found()) {
             offset_error += location.offset;
-
-            // Write up until where we have found this latest hunk from the old file.
-            for (; line_number < location.line_number; ++line_number)
-                output << lines.at(static_cast<size_t>(line_number));
-
-            // Then output the hunk to what we hope is the correct location in the file.
-            line_number = write_hunk(output, hunk, location, lines, options.define_macro);
+            if (write_output)
+                target.apply(hunk, location);
         } else {
             // The hunk has failed to reply. We now need to write the hunk to the reject file.
             // Per POSIX, ensure offset relative to new file rather than old file.
@@ -329,13 +528,153 @@ Result apply_patch(File& out_file, RejectWriter& reject_writer, const std::vecto
             offset_old_lines_to_new += hunk.new_file_range.number_of_lines - hunk.old_file_range.number_of_lines;
     }
 
-    // We've finished applying all hunks, write out anything from the old file we haven't already.
-    for (; static_cast<size_t>(line_number) < lines.size(); ++line_number)
-        output << lines[static_cast<size_t>(line_number)];
-
     return { reject_writer.rejected_hunks(), skip_remaining_hunks, all_hunks_applied_perfectly };
 }
 
+template<Options::NewlineOutput newline_output>
+struct ApplyInMemory {
+    template<typename Lines>
+    static Result run(File& out_file, RejectWriter& reject_writer, const Lines& lines, Patch& patch, const Options& options, std::ostream& out)
+    {
+        // Only where each hunk is found matters for a check of whether the patch applies.
+        const bool write_output = needs_patched_output(patch, options);
+
+        InMemoryTarget<Lines, newline_output> target(lines, options);
+        const auto result = apply_hunks(target, reject_writer, patch, options, out, write_output);
+        if (write_output)
+            target.finish(out_file);
+
+        return result;
+    }
+};
+
+template<typename Lines>
+Result apply_patch(File& out_file, RejectWriter& reject_writer, const Lines& lines, Patch& patch, const Options& options, std::ostream& out)
+{
+    if (options.reverse_patch)
+        reverse(patch);
+
+    return with_newline_output<ApplyInMemory>(options, out_file, reject_writer, lines, patch, options, out);
+}
+
+template<Options::NewlineOutput newline_output>
+struct ApplyStreaming {
+    static Result run(File& out_file, RejectWriter& reject_writer, File& input_file, Patch& patch, const Options& options, std::ostream& out)
+    {
+        const bool write_output = needs_patched_output(patch, options);
+
+        StreamingTarget<newline_output> target(input_file, out_file, options, write_output);
+        const auto result = apply_hunks(target, reject_writer, patch, options, out, write_output);
+        if (write_output)
+            target.finish();
+
+        return result;
+    }
+};
+
+Result apply_patch_streaming(File& out_file, RejectWriter& reject_writer, File& input_file, Patch& patch, const Options& options, std::ostream& out)
+{
+    if (options.reverse_patch)
+        reverse(patch);
+
+    return with_newline_output<ApplyStreaming>(options, out_file, reject_writer, input_file, patch, options, out);
+}
+
+namespace {
+
+// An ed command expressed as replacing a range of lines with some text.
+struct EdEdit {
+    size_t start;
+    size_t count;
+    const std::vector<Line>* lines;
+};
+
+} // namespace
+
+static EdEdit ed_edit_from_command(const EdCommand& command)
+{
+    static const std::vector<Line> no_lines;
+
+    const auto start = static_cast<size_t>(command.start_line);
+    switch (command.command) {
+    case 'a':
+        return { start, 0, &command.lines };
+    case 'i':
+        return { start - 1, 0, &command.lines };
+    case 'c':
+        return { start - 1, static_cast<size_t>(command.end_line - command.start_line + 1), &command.lines };
+    default:
+        return { start - 1, static_cast<size_t>(command.end_line - command.start_line + 1), &no_lines };
+    }
+}
+
+static void check_ed_edit_in_range(const EdEdit& edit, size_t number_of_lines)
+{
+    if (edit.start + edit.count > number_of_lines)
+        throw std::out_of_range("ed script refers to a line past the end of the file");
+}
+
+template<Options::NewlineOutput newline_output>
+struct WriteEdResult {
+    template<typename Table>
+    static void run(File& out_file, const Table& table)
+    {
+        // Every line written by ed ends with a newline, even if it did not have one before.
+        LineWriter<newline_output> output(out_file);
+        table.for_each_line([&output](const LineView& line) {
+            output << line.content << (line.newline == NewLine::None ? NewLine::LF : line.newline);
+        });
+    }
+};
+
+template<typename Lines>
+void apply_ed_script(File& out_file, const Lines& input_lines, const Patch& patch, const Options& options)
+{
+    std::vector<EdEdit> edits;
+    edits.reserve(patch.ed_commands.size());
+    for (const auto& command : patch.ed_commands)
+        edits.push_back(ed_edit_from_command(command));
+
+    // Each command refers to the lines as changed by the commands before it.
+    BasicPieceTable<Lines> table(input_lines);
+    std::vector<typename BasicPieceTable<Lines>::Piece> replacement;
+    for (const auto& edit : edits) {
+        check_ed_edit_in_range(edit, table.size());
+
+        replacement.clear();
+        for (const auto& line : *edit.lines)
+            table.append_added(replacement, line);
+        table.replace(edit.start, edit.count, replacement);
+    }
+
+    if (!needs_patched_output(patch, options))
+        return;
+
+    with_newline_output<WriteEdResult>(options, out_file, table);
+}
+
+template Result apply_patch(File&, RejectWriter&, const std::vector<Line>&, Patch&, const Options&, std::ostream&);
+template Result apply_patch(File&, RejectWriter&, const LineBuffer&, Patch&, const Options&, std::ostream&);
+template void apply_ed_script(File&, const std::vector<Line>&, const Patch&, const Options&);
+template void apply_ed_script(File&, const LineBuffer&, const Patch&, const Options&);
+
+template<Options::NewlineOutput newline_output>
+struct WriteAddedLines {
+    static void run(File& out_file, const Patch& patch)
+    {
+        LineWriter<newline_output> output(out_file);
+        for (const auto& hunk : patch.hunks) {
+            for (const auto& patch_line : hunk.lines)
+                output << patch_line.line;
+        }
+    }
+};
+
+void write_added_lines(File& out_file, const Patch& patch, const Options& options)
+{
+    with_newline_output<WriteAddedLines>(options, out_file, patch);
+}
+
 void reverse(Patch& patch)
 {
     if (patch.operation == Operation::Delete)
@@ -346,8 +685,12 @@ void reverse(Patch& patch)
     std::swap(patch.old_file_path, patch.new_file_path);
     std::swap(patch.old_file_time, patch.new_file_time);
     std::swap(patch.old_file_mode, patch.new_file_mode);
+    std::swap(patch.old_object_id, patch.new_object_id);
     for (auto& hunk : patch.hunks)
         reverse(hunk);
+
+    // The second hunk of a binary patch is the reverse of the first.
+    std::reverse(patch.binary_hunks.begin(), patch.binary_hunks.end());
 }
 
 void reverse(Hunk& hunk)
@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#include <algorithm>
+#include <patch/arena.h>
+
+namespace Patch {
+
+void* Arena::allocate_in_new_block(size_t size, size_t alignment)
+{
+    // Each block is twice the size of the one before it (up to a limit), so that there are
+    // only ever a few blocks no matter how much is put in the arena.
+    constexpr size_t first_block_size = 4 * 1024;
+    constexpr size_t max_block_size = 1024 * 1024;
+    const size_t block_size = m_capacity == 0 ? first_block_size : std::min(m_capacity * 2, max_block_size);
+
+    // Anything which would take up much of a block is given one of its own, leaving the
+    // current block for whatever comes next.
+    if (size > block_size / 4) {
+        std::unique_ptr<char[]> block(new char[size]);
+        m_blocks.push_back(std::move(block));
+        return m_blocks.back().get();
+    }
+
+    std::unique_ptr<char[]> block(new char[block_size]);
+    m_blocks.push_back(std::move(block));
+    m_block = m_blocks.back().get();
+    m_capacity = block_size;
+    m_used = size;
+
+    // A new block is aligned for anything, as it is allocated with new.
+    (void)alignment;
+    return m_block;
+}
+
+} // namespace Patch
@@ -0,0 +1,513 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <patch/applier.h>
+#include <patch/binary.h>
+#include <patch/file.h>
+#include <stdexcept>
+
+#ifdef PATCH_HAVE_ZLIB
+#    include <zlib.h>
+#endif
+
+namespace Patch {
+
+bool decode_base85_line(StringView line, std::string& output)
+{
+    if (line.empty())
+        return false;
+
+    // The first character of the line tells us how many bytes the line decodes to.
+    size_t length;
+    const char length_char = line[0];
+    if (length_char >= 'A' && length_char <= 'Z')
+        length = static_cast<size_t>(length_char - 'A' + 1);
+    else if (length_char >= 'a' && length_char <= 'z')
+        length = static_cast<size_t>(length_char - 'a' + 27);
+    else
+        return false;
+
+    // Every 4 bytes are encoded as 5 characters.
+    const StringView encoded = line.substr(1);
+    if (encoded.size() != (length + 3) / 4 * 5)
+        return false;
+
+    static const auto decode_table = [] {
+        std::array<uint8_t, 256> table {};
+        table.fill(0xff);
+        const char* alphabet = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz!#$%&()*+-;<=>?@^_`{|}~";
+        for (uint8_t i = 0; i < 85; ++i)
+            table[static_cast<unsigned char>(alphabet[i])] = i;
+        return table;
+    }();
+
+    for (size_t i = 0; i < encoded.size(); i += 5) {
+        uint64_t value = 0;
+        for (size_t j = 0; j < 5; ++j) {
+            const uint8_t digit = decode_table[static_cast<unsigned char>(encoded[i + j])];
+            if (digit == 0xff)
+                return false;
+            value = value * 85 + digit;
+        }
+
+        if (value > UINT32_MAX)
+            return false;
+
+        const size_t bytes = std::min<size_t>(length, 4);
+        for (size_t j = 0; j < bytes; ++j)
+            output.push_back(static_cast<char>((value >> (24 - 8 * j)) & 0xff));
+        length -= bytes;
+    }
+
+    return true;
+}
+
+namespace {
+
+class SHA1 {
+public:
+    void update(const char* data, size_t size)
+    {
+        m_length += size;
+        while (size != 0) {
+            const size_t to_copy = std::min(size, m_block.size() - m_block_size);
+            std::copy(data, data + to_copy, m_block.begin() + static_cast<std::ptrdiff_t>(m_block_size));
+            m_block_size += to_copy;
+            data += to_copy;
+            size -= to_copy;
+
+            if (m_block_size == m_block.size()) {
+                process_block();
+                m_block_size = 0;
+            }
+        }
+    }
+
+    std::string hex_digest()
+    {
+        const uint64_t length_in_bits = m_length * 8;
+
+        const char padding_start = static_cast<char>(0x80);
+        update(&padding_start, 1);
+        const char zero = 0;
+        while (m_block_size != 56)
+            update(&zero, 1);
+
+        for (int i = 7; i >= 0; --i) {
+            const char byte = static_cast<char>((length_in_bits >> (8 * i)) & 0xff);
+            update(&byte, 1);
+        }
+
+        static const char* hex = "0123456789abcdef";
+        std::string digest;
+        digest.reserve(40);
+        for (const uint32_t word : m_state) {
+            for (int i = 28; i >= 0; i -= 4)
+                digest.push_back(hex[(word >> i) & 0xf]);
+        }
+        return digest;
+    }
+
+private:
+    static uint32_t rotate_left(uint32_t value, int amount)
+    {
+        return (value << amount) | (value >> (32 - amount));
+    }
+
+    void process_block()
+    {
+        std::array<uint32_t, 80> w;
+        for (size_t i = 0; i < 16; ++i) {
+            w[i] = static_cast<uint32_t>(m_block[i * 4]) << 24
+                | static_cast<uint32_t>(m_block[i * 4 + 1]) << 16
+                | static_cast<uint32_t>(m_block[i * 4 + 2]) << 8
+                | static_cast<uint32_t>(m_block[i * 4 + 3]);
+        }
+        for (size_t i = 16; i < 80; ++i)
+            w[i] = rotate_left(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = m_state[0];
+        uint32_t b = m_state[1];
+        uint32_t c = m_state[2];
+        uint32_t d = m_state[3];
+        uint32_t e = m_state[4];
+
+        for (size_t i = 0; i < 80; ++i) {
+            uint32_t f;
+            uint32_t k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5a827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8f1bbcdc;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+
+            const uint32_t temp = rotate_left(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotate_left(b, 30);
+            b = a;
+            a = temp;
+        }
+
+        m_state[0] += a;
+        m_state[1] += b;
+        m_state[2] += c;
+        m_state[3] += d;
+        m_state[4] += e;
+    }
+
+    std::array<uint32_t, 5> m_state { { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 } };
+    std::array<uint8_t, 64> m_block {};
+    size_t m_block_size { 0 };
+    uint64_t m_length { 0 };
+};
+
+void update_with_blob_header(SHA1& sha1, uint64_t size)
+{
+    const std::string header = "blob " + std::to_string(size);
+    sha1.update(header.c_str(), header.size() + 1);
+}
+
+// Where the result of applying a binary hunk is written to, keeping track of how
+// much has been written so far so that the hash of the result can be checked.
+class BinaryWriter {
+public:
+    BinaryWriter(File& out, uint64_t expected_size)
+        : m_out(out)
+        , m_expected_size(expected_size)
+    {
+        update_with_blob_header(m_sha1, expected_size);
+    }
+
+    void write(const char* data, size_t size)
+    {
+        if (size > m_expected_size - m_written)
+            throw std::runtime_error("Corrupt git binary patch, result is larger than expected");
+
+        m_out.write(data, size);
+        m_sha1.update(data, size);
+        m_written += size;
+    }
+
+    uint64_t remaining() const { return m_expected_size - m_written; }
+
+    std::string object_id() { return m_sha1.hex_digest(); }
+
+private:
+    File& m_out;
+    SHA1 m_sha1;
+    uint64_t m_expected_size;
+    uint64_t m_written { 0 };
+};
+
+// Apply a git delta as it is decompressed. A delta consists of the expected size of the source
+// and target, followed by a series of instructions to either copy a range of bytes from the
+// source, or insert bytes which follow the instruction into the target.
+class DeltaApplier {
+public:
+    explicit DeltaApplier(StringView source)
+        : m_source(source)
+    {
+    }
+
+    bool source_matches() const { return !m_source_mismatch; }
+
+    uint64_t target_size() const { return m_target_size; }
+
+    bool has_target_size() const { return m_state != State::SourceSize && m_state != State::TargetSize; }
+
+    // Consume the given delta data, returning the number of bytes consumed. Consuming
+    // stops once the size of the target has been parsed to allow the writer to be set up.
+    size_t consume(const char* data, size_t size, BinaryWriter* writer)
+    {
+        const char* begin = data;
+        const char* end = data + size;
+
+        while (data != end && !m_source_mismatch) {
+            const auto c = static_cast<uint8_t>(*data);
+
+            switch (m_state) {
+            case State::SourceSize:
+            case State::TargetSize: {
+                ++data;
+                if (m_shift > 63)
+                    throw std::runtime_error("Corrupt git binary patch, delta size is too large");
+                m_size |= static_cast<uint64_t>(c & 0x7f) << m_shift;
+                m_shift += 7;
+                if (c & 0x80)
+                    break;
+
+                if (m_state == State::SourceSize) {
+                    m_source_mismatch = m_size != m_source.size();
+                    m_state = State::TargetSize;
+                } else {
+                    m_target_size = m_size;
+                    m_state = State::Instruction;
+                }
+                m_size = 0;
+                m_shift = 0;
+
+                if (m_state == State::Instruction)
+                    return static_cast<size_t>(data - begin);
+                break;
+            }
+            case State::Instruction:
+                ++data;
+                if (c & 0x80) {
+                    m_instruction = c;
+                    m_argument = 0;
+                    m_copy_offset = 0;
+                    m_copy_size = 0;
+                    m_state = State::CopyArguments;
+                    if (!next_copy_argument())
+                        copy(*writer);
+                } else if (c != 0) {
+                    m_insert_remaining = c;
+                    m_state = State::Insert;
+                } else {
+                    throw std::runtime_error("Corrupt git binary patch, unexpected delta instruction");
+                }
+                break;
+            case State::CopyArguments:
+                ++data;
+                if (m_argument < 4)
+                    m_copy_offset |= static_cast<uint64_t>(c) << (8 * m_argument);
+                else
+                    m_copy_size |= static_cast<uint64_t>(c) << (8 * (m_argument - 4));
+                ++m_argument;
+                if (!next_copy_argument())
+                    copy(*writer);
+                break;
+            case State::Insert: {
+                const size_t to_insert = static_cast<size_t>(std::min<uint64_t>(m_insert_remaining, static_cast<uint64_t>(end - data)));
+                writer->write(data, to_insert);
+                data += to_insert;
+                m_insert_remaining -= to_insert;
+                if (m_insert_remaining == 0)
+                    m_state = State::Instruction;
+                break;
+            }
+            }
+        }
+
+        return static_cast<size_t>(data - begin);
+    }
+
+    bool is_complete() const { return m_state == State::Instruction; }
+
+private:
+    // Advance to the next argument byte given in the copy instruction, returning false if there is none.
+    bool next_copy_argument()
+    {
+        while (m_argument < 7 && !(m_instruction & (1 << m_argument)))
+            ++m_argument;
+        return m_argument < 7;
+    }
+
+    void copy(BinaryWriter& writer)
+    {
+        if (m_copy_size == 0)
+            m_copy_size = 0x10000;
+
+        if (m_copy_offset > m_source.size() || m_copy_size > m_source.size() - m_copy_offset)
+            throw std::runtime_error("Corrupt git binary patch, delta copies outside of the source");
+
+        writer.write(m_source.data() + m_copy_offset, static_cast<size_t>(m_copy_size));
+        m_state = State::Instruction;
+    }
+
+    enum class State {
+        SourceSize,
+        TargetSize,
+        Instruction,
+        CopyArguments,
+        Insert,
+    };
+
+    StringView m_source;
+    State m_state { State::SourceSize };
+    bool m_source_mismatch { false };
+
+    uint64_t m_size { 0 };
+    int m_shift { 0 };
+    uint64_t m_target_size { 0 };
+
+    uint8_t m_instruction { 0 };
+    int m_argument { 0 };
+    uint64_t m_copy_offset { 0 };
+    uint64_t m_copy_size { 0 };
+    uint64_t m_insert_remaining { 0 };
+};
+
+} // namespace
+
+std::string git_object_id(StringView content)
+{
+    SHA1 sha1;
+    update_with_blob_header(sha1, content.size());
+    sha1.update(content.data(), content.size());
+    return sha1.hex_digest();
+}
+
+#ifdef PATCH_HAVE_ZLIB
+
+bool supports_git_binary_patches()
+{
+    return true;
+}
+
+namespace {
+
+bool is_null_object_id(const std::string& id)
+{
+    return std::all_of(id.begin(), id.end(), [](char c) { return c == '0'; });
+}
+
+bool matches_object_id(const std::string& expected_id, const std::string& actual_id)
+{
+    // The object ids in the index line of a patch may be abbreviated.
+    return actual_id.compare(0, expected_id.size(), expected_id) == 0;
+}
+
+class Inflater {
+public:
+    explicit Inflater(const std::string& data)
+    {
+        if (inflateInit(&m_stream) != Z_OK)
+            throw std::runtime_error("Unable to initialize zlib");
+
+        m_stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        m_stream.avail_in = static_cast<uInt>(data.size());
+        if (m_stream.avail_in != data.size())
+            throw std::runtime_error("Git binary patch is too large");
+    }
+
+    ~Inflater()
+    {
+        inflateEnd(&m_stream);
+    }
+
+    Inflater(const Inflater&) = delete;
+    Inflater& operator=(const Inflater&) = delete;
+
+    // Inflate the next chunk of data into the buffer, returning the number of bytes
+    // written to the buffer. Once all data has been inflated 0 is returned.
+    size_t inflate(std::array<char, 16 * 1024>& buffer)
+    {
+        if (m_finished)
+            return 0;
+
+        m_stream.next_out = reinterpret_cast<Bytef*>(buffer.data());
+        m_stream.avail_out = static_cast<uInt>(buffer.size());
+
+        const int rc = ::inflate(&m_stream, Z_NO_FLUSH);
+        if (rc == Z_STREAM_END)
+            m_finished = true;
+        else if (rc != Z_OK)
+            throw std::runtime_error("Corrupt git binary patch, failed to inflate data");
+
+        const size_t inflated = buffer.size() - m_stream.avail_out;
+        if (inflated == 0 && !m_finished)
+            throw std::runtime_error("Corrupt git binary patch, data is truncated");
+
+        return inflated;
+    }
+
+private:
+    z_stream m_stream {};
+    bool m_finished { false };
+};
+
+} // namespace
+
+bool apply_git_binary_patch(File& out_file, StringView input, Patch& patch, const Options& options)
+{
+    if (options.reverse_patch)
+        reverse(patch);
+
+    if (patch.binary_hunks.empty())
+        throw std::runtime_error("Git binary patch contains no data");
+
+    // Check that the patch was made against the content that we have.
+    if (!patch.old_object_id.empty()) {
+        if (is_null_object_id(patch.old_object_id)) {
+            if (!input.empty())
+                return false;
+        } else if (!matches_object_id(patch.old_object_id, git_object_id(input))) {
+            return false;
+        }
+    }
+
+    const auto& hunk = patch.binary_hunks.front();
+
+    Inflater inflater(hunk.data);
+    std::array<char, 16 * 1024> buffer;
+    uint64_t inflated_size = 0;
+
+    std::unique_ptr<BinaryWriter> writer;
+    DeltaApplier delta(input);
+
+    if (hunk.type == BinaryHunk::Type::Literal)
+        writer.reset(new BinaryWriter(out_file, hunk.size));
+
+    while (size_t size = inflater.inflate(buffer)) {
+        inflated_size += size;
+        if (inflated_size > hunk.size)
+            throw std::runtime_error("Corrupt git binary patch, inflated data is larger than expected");
+
+        if (hunk.type == BinaryHunk::Type::Literal) {
+            writer->write(buffer.data(), size);
+            continue;
+        }
+
+        size_t consumed = delta.consume(buffer.data(), size, writer.get());
+        if (!delta.source_matches())
+            return false;
+
+        if (!writer && delta.has_target_size()) {
+            writer.reset(new BinaryWriter(out_file, delta.target_size()));
+            delta.consume(buffer.data() + consumed, size - consumed, writer.get());
+        }
+    }
+
+    if (inflated_size != hunk.size)
+        throw std::runtime_error("Corrupt git binary patch, inflated data is smaller than expected");
+
+    if (!writer || (hunk.type == BinaryHunk::Type::Delta && !delta.is_complete()) || writer->remaining() != 0)
+        throw std::runtime_error("Corrupt git binary patch, result is smaller than expected");
+
+    if (!patch.new_object_id.empty() && !is_null_object_id(patch.new_object_id)
+        && !matches_object_id(patch.new_object_id, writer->object_id())) {
+        throw std::runtime_error("Corrupt git binary patch, result does not match the expected content");
+    }
+
+    return true;
+}
+
+#else
+
+bool supports_git_binary_patches()
+{
+    return false;
+}
+
+bool apply_git_binary_patch(File&, StringView, Patch&, const Options&)
+{
+    throw std::runtime_error("git binary diffs are not supported by this build of patch");
+}
+
+#endif
+
+} // namespace Patch
@@ -0,0 +1,313 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <patch/compression.h>
+#include <patch/file.h>
+#include <stdexcept>
+#include <string>
+
+#ifdef PATCH_HAVE_ZLIB
+#    include <zlib.h>
+#endif
+
+#ifdef PATCH_HAVE_LZMA
+#    include <lzma.h>
+#endif
+
+#ifdef PATCH_HAVE_ZSTD
+#    include <zstd.h>
+#endif
+
+namespace Patch {
+
+Compression detect_compression(StringView magic)
+{
+    if (magic.starts_with({ "\x1f\x8b", 2 }))
+        return Compression::Gzip;
+    if (magic.starts_with({ "\xfd" "7zXZ\x00", 6 }))
+        return Compression::Xz;
+    if (magic.starts_with({ "\x28\xb5\x2f\xfd", 4 }))
+        return Compression::Zstd;
+    return Compression::None;
+}
+
+const char* to_string(Compression compression)
+{
+    switch (compression) {
+    case Compression::None:
+        return "none";
+    case Compression::Gzip:
+        return "gzip";
+    case Compression::Xz:
+        return "xz";
+    case Compression::Zstd:
+        return "zstd";
+    }
+
+    throw std::invalid_argument("Unknown compression format");
+}
+
+bool supports_decompression(Compression compression)
+{
+    switch (compression) {
+    case Compression::None:
+        return true;
+    case Compression::Gzip:
+#ifdef PATCH_HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    case Compression::Xz:
+#ifdef PATCH_HAVE_LZMA
+        return true;
+#else
+        return false;
+#endif
+    case Compression::Zstd:
+#ifdef PATCH_HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    return false;
+}
+
+namespace {
+
+constexpr size_t chunk_size = 64 * 1024;
+
+class Decompressor {
+public:
+    virtual ~Decompressor() = default;
+
+    // Decompress the next chunk of input, writing all output which that produces.
+    virtual void decompress(const char* data, size_t size, File& output) = 0;
+
+    // Called at the end of input, throws if the compressed input is incomplete.
+    virtual void finish(File& output) = 0;
+
+protected:
+    std::array<char, chunk_size> m_buffer;
+};
+
+#ifdef PATCH_HAVE_ZLIB
+
+class GzipDecompressor final : public Decompressor {
+public:
+    GzipDecompressor()
+    {
+        // Add 32 to the window bits to tell zlib to expect a gzip header.
+        if (inflateInit2(&m_stream, 15 + 32) != Z_OK)
+            throw std::runtime_error("Unable to initialize zlib");
+    }
+
+    ~GzipDecompressor() override
+    {
+        inflateEnd(&m_stream);
+    }
+
+    void decompress(const char* data, size_t size, File& output) override
+    {
+        m_stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        m_stream.avail_in = static_cast<uInt>(size);
+
+        while (true) {
+            // A gzip file may be made up of multiple members, one after the other.
+            if (m_finished) {
+                if (m_stream.avail_in == 0)
+                    return;
+                inflateReset(&m_stream);
+                m_finished = false;
+            }
+
+            m_stream.next_out = reinterpret_cast<Bytef*>(m_buffer.data());
+            m_stream.avail_out = static_cast<uInt>(m_buffer.size());
+
+            const int rc = inflate(&m_stream, Z_NO_FLUSH);
+            if (rc == Z_STREAM_END)
+                m_finished = true;
+            else if (rc != Z_OK && rc != Z_BUF_ERROR)
+                throw std::runtime_error("Failed to decompress gzip compressed patch");
+
+            output.write(m_buffer.data(), m_buffer.size() - m_stream.avail_out);
+
+            if (!m_finished && m_stream.avail_in == 0 && m_stream.avail_out != 0)
+                return;
+        }
+    }
+
+    void finish(File&) override
+    {
+        if (!m_finished)
+            throw std::runtime_error("Unexpected end of gzip compressed patch");
+    }
+
+private:
+    z_stream m_stream {};
+    bool m_finished { false };
+};
+
+#endif
+
+#ifdef PATCH_HAVE_LZMA
+
+class XzDecompressor final : public Decompressor {
+public:
+    XzDecompressor()
+    {
+        if (lzma_stream_decoder(&m_stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+            throw std::runtime_error("Unable to initialize liblzma");
+    }
+
+    ~XzDecompressor() override
+    {
+        lzma_end(&m_stream);
+    }
+
+    void decompress(const char* data, size_t size, File& output) override
+    {
+        m_stream.next_in = reinterpret_cast<const uint8_t*>(data);
+        m_stream.avail_in = size;
+
+        while (true) {
+            m_stream.next_out = reinterpret_cast<uint8_t*>(m_buffer.data());
+            m_stream.avail_out = m_buffer.size();
+
+            if (lzma_code(&m_stream, LZMA_RUN) != LZMA_OK)
+                throw std::runtime_error("Failed to decompress xz compressed patch");
+
+            output.write(m_buffer.data(), m_buffer.size() - m_stream.avail_out);
+
+            if (m_stream.avail_in == 0 && m_stream.avail_out != 0)
+                return;
+        }
+    }
+
+    void finish(File& output) override
+    {
+        m_stream.next_in = nullptr;
+        m_stream.avail_in = 0;
+
+        while (true) {
+            m_stream.next_out = reinterpret_cast<uint8_t*>(m_buffer.data());
+            m_stream.avail_out = m_buffer.size();
+
+            const auto rc = lzma_code(&m_stream, LZMA_FINISH);
+            if (rc != LZMA_OK && rc != LZMA_STREAM_END)
+                throw std::runtime_error("Unexpected end of xz compressed patch");
+
+            output.write(m_buffer.data(), m_buffer.size() - m_stream.avail_out);
+
+            if (rc == LZMA_STREAM_END)
+                return;
+        }
+    }
+
+private:
+    lzma_stream m_stream = LZMA_STREAM_INIT;
+};
+
+#endif
+
+#ifdef PATCH_HAVE_ZSTD
+
+class ZstdDecompressor final : public Decompressor {
+public:
+    ZstdDecompressor()
+        : m_stream(ZSTD_createDStream())
+    {
+        if (!m_stream)
+            throw std::runtime_error("Unable to initialize zstd");
+        ZSTD_initDStream(m_stream);
+    }
+
+    ~ZstdDecompressor() override
+    {
+        ZSTD_freeDStream(m_stream);
+    }
+
+    void decompress(const char* data, size_t size, File& output) override
+    {
+        ZSTD_inBuffer input { data, size, 0 };
+
+        while (true) {
+            ZSTD_outBuffer out { m_buffer.data(), m_buffer.size(), 0 };
+
+            const size_t rc = ZSTD_decompressStream(m_stream, &out, &input);
+            if (ZSTD_isError(rc))
+                throw std::runtime_error(std::string("Failed to decompress zstd compressed patch: ") + ZSTD_getErrorName(rc));
+
+            // Zero is only returned once a frame has been completely decoded and flushed.
+            m_frame_complete = rc == 0;
+
+            output.write(m_buffer.data(), out.pos);
+
+            if (input.pos == input.size && out.pos != out.size)
+                return;
+        }
+    }
+
+    void finish(File&) override
+    {
+        if (!m_frame_complete)
+            throw std::runtime_error("Unexpected end of zstd compressed patch");
+    }
+
+private:
+    ZSTD_DStream* m_stream;
+    bool m_frame_complete { false };
+};
+
+#endif
+
+std::unique_ptr<Decompressor> create_decompressor(Compression compression)
+{
+    switch (compression) {
+#ifdef PATCH_HAVE_ZLIB
+    case Compression::Gzip:
+        return std::unique_ptr<Decompressor>(new GzipDecompressor);
+#endif
+#ifdef PATCH_HAVE_LZMA
+    case Compression::Xz:
+        return std::unique_ptr<Decompressor>(new XzDecompressor);
+#endif
+#ifdef PATCH_HAVE_ZSTD
+    case Compression::Zstd:
+        return std::unique_ptr<Decompressor>(new ZstdDecompressor);
+#endif
+    default:
+        break;
+    }
+
+    return nullptr;
+}
+
+} // namespace
+
+void decompress(Compression compression, const InputReader& read, File& output)
+{
+    std::array<char, chunk_size> buffer;
+
+    if (compression == Compression::None) {
+        while (size_t n = read(buffer.data(), buffer.size()))
+            output.write(buffer.data(), n);
+        return;
+    }
+
+    auto decompressor = create_decompressor(compression);
+    if (!decompressor)
+        throw std::runtime_error(std::string("Unable to read ") + to_string(compression) + " compressed patch, support for it is not enabled in this build");
+
+    while (size_t n = read(buffer.data(), buffer.size()))
+        decompressor->decompress(buffer.data(), n, output);
+
+    decompressor->finish(output);
+}
+
+} // namespace Patch
@@ -0,0 +1,160 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#include <algorithm>
+#include <future>
+#include <patch/durability.h>
+#include <patch/file.h>
+#include <patch/system.h>
+#include <patch/thread_pool.h>
+#include <vector>
+
+namespace Patch {
+
+static std::string parent_directory(const std::string& path)
+{
+    const auto pos = path.find_last_of('/');
+    if (pos == std::string::npos)
+        return ".";
+    if (pos == 0)
+        return "/";
+    return path.substr(0, pos);
+}
+
+void DurableWrites::wrote(const std::string& path, File& file)
+{
+    if (!m_enabled)
+        return;
+
+    file.start_writeback();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_files.emplace(path, false);
+}
+
+void DurableWrites::changed_metadata(const std::string& path)
+{
+    if (!m_enabled)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_files[path] = true;
+}
+
+void DurableWrites::changed_entry(const std::string& path)
+{
+    if (!m_enabled)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Any of the parent directories may have been created or removed along with the path.
+    auto directory = path;
+    while (directory != "." && directory != "/") {
+        directory = parent_directory(directory);
+        if (!m_directories.insert(directory).second)
+            break;
+    }
+}
+
+void DurableWrites::renamed(const std::string& old_path, const std::string& new_path)
+{
+    if (!m_enabled)
+        return;
+
+    changed_entry(old_path);
+    changed_entry(new_path);
+
+    // Anything written to the old path now needs to be written out from the new one.
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_files.find(old_path);
+    if (it != m_files.end()) {
+        const bool include_metadata = it->second;
+        m_files.erase(it);
+        m_files[new_path] = include_metadata;
+    }
+}
+
+// Run the function for each of the given items, a number at a time. Syncing waits on the
+// disk rather than the CPU, so having more in flight lets the disk batch them together.
+template<typename Function>
+static void for_each_in_parallel(const std::vector<std::string>& items, Function function)
+{
+    constexpr size_t max_threads = 16;
+
+    if (items.size() < 2) {
+        for (const auto& item : items)
+            function(item);
+        return;
+    }
+
+    ThreadPool pool(std::min(items.size(), max_threads));
+
+    std::vector<std::future<void>> results;
+    results.reserve(items.size());
+    for (const auto& item : items)
+        results.push_back(pool.submit([&function, &item] { function(item); }));
+
+    for (auto& result : results)
+        result.get();
+}
+
+DurableWrites::Summary DurableWrites::sync()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Summary summary;
+    summary.files = m_files.size();
+    summary.directories = m_directories.size();
+
+    if (m_files.empty() && m_directories.empty())
+        return summary;
+
+    // Syncing the whole filesystem is cheaper than syncing many files one by one, but also
+    // waits for anything else written to it, so is only worth it for larger patches.
+    constexpr size_t min_files_to_sync_filesystem = 64;
+
+    if (m_files.size() >= min_files_to_sync_filesystem) {
+        std::unordered_set<std::string> directories = m_directories;
+        for (const auto& file : m_files)
+            directories.insert(parent_directory(file.first));
+
+        uintmax_t device = 0;
+        bool one_filesystem = true;
+        for (const auto& directory : directories) {
+            // A directory which has since been removed tells us nothing.
+            const auto id = filesystem::device_id(directory);
+            if (id == 0)
+                continue;
+            if (device != 0 && id != device) {
+                one_filesystem = false;
+                break;
+            }
+            device = id;
+        }
+
+        if (one_filesystem && device != 0 && filesystem::sync_filesystem(parent_directory(m_files.begin()->first))) {
+            summary.synced_filesystem = true;
+            return summary;
+        }
+    }
+
+    std::vector<std::string> paths;
+    paths.reserve(m_files.size());
+    for (const auto& file : m_files)
+        paths.push_back(file.first);
+
+    for_each_in_parallel(paths, [this](const std::string& path) {
+        filesystem::sync_file(path, m_files.at(path));
+    });
+
+    // Only once the content of each file is on disk are the entries for them written.
+    paths.assign(m_directories.begin(), m_directories.end());
+    for_each_in_parallel(paths, [](const std::string& path) {
+        filesystem::sync_directory(path);
+    });
+
+    return summary;
+}
+
+} // namespace Patch
@@ -3,6 +3,7 @@
 
 #include <array>
 #include <cstdio>
+#include <cstdlib>
 #include <patch/file.h>
 #include <patch/system.h>
 
@@ -38,14 +39,25 @@ File::~File()
 {
     if (m_file)
         std::fclose(m_file);
+#ifndef _WIN32
+    std::free(m_line_buffer);
+#endif
 }
 
 File::File(File&& other) noexcept
     : m_file(other.m_file)
     , m_is_bad(other.m_is_bad)
     , m_is_eof(other.m_is_eof)
+#ifndef _WIN32
+    , m_line_buffer(other.m_line_buffer)
+    , m_line_buffer_size(other.m_line_buffer_size)
+#endif
 {
     other.m_file = nullptr;
+#ifndef _WIN32
+    other.m_line_buffer = nullptr;
+    other.m_line_buffer_size = 0;
+#endif
 }
 
 File& File::operator=(File&& other) noexcept
@@ -59,10 +71,26 @@ File& File::operator=(File&& other) noexcept
         m_is_eof = other.m_is_eof;
 
         other.m_file = nullptr;
+
+#ifndef _WIN32
+        std::free(m_line_buffer);
+        m_line_buffer = other.m_line_buffer;
+        m_line_buffer_size = other.m_line_buffer_size;
+        other.m_line_buffer = nullptr;
+        other.m_line_buffer_size = 0;
+#endif
     }
     return *this;
 }
 
+File File::standard_stream(FILE* stream, std::ios_base::openmode mode)
+{
+    FILE* file = duplicate_file(stream, to_mode(mode));
+    if (!file)
+        throw std::system_error(errno, std::generic_category(), "Unable to open standard stream");
+    return File(file);
+}
+
 File File::create_temporary()
 {
     return File(create_temporary_file());
@@ -98,12 +126,36 @@ void File::copy_from(FILE* from, FILE* to)
     fflush(to, "Error occurred writing to file");
 }
 
+size_t File::read(char* buffer, size_t size)
+{
+    const auto n = std::fread(buffer, sizeof(char), size, m_file);
+    if (n == 0)
+        check_ferror(m_file, "Failed reading from file");
+    return n;
+}
+
+void File::rewind()
+{
+    std::rewind(m_file);
+    clear();
+}
+
 void File::write_entire_contents_to(FILE* file)
 {
     std::rewind(m_file);
     copy_from(m_file, file);
 }
 
+void File::copy_entire_contents_to(File& file)
+{
+    std::rewind(m_file);
+    if (filesystem::copy_file_contents(m_file, file.m_file))
+        return;
+
+    std::rewind(m_file);
+    copy_from(m_file, file.m_file);
+}
+
 File File::create_temporary(FILE* initial_content)
 {
     File file(create_temporary_file());
@@ -123,13 +175,19 @@ File File::create_temporary_with_content(const std::string& initial_content)
     return file;
 }
 
-FILE* File::cfile_open_impl(const std::string& path, std::ios_base::openmode mode)
+#ifndef _WIN32
+File File::from_memory(const char* content, size_t size)
 {
-#ifdef _WIN32
-    return _wfopen(to_native(path).c_str(), to_native(to_mode(mode)).c_str());
-#else
-    return std::fopen(path.c_str(), to_mode(mode).c_str());
+    FILE* file = fmemopen(const_cast<char*>(content), size, "r");
+    if (!file)
+        throw std::system_error(errno, std::generic_category(), "Unable to open file in memory");
+    return File(file);
+}
 #endif
+
+FILE* File::cfile_open_impl(const std::string& path, std::ios_base::openmode mode)
+{
+    return filesystem::fopen(path, to_mode(mode));
 }
 
 File::File(const std::string& path, std::ios_base::openmode mode)
@@ -159,6 +217,29 @@ void File::seekg(const fpos_t& pos)
         throw std::system_error(errno, std::generic_category(), "Unable to get file position");
 }
 
+int64_t File::offset()
+{
+#ifdef _WIN32
+    const auto offset = _ftelli64(m_file);
+#else
+    const auto offset = ftello(m_file);
+#endif
+    if (offset < 0)
+        throw std::system_error(errno, std::generic_category(), "Unable to get file position");
+    return static_cast<int64_t>(offset);
+}
+
+void File::seek_to_offset(int64_t offset)
+{
+#ifdef _WIN32
+    const int result = _fseeki64(m_file, offset, SEEK_SET);
+#else
+    const int result = fseeko(m_file, static_cast<off_t>(offset), SEEK_SET);
+#endif
+    if (result != 0)
+        throw std::system_error(errno, std::generic_category(), "Unable to set file position");
+}
+
 char File::peek()
 {
     int c = fgetc(m_file);
@@ -184,6 +265,7 @@ bool File::get_line(std::string& line, NewLine* newline)
         return false;
     }
 
+#ifdef _WIN32
     while (true) {
         int c = std::getc(m_file);
 
@@ -201,6 +283,25 @@ bool File::get_line(std::string& line, NewLine* newline)
 
         line.push_back(static_cast<char>(c));
     }
+#else
+    // getline(3) searches the stdio buffer for the end of the line in bulk, rather
+    // than us needing to retrieve the line one character at a time.
+    const auto length = ::getline(&m_line_buffer, &m_line_buffer_size, m_file);
+    if (length <= 0 || m_line_buffer[length - 1] != '\n') {
+        check_ferror(m_file, "Failed reading line from file");
+        if (newline)
+            *newline = NewLine::None;
+        m_is_eof = true;
+
+        if (length <= 0)
+            return false;
+
+        line.assign(m_line_buffer, static_cast<size_t>(length));
+        return true;
+    }
+
+    line.assign(m_line_buffer, static_cast<size_t>(length - 1));
+#endif
 
     if (!line.empty() && line.back() == '\r') {
         line.pop_back();
@@ -218,17 +319,20 @@ std::string File::read_all_as_string()
 {
     std::rewind(m_file);
 
+    // The size of the file is known from the open file, so the content does not need to
+    // grow as it is read. This is only a hint, as not every file knows its size.
     std::string content;
+    content.reserve(static_cast<size_t>(filesystem::file_size(m_file)));
+    std::array<char, 4096> buffer;
 
     while (true) {
-        int c = std::getc(m_file);
-
-        if (c == EOF) {
+        auto n = std::fread(buffer.data(), sizeof(char), buffer.size(), m_file);
+        if (n == 0) {
             check_ferror(m_file, "Failed reading character from file");
             break;
         }
 
-        content.push_back(static_cast<char>(c));
+        content.append(buffer.data(), n);
     }
 
     return content;
@@ -240,4 +344,20 @@ uintmax_t File::size()
     return filesystem::file_size(m_file);
 }
 
+filesystem::Status File::status()
+{
+    return filesystem::status(m_file);
+}
+
+void File::start_writeback()
+{
+    fflush(m_file, "Unable to flush file before writing it to disk");
+    filesystem::start_writeback(m_file);
+}
+
+bool File::is_in_memory()
+{
+    return filesystem::is_in_memory(m_file);
+}
+
 } // namespace Patch
@@ -1,12 +1,25 @@
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright 2022-2024 Shannon Booth <shannon.ml.booth@gmail.com>
 
+#include <algorithm>
 #include <patch/file.h>
 #include <patch/formatter.h>
 #include <patch/hunk.h>
 
 namespace Patch {
 
+// A line of a hunk, relabelled with the operation it has in one half of a context hunk.
+struct ContextLine {
+    ContextLine(char operation_, const LineView& line_)
+        : operation(operation_)
+        , line(&line_)
+    {
+    }
+
+    char operation;
+    const LineView* line;
+};
+
 void write_hunk_as_unified(const Hunk& hunk, File& out)
 {
     // Write hunk range
@@ -20,15 +33,17 @@ void write_hunk_as_unified(const Hunk& hunk, File& out)
 
     // Then body
     for (const auto& patch_line : hunk.lines) {
-        out << patch_line.operation << patch_line.line.content << '\n';
+        out << patch_line.operation;
+        out.write(patch_line.line.content.data(), patch_line.line.content.size());
+        out << '\n';
 
         if (patch_line.line.newline == NewLine::None)
             out << "\\ No newline at end of file\n";
     }
 }
 
-static void write_hunk_as_context(const std::vector<PatchLine>& old_lines, const Range& old_range,
-    const std::vector<PatchLine>& new_lines, const Range& new_range,
+static void write_hunk_as_context(const std::vector<ContextLine>& old_lines, const Range& old_range,
+    const std::vector<ContextLine>& new_lines, const Range& new_range,
     File& out)
 {
     out << "*** " << old_range.start_line;
@@ -37,10 +52,13 @@ static void write_hunk_as_context(const std::vector<PatchLine>& old_lines, const
     out << " ****\n";
 
     if (!old_lines.empty()) {
-        for (const auto& line : old_lines)
-            out << line.operation << ' ' << line.line.content << '\n';
+        for (const auto& line : old_lines) {
+            out << line.operation << ' ';
+            out.write(line.line->content.data(), line.line->content.size());
+            out << '\n';
+        }
 
-        if (old_lines.back().line.newline == NewLine::None)
+        if (old_lines.back().line->newline == NewLine::None)
             out << "\\ No newline at end of file\n";
     }
 
@@ -50,10 +68,13 @@ static void write_hunk_as_context(const std::vector<PatchLine>& old_lines, const
     out << " ----\n";
 
     if (!new_lines.empty()) {
-        for (const auto& line : new_lines)
-            out << line.operation << ' ' << line.line.content << '\n';
+        for (const auto& line : new_lines) {
+            out << line.operation << ' ';
+            out.write(line.line->content.data(), line.line->content.size());
+            out << '\n';
+        }
 
-        if (new_lines.back().line.newline == NewLine::None)
+        if (new_lines.back().line->newline == NewLine::None)
             out << "\\ No newline at end of file\n";
     }
 }
@@ -62,8 +83,10 @@ void write_hunk_as_context(const Hunk& hunk, File& out)
 {
     size_t new_lines_last = 0;
     size_t old_lines_last = 0;
-    std::vector<PatchLine> new_lines;
-    std::vector<PatchLine> old_lines;
+    std::vector<ContextLine> new_lines;
+    std::vector<ContextLine> old_lines;
+    new_lines.reserve(std::min(hunk.lines.size(), static_cast<size_t>(std::max<LineNumber>(hunk.new_file_range.number_of_lines, 0))));
+    old_lines.reserve(std::min(hunk.lines.size(), static_cast<size_t>(std::max<LineNumber>(hunk.old_file_range.number_of_lines, 0))));
 
     char operation = ' ';
     bool is_all_insertions = true;
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#include <cstring>
+#include <patch/line_buffer.h>
+#include <stdexcept>
+
+namespace Patch {
+
+LineBuffer::LineBuffer(std::string content, bool with_hashes)
+    : m_content(std::move(content))
+    , m_has_hashes(with_hashes)
+{
+    const bool wide = m_content.size() > std::numeric_limits<uint32_t>::max();
+    auto add_offset = [&](size_t offset) {
+        if (wide)
+            m_wide_offsets.push_back(offset);
+        else
+            m_offsets.push_back(static_cast<uint32_t>(offset));
+    };
+
+    const char* const data = m_content.data();
+    const char* begin = data;
+    const char* end = data + m_content.size();
+
+    while (begin != end) {
+        add_offset(static_cast<size_t>(begin - data));
+
+        const auto* newline_position = static_cast<const char*>(std::memchr(begin, '\n', static_cast<size_t>(end - begin)));
+        if (!newline_position) {
+            m_newlines.push_back(static_cast<uint8_t>(NewLine::None));
+            if (m_has_hashes)
+                m_hashes.push_back(hash(StringView(begin, end)));
+            begin = end;
+            break;
+        }
+
+        const char* line_end = newline_position;
+        NewLine newline = NewLine::LF;
+        if (line_end != begin && *(line_end - 1) == '\r') {
+            --line_end;
+            newline = NewLine::CRLF;
+        }
+
+        m_newlines.push_back(static_cast<uint8_t>(newline));
+        if (m_has_hashes)
+            m_hashes.push_back(hash(StringView(begin, line_end)));
+        begin = newline_position + 1;
+    }
+
+    add_offset(m_content.size());
+
+    for (const auto newline : m_newlines)
+        m_newline_kinds |= 1u << newline;
+}
+
+LineView LineBuffer::at(size_t index) const
+{
+    if (index >= size())
+        throw std::out_of_range("line is past the end of the file");
+    return (*this)[index];
+}
+
+uint32_t LineBuffer::hash(StringView content)
+{
+    // FNV-1a, which is more than good enough to tell most lines apart.
+    uint32_t hash = 2166136261u;
+    for (char c : content) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+} // namespace Patch
@@ -2,13 +2,14 @@
 // Copyright 2022 Shannon Booth <shannon.ml.booth@gmail.com>
 
 #include <algorithm>
+#include <limits>
 #include <patch/hunk.h>
 #include <patch/locator.h>
 #include <patch/utils.h>
 
 namespace Patch {
 
-bool matches_ignoring_whitespace(const std::string& as, const std::string& bs)
+bool matches_ignoring_whitespace(StringView as, StringView bs)
 {
     auto a = as.begin();
     auto b = bs.begin();
@@ -60,7 +61,7 @@ bool matches_ignoring_whitespace(const std::string& as, const std::string& bs)
     }
 }
 
-bool matches(const Line& line1, const Line& line2, bool ignore_whitespace)
+bool matches(LineView line1, LineView line2, bool ignore_whitespace)
 {
     bool newline_match = line1.newline == line2.newline;
     bool content_match = line1.content == line2.content;
@@ -80,6 +81,49 @@ bool matches(const Line& line1, const Line& line2, bool ignore_whitespace)
     return matches_ignoring_whitespace(line1.content, line2.content);
 }
 
+// The hashes of the lines of the hunk, if the content has hashes for them to be compared
+// with. Otherwise, there are none.
+static std::vector<uint32_t> hashes_of(const Hunk&, const std::vector<Line>&)
+{
+    return {};
+}
+
+static std::vector<uint32_t> hashes_of(const Hunk& hunk, const LineBuffer& content)
+{
+    std::vector<uint32_t> hashes;
+    if (!content.has_hashes())
+        return hashes;
+
+    hashes.reserve(hunk.lines.size());
+    for (const auto& hunk_line : hunk.lines)
+        hashes.push_back(LineBuffer::hash(hunk_line.line.content));
+    return hashes;
+}
+
+// Without ignoring whitespace, this is only an exact comparison of the lines.
+template<bool ignore_whitespace>
+static bool matches_line(LineView line, LineView hunk_line)
+{
+    if (ignore_whitespace)
+        return matches(line, hunk_line, true);
+    return line.newline == hunk_line.newline && line.content == hunk_line.content;
+}
+
+template<bool ignore_whitespace>
+static bool matches_line(const std::vector<Line>& content, size_t line, LineView hunk_line, const uint32_t*)
+{
+    return matches_line<ignore_whitespace>(content[line], hunk_line);
+}
+
+template<bool ignore_whitespace>
+static bool matches_line(const LineBuffer& content, size_t line, LineView hunk_line, const uint32_t* hunk_line_hash)
+{
+    // Lines which only match once whitespace is ignored may well have different hashes.
+    if (!ignore_whitespace && hunk_line_hash && content.hash(line) != *hunk_line_hash)
+        return false;
+    return matches_line<ignore_whitespace>(content[line], hunk_line);
+}
+
 LineNumber expected_line_number(const Hunk& hunk)
 {
     auto line = hunk.old_file_range.start_line;
@@ -88,7 +132,10 @@ LineNumber expected_line_number(const Hunk& hunk)
     return line;
 }
 
-Location locate_hunk(const std::vector<Line>& content, const Hunk& hunk, bool ignore_whitespace, LineNumber offset, LineNumber max_fuzz)
+// As locate_hunk, with whether whitespace is ignored as a template parameter so that it is
+// not checked for every line compared.
+template<bool ignore_whitespace, typename Lines>
+static Location locate_hunk_in(const Lines& content, const Hunk& hunk, LineNumber offset, LineNumber max_fuzz, LineNumber max_offset)
 {
     // Make a first best guess at where the from-file range is telling us where the hunk should be.
     LineNumber offset_guess = expected_line_number(hunk) - 1 + offset;
@@ -124,6 +171,15 @@ Location locate_hunk(const std::vector<Line>& content, const Hunk& hunk, bool ig
 
     LineNumber context = std::max(patch_prefix_content, patch_suffix_content);
 
+    // The lines of the hunk are only worth hashing once it has been compared with the lines
+    // at about as many places as it has lines, as it then may well be compared at many more.
+    std::vector<uint32_t> hunk_line_hashes;
+    size_t places_compared = 0;
+    auto compared_at_another_place = [&]() {
+        if (++places_compared == hunk.lines.size())
+            hunk_line_hashes = hashes_of(hunk, content);
+    };
+
     for (LineNumber fuzz = 0; fuzz <= max_fuzz; ++fuzz) {
 
         auto suffix_fuzz = std::max<LineNumber>(fuzz + patch_suffix_content - context, 0);
@@ -139,35 +195,43 @@ Location locate_hunk(const std::vector<Line>& content, const Hunk& hunk, bool ig
             line += prefix_fuzz;
 
             // Ensure that all of the lines in the hunk match starting from 'line'
-            return std::all_of(hunk.lines.begin() + prefix_fuzz, hunk.lines.end() - suffix_fuzz, [&](const PatchLine& hunk_line) {
+            for (size_t i = static_cast<size_t>(prefix_fuzz); i < hunk.lines.size() - static_cast<size_t>(suffix_fuzz); ++i) {
+                const auto& hunk_line = hunk.lines[i];
+
                 // Ignore additions in our increment of line and
                 // comparison as they are not part of the 'original file'
                 if (hunk_line.operation == '+')
-                    return true;
+                    continue;
 
                 if (static_cast<size_t>(line) >= content.size())
                     return false;
 
                 // Check whether this line matches what is specified in this part of the hunk.
-                if (!matches(content[static_cast<size_t>(line)], hunk_line.line, ignore_whitespace))
+                const uint32_t* hash = hunk_line_hashes.empty() ? nullptr : &hunk_line_hashes[i];
+                if (!matches_line<ignore_whitespace>(content, static_cast<size_t>(line), hunk_line.line, hash))
                     return false;
 
                 // Proceed to the next line.
                 ++line;
-                return true;
-            });
+            }
+            return true;
         };
 
+        const LineNumber last_line = max_offset < 0 ? std::numeric_limits<LineNumber>::max() : offset_guess + max_offset;
+        const LineNumber first_line = max_offset < 0 ? 0 : std::max<LineNumber>(offset_guess - max_offset, 0);
+
         // First look for the hunk in the forward direction
-        for (LineNumber line = offset_guess; static_cast<size_t>(line) < content.size(); ++line) {
+        for (LineNumber line = std::max<LineNumber>(offset_guess, 0); line <= last_line && static_cast<size_t>(line) < content.size(); ++line) {
             if (hunk_matches_starting_from_line(line))
                 return { line, fuzz, line - offset_guess };
+            compared_at_another_place();
         }
 
         // Then look for it in the negative direction
-        for (LineNumber line = offset_guess - 1; line >= 0; --line) {
+        for (LineNumber line = std::min<LineNumber>(offset_guess - 1, static_cast<LineNumber>(content.size()) - 1); line >= first_line; --line) {
             if (hunk_matches_starting_from_line(line))
                 return { line, fuzz, line - offset_guess };
+            compared_at_another_place();
         }
     }
 
@@ -175,16 +239,33 @@ Location locate_hunk(const std::vector<Line>& content, const Hunk& hunk, bool ig
     return {};
 }
 
-bool has_prerequisite(const Line& line, const std::string& prerequisite)
+template<typename Lines>
+Location locate_hunk(const Lines& content, const Hunk& hunk, bool ignore_whitespace, LineNumber offset, LineNumber max_fuzz, LineNumber max_offset)
+{
+    if (ignore_whitespace)
+        return locate_hunk_in<true>(content, hunk, offset, max_fuzz, max_offset);
+    return locate_hunk_in<false>(content, hunk, offset, max_fuzz, max_offset);
+}
+
+bool has_prerequisite(LineView line, const std::string& prerequisite)
 {
-    return line.content.find(prerequisite) != std::string::npos;
+    return prerequisite.empty()
+        || std::search(line.content.begin(), line.content.end(), prerequisite.begin(), prerequisite.end()) != line.content.end();
 }
 
-bool has_prerequisite(const std::vector<Line>& lines, const std::string& prerequisite)
+template<typename Lines>
+bool has_prerequisite(const Lines& lines, const std::string& prerequisite)
 {
-    return std::any_of(lines.begin(), lines.end(), [&prerequisite](const Line& line) {
-        return has_prerequisite(line, prerequisite);
-    });
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (has_prerequisite(LineView(lines[i]), prerequisite))
+            return true;
+    }
+    return false;
 }
 
+template Location locate_hunk(const std::vector<Line>&, const Hunk&, bool, LineNumber, LineNumber, LineNumber);
+template Location locate_hunk(const LineBuffer&, const Hunk&, bool, LineNumber, LineNumber, LineNumber);
+template bool has_prerequisite(const std::vector<Line>&, const std::string&);
+template bool has_prerequisite(const LineBuffer&, const std::string&);
+
 } // namespace Patch
@@ -13,6 +13,8 @@ const std::vector<CmdLineParser::Option> s_switches { {
     { 'F', "--fuzz", CmdLineParser::HasArgument::Yes },
     { 'N', "--forward", CmdLineParser::HasArgument::No },
     { 'R', "--reverse", CmdLineParser::HasArgument::No },
+    { 'T', "--set-time", CmdLineParser::HasArgument::No },
+    { 'Z', "--set-utc", CmdLineParser::HasArgument::No },
     { 'b', "--backup", CmdLineParser::HasArgument::No },
     { 'c', "--context", CmdLineParser::HasArgument::No },
     { 'd', "--directory", CmdLineParser::HasArgument::Yes },
@@ -38,6 +40,12 @@ const std::vector<CmdLineParser::Option> s_switches { {
     { CHAR_MAX + 7, "--no-backup-if-mismatch", CmdLineParser::HasArgument::No },
     { CHAR_MAX + 8, "--posix", CmdLineParser::HasArgument::No },
     { CHAR_MAX + 9, "--quoting-style", CmdLineParser::HasArgument::Yes },
+    { CHAR_MAX + 10, "--jobs", CmdLineParser::HasArgument::Yes },
+    { CHAR_MAX + 11, "--stats", CmdLineParser::HasArgument::No },
+    { CHAR_MAX + 12, "--durable", CmdLineParser::HasArgument::No },
+    { CHAR_MAX + 13, "--skip-unchanged", CmdLineParser::HasArgument::No },
+    { CHAR_MAX + 14, "--max-offset", CmdLineParser::HasArgument::Yes },
+    { CHAR_MAX + 15, "--filter", CmdLineParser::HasArgument::Yes },
 } };
 
 OptionHandler::OptionHandler()
@@ -66,6 +74,12 @@ void OptionHandler::process_option(int short_name, const std::string& option)
     case 'R':
         m_options.reverse_patch = true;
         break;
+    case 'T':
+        m_options.set_time = Options::SetTime::Local;
+        break;
+    case 'Z':
+        m_options.set_time = Options::SetTime::UTC;
+        break;
     case 'b':
         m_options.save_backup = true;
         break;
@@ -141,6 +155,29 @@ void OptionHandler::process_option(int short_name, const std::string& option)
     case CHAR_MAX + 9:
         handle_quoting_style(option);
         break;
+    case CHAR_MAX + 10:
+        m_options.jobs = stoi(option, "jobs count");
+        if (m_options.jobs < 1)
+            throw cmdline_parse_error("jobs count " + option + " is not a positive number");
+        break;
+    case CHAR_MAX + 11:
+        m_options.show_stats = true;
+        break;
+    case CHAR_MAX + 12:
+        m_options.durable = true;
+        break;
+    case CHAR_MAX + 13:
+        m_options.skip_unchanged = true;
+        break;
+    case CHAR_MAX + 14:
+        m_options.max_offset = stoi(option, "max offset");
+        if (m_options.max_offset < 0)
+            throw cmdline_parse_error("max offset " + option + " is negative");
+        break;
+    case CHAR_MAX + 15:
+        m_options.filter = true;
+        m_options.patch_file_path = option;
+        break;
     default:
         process_operand(option);
         break;
@@ -328,6 +365,15 @@ void show_usage(std::ostream& out)
            "    -f, --force\n"
            "                Do not prompt for input, try to apply patch as given.\n"
            "\n"
+           "    -T, --set-time\n"
+           "                Set the modification time of patched files to the time given in the patch, taking\n"
+           "                any time without a UTC offset to be in local time. The time is not set if the file\n"
+           "                did not have the time given for the original file, or if the patch did not apply\n"
+           "                perfectly, unless '--force' is given.\n"
+           "\n"
+           "    -Z, --set-utc\n"
+           "                As '--set-time', but taking any time without a UTC offset to be in UTC.\n"
+           "\n"
            "    -t, --batch\n"
            "                Assume patches are reversed if a reversed patch is detected. Do not apply patch file\n"
            "                if content given by 'Prereq' is missing in the original file.\n"
@@ -367,6 +413,33 @@ void show_usage(std::ostream& out)
            "    --posix\n"
            "                Change behavior to align with the POSIX standard.\n"
            "\n"
+           "    --jobs <number>\n"
+           "                Patch up to <number> files at the same time. Output is given in the same order as\n"
+           "                the patch file, and patches to the same file are still applied one after another.\n"
+           "                The patch file is also parsed on up to <number> threads.\n"
+           "\n"
+           "    --stats\n"
+           "                Once finished, write to stderr how long was spent parsing the patch, reading the files\n"
+           "                to patch, applying the patch and writing the result.\n"
+           "\n"
+           "    --durable\n"
+           "                Once everything has been written, wait for every file and directory changed to be\n"
+           "                flushed to disk, so that the changes are not lost after a crash or power failure.\n"
+           "\n"
+           "    --skip-unchanged\n"
+           "                Leave a file untouched (including its modification time) if patching it would not\n"
+           "                change its content, for example when every hunk was ignored.\n"
+           "\n"
+           "    --max-offset <lines>\n"
+           "                Only look for a hunk up to <lines> lines away from where the patch says it is. Files\n"
+           "                are then patched as they are read, only holding the lines where a hunk may be found,\n"
+           "                so that files larger than the memory available can be patched.\n"
+           "\n"
+           "    --filter <patch>\n"
+           "                Apply <patch>, which must change a single file, to stdin and write the result to\n"
+           "                stdout as it is read, using a '--max-offset' of 10000 lines unless one is given.\n"
+           "                Rejects are only saved if '--reject-file' is given.\n"
+           "\n"
            "    -d, --directory <directory>\n"
            "                Change the working directory to <directory> before applying the patch file.\n"
            "\n"
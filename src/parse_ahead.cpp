@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#include <array>
+#include <cstring>
+#include <patch/file.h>
+#include <patch/parse_ahead.h>
+#include <patch/string_view.h>
+
+namespace Patch {
+
+static std::string read_rest_of_file(File& file)
+{
+    std::string content;
+    std::array<char, 64 * 1024> buffer;
+    while (true) {
+        const auto n = file.read(buffer.data(), buffer.size());
+        if (n == 0)
+            break;
+        content.append(buffer.data(), n);
+    }
+    return content;
+}
+
+// A line which may be part of the header of a patch.
+static bool is_header_line(StringView line)
+{
+    return line.starts_with("diff ")
+        || line.starts_with("Index: ")
+        || line.starts_with("--- ")
+        || line.starts_with("*** ")
+        || line.starts_with("+++ ")
+        || line.starts_with("Prereq: ")
+        || line.starts_with("====");
+}
+
+static bool looks_like_patch_start(StringView line, StringView previous_line)
+{
+    if (!line.starts_with("diff ") && !line.starts_with("Index: ") && !line.starts_with("--- ") && !line.starts_with("*** "))
+        return false;
+
+    // The ranges of the hunks of a context diff look much the same as the start of a patch.
+    if (line.ends_with(" ****") || line.ends_with(" ----") || previous_line.starts_with("***************"))
+        return false;
+
+    // Only the first line of the header is where the patch starts.
+    return !is_header_line(previous_line);
+}
+
+std::vector<ParseAhead::Start> ParseAhead::find_starts(const std::string& content, size_t first_line_number)
+{
+    std::vector<Start> git_starts { { 0, first_line_number } };
+    std::vector<Start> starts { { 0, first_line_number } };
+
+    const char* begin = content.data();
+    const char* end = begin + content.size();
+    const char* line_begin = begin;
+    StringView previous_line;
+    size_t line_number = first_line_number;
+
+    while (line_begin != end) {
+        auto* newline = static_cast<const char*>(std::memchr(line_begin, '\n', static_cast<size_t>(end - line_begin)));
+        const char* line_end = newline ? newline : end;
+
+        StringView line(line_begin, line_end);
+        if (line.ends_with("\r"))
+            line = line.substr(0, line.size() - 1);
+
+        if (line_begin != begin) {
+            const Start start { line_begin - begin, line_number };
+            if (line.starts_with("diff --git "))
+                git_starts.push_back(start);
+            else if (looks_like_patch_start(line, previous_line))
+                starts.push_back(start);
+        }
+
+        previous_line = line;
+        ++line_number;
+        line_begin = newline ? newline + 1 : end;
+    }
+
+    // Every patch of a git diff starts with the same line, so nothing else needs to be guessed at.
+    return git_starts.size() > 1 ? git_starts : starts;
+}
+
+ParseAhead::ParseAhead(File& file, size_t line_number, Format format, int strip, size_t number_of_threads)
+    : m_offset(file.offset())
+    , m_content(read_rest_of_file(file))
+    , m_starts(find_starts(m_content, line_number))
+    , m_format(format)
+    , m_strip(strip)
+    , m_max_parsing(number_of_threads * 16)
+    , m_pool(number_of_threads)
+{
+    file.clear();
+    file.seek_to_offset(m_offset);
+
+    if (!m_content.empty())
+        parse_more();
+}
+
+ParseAhead::~ParseAhead() = default;
+
+ParseAhead::Parsed ParseAhead::parse(const Start& start) const
+{
+    Parsed parsed;
+    parsed.patch = Patch(m_format);
+
+#ifdef _WIN32
+    (void)start;
+#else
+    try {
+        File file = File::from_memory(m_content.data(), m_content.size());
+        file.seek_to_offset(start.offset);
+        Parser parser(file, start.line_number);
+
+        parsed.should_parse_body = parser.parse_patch_header(parsed.patch, parsed.info, m_strip);
+        if (parser.is_eof())
+            return parsed;
+
+        parsed.has_header = true;
+        parsed.header_end = m_offset + file.offset();
+        parsed.header_end_line_number = parser.line_number();
+
+        if (parsed.patch.format == Format::Unknown || !parsed.should_parse_body)
+            return parsed;
+
+        const Patch header = parsed.patch;
+        try {
+            parser.parse_patch_body(parsed.patch);
+        } catch (...) {
+            parsed.patch = header;
+            return parsed;
+        }
+
+        if (parser.is_eof()) {
+            parsed.patch = header;
+            return parsed;
+        }
+
+        parsed.has_body = true;
+        parsed.body_end = m_offset + file.offset();
+        parsed.body_end_line_number = parser.line_number();
+    } catch (...) {
+        // The parser reports the error itself once it gets here.
+    }
+#endif
+
+    return parsed;
+}
+
+void ParseAhead::parse_more()
+{
+    while (m_parsing.size() < m_max_parsing && m_next_start + m_parsing.size() < m_starts.size()) {
+        const auto start = m_starts[m_next_start + m_parsing.size()];
+        m_parsing.push_back(m_pool.submit([this, start] { return parse(start); }));
+    }
+}
+
+bool ParseAhead::take(int64_t offset, size_t line_number, Format format, int strip, Parsed& parsed)
+{
+    if (m_content.empty() || format != m_format || strip != m_strip)
+        return false;
+
+    // Whatever starts before where the parser has got to was a poor guess.
+    offset -= m_offset;
+    while (m_next_start < m_starts.size() && m_starts[m_next_start].offset < offset) {
+        ++m_next_start;
+        if (!m_parsing.empty())
+            m_parsing.pop_front();
+    }
+    parse_more();
+
+    if (m_next_start == m_starts.size() || m_starts[m_next_start].offset != offset || m_starts[m_next_start].line_number != line_number)
+        return false;
+
+    parsed = m_parsing.front().get();
+    m_parsing.pop_front();
+    ++m_next_start;
+    parse_more();
+    return true;
+}
+
+} // namespace Patch
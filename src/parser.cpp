@@ -3,8 +3,11 @@
 
 #include <algorithm>
 #include <cassert>
+#include <iterator>
 #include <limits>
+#include <patch/binary.h>
 #include <patch/hunk.h>
+#include <patch/parse_ahead.h>
 #include <patch/parser.h>
 #include <patch/system.h>
 #include <patch/utils.h>
@@ -81,7 +84,7 @@ bool LineParser::consume_line_number(LineNumber& output)
     if (!consume_uint())
         return false;
 
-    return string_to_line_number(std::string(start, m_current), output);
+    return string_to_line_number({ start, m_current }, output);
 }
 
 std::string LineParser::parse_quoted_string()
@@ -92,6 +95,14 @@ std::string LineParser::parse_quoted_string()
     consume_specific('"');
 
     while (!is_eof()) {
+        // Copy across the run of characters up until the next quote or escape in one go.
+        const auto* run_end = std::find_if(m_current, m_end, [](char c) { return c == '"' || c == '\\'; });
+        output.append(m_current, run_end);
+        m_current = run_end;
+
+        if (is_eof())
+            break;
+
         // Reached the end of the string
         if (peek() == '"')
             return output;
@@ -143,9 +154,6 @@ std::string LineParser::parse_quoted_string()
             default:
                 throw std::invalid_argument("Invalid or unsupported escape character in path " + std::string(begin, m_current));
             }
-        } else {
-            // Normal case - a character of the path we can just add to our output.
-            output += consume();
         }
     }
 
@@ -179,13 +187,13 @@ void LineParser::parse_file_line(int strip, std::string& path, std::string* time
 
         while (true) {
             if (it == m_end) {
-                path = std::string(begin, m_end);
+                path.assign(begin, m_end);
                 break;
             }
 
             // Must have reached the end of the path.
             if (*it == '\t') {
-                path = std::string(begin, it);
+                path.assign(begin, it);
                 break;
             }
 
@@ -194,10 +202,10 @@ void LineParser::parse_file_line(int strip, std::string& path, std::string* time
             if (*it == ' ') {
                 auto new_it = std::find(it, m_end, '\t');
                 if (new_it == m_end) {
-                    path = std::string(begin, it);
+                    path.assign(begin, it);
                 } else {
                     it = new_it;
-                    path = std::string(begin, new_it);
+                    path.assign(begin, new_it);
                 }
                 break;
             }
@@ -210,7 +218,7 @@ void LineParser::parse_file_line(int strip, std::string& path, std::string* time
     // Currently this may also include whitespace! (which depends on
     // how the path and timestamp were separated in the patch).
     if (timestamp && it != m_end && it + 1 != m_end)
-        *timestamp = std::string(it + 1, m_end);
+        timestamp->assign(it + 1, m_end);
 
     // We don't want /dev/null to become stripped, as this is a magic
     // name which we use to determine whether a file has been deleted
@@ -219,7 +227,7 @@ void LineParser::parse_file_line(int strip, std::string& path, std::string* time
         path = strip_path(path, strip);
 }
 
-bool string_to_line_number(const std::string& str, LineNumber& output)
+bool string_to_line_number(StringView str, LineNumber& output)
 {
     if (str.empty())
         return false;
@@ -242,7 +250,7 @@ bool string_to_line_number(const std::string& str, LineNumber& output)
     return true;
 }
 
-bool parse_unified_range(Hunk& hunk, const std::string& line)
+bool parse_unified_range(Hunk& hunk, StringView line)
 {
     LineParser parser(line);
 
@@ -288,7 +296,7 @@ bool parse_unified_range(Hunk& hunk, const std::string& line)
 // "%d , %d c %d , %d  ", <num1>, <num2>, <num3>, <num4>
 //
 // <num> is used to specify the start and end lines of the two files being diffed.
-bool parse_normal_range(Hunk& hunk, const std::string& line)
+bool parse_normal_range(Hunk& hunk, StringView line)
 {
     LineParser parser(line);
 
@@ -336,42 +344,77 @@ bool parse_normal_range(Hunk& hunk, const std::string& line)
     return parser.is_eof();
 }
 
-static uint16_t parse_mode(const std::string& mode_str)
+// Parse a command of an ed script as output by 'diff -e', in the forms:
+//
+// "%d a", <num>
+// "%d i", <num>
+// "%d c", <num>
+// "%d d", <num>
+// "%d , %d c", <num1>, <num2>
+// "%d , %d d", <num1>, <num2>
+bool parse_ed_command(EdCommand& command, StringView line)
+{
+    LineParser parser(line);
+
+    if (!parser.consume_line_number(command.start_line))
+        return false;
+
+    bool has_comma = parser.consume_specific(',');
+    if (has_comma) {
+        if (!parser.consume_line_number(command.end_line))
+            return false;
+    } else {
+        command.end_line = command.start_line;
+    }
+
+    command.command = parser.consume();
+    if (!parser.is_eof())
+        return false;
+
+    switch (command.command) {
+    case 'a':
+        // Appending to line 0 inserts at the start of the file.
+        return !has_comma;
+    case 'i':
+        return !has_comma && command.start_line > 0;
+    case 'c':
+    case 'd':
+        return command.start_line > 0 && command.start_line <= command.end_line;
+    default:
+        return false;
+    }
+}
+
+static uint16_t parse_mode(StringView mode_str)
 {
     // Ignore any mode strings which are not in the format which we expect.
 
     if (mode_str.size() != 6)
         return 0;
 
-    try {
-        size_t pos;
-        auto value = std::stoul(mode_str, &pos, 8);
-        if (pos != mode_str.size())
+    uint16_t value = 0;
+    for (char c : mode_str) {
+        if (!is_octal(c))
             return 0;
-
-        return static_cast<uint16_t>(value);
-    } catch (const std::exception&) {
-        // do nothing
+        value = static_cast<uint16_t>(value * 8 + (c - '0'));
     }
 
-    return 0;
+    return value;
 }
 
 bool LineParser::parse_git_extended_info(Patch& patch, int strip)
 {
-    auto parse_filename = [&](std::string& output, const std::string& prefix) {
+    auto parse_filename = [&](std::string& output, const char* prefix) {
         // NOTE: we do 'strip - 1' here as the extended headers do not come with a leading
         // "a/" or "b/" prefix - strip the filename as if this part is already stripped.
-        if (peek() == '"') {
-            output = parse_quoted_string();
-            output = strip_path(output, strip - 1);
-        } else {
-            output = strip_path(std::string(m_current, m_end), strip - 1);
-        }
+        if (peek() == '"')
+            output = strip_path(parse_quoted_string(), strip - 1);
+        else
+            output = strip_path(remaining(), strip - 1);
 
         // Special case - we're not stripping at all. So make sure to add on the "a/" or "b/" prefix.
         if (strip == 0)
-            output = prefix + output;
+            output.insert(0, prefix);
     };
 
     if (consume_specific("rename from ")) {
@@ -400,32 +443,42 @@ bool LineParser::parse_git_extended_info(Patch& patch, int strip)
 
     if (consume_specific("deleted file mode ")) {
         patch.operation = Operation::Delete;
-        patch.old_file_mode = parse_mode(std::string(m_current, m_end));
+        patch.old_file_mode = parse_mode(remaining());
         return true;
     }
 
     if (consume_specific("new file mode ")) {
         patch.operation = Operation::Add;
-        patch.new_file_mode = parse_mode(std::string(m_current, m_end));
+        patch.new_file_mode = parse_mode(remaining());
         return true;
     }
 
     if (consume_specific("old mode ")) {
-        patch.old_file_mode = parse_mode(std::string(m_current, m_end));
+        patch.old_file_mode = parse_mode(remaining());
         return true;
     }
 
     if (consume_specific("new mode ")) {
-        patch.new_file_mode = parse_mode(std::string(m_current, m_end));
+        patch.new_file_mode = parse_mode(remaining());
         return true;
     }
 
-    if (consume_specific("index "))
+    if (consume_specific("index ")) {
+        StringView ids = remaining();
+        const auto* ids_end = std::find(ids.begin(), ids.end(), ' ');
+        const char* separator = "..";
+        const auto* separator_position = std::search(ids.begin(), ids_end, separator, separator + 2);
+        if (separator_position != ids_end) {
+            patch.old_object_id.assign(ids.begin(), separator_position);
+            patch.new_object_id.assign(separator_position + 2, ids_end);
+        }
         return true;
+    }
 
-    // NOTE: GIT binary patch line not included as part of header info.
+    // NOTE: GIT binary patch line not included as part of header info,
+    //       it is instead the start of the body of the patch.
     if (consume_specific("GIT binary patch")) {
-        patch.operation = Operation::Binary;
+        patch.is_git_binary = true;
         return false;
     }
 
@@ -436,23 +489,93 @@ void LineParser::parse_git_header_name(Patch& patch, int strip)
 {
     std::string name;
     if (peek() == '"') {
-        name = parse_quoted_string();
+        name = strip_path(parse_quoted_string(), strip);
     } else {
-        while (!is_eof()) {
-            if (consume_specific(" b/"))
-                break;
-            name += consume();
-        }
+        StringView rest = remaining();
+        const char* separator = " b/";
+        const auto* name_end = std::search(rest.begin(), rest.end(), separator, separator + 3);
+        name = strip_path({ rest.begin(), name_end }, strip);
+        m_current = name_end == m_end ? m_end : name_end + 3;
     }
 
-    name = strip_path(name, strip);
     patch.old_file_path = name;
-    patch.new_file_path = name;
+    patch.new_file_path = std::move(name);
+}
+
+// Reserve room for the number of lines that a range header has told us to expect. This
+// is clamped so that a corrupt range is not able to trigger a huge allocation up front.
+static void reserve_lines(PatchLines& lines, LineNumber expected_lines)
+{
+    constexpr LineNumber max_lines_to_reserve = 1 << 16;
+    lines.reserve(static_cast<size_t>(std::max<LineNumber>(std::min(expected_lines, max_lines_to_reserve), 0)));
+}
+
+// The number of lines in a hunk is at most the sum of lines in the old and new ranges,
+// which is exact when (as in a normal diff) no lines are common to both.
+static void reserve_hunk_lines(PatchLines& lines, const Hunk& hunk)
+{
+    const auto old_lines = std::max<LineNumber>(hunk.old_file_range.number_of_lines, 0);
+    const auto new_lines = std::max<LineNumber>(hunk.new_file_range.number_of_lines, 0);
+    if (old_lines > std::numeric_limits<LineNumber>::max() - new_lines)
+        return;
+    reserve_lines(lines, old_lines + new_lines);
+}
+
+// The arena which the lines of the hunks of the patch are kept in.
+static Arena& arena_of(Patch& patch)
+{
+    if (!patch.arena)
+        patch.arena = std::make_shared<Arena>();
+    return *patch.arena;
 }
 
-Parser::Parser(File& file)
-    : m_file(file)
+// Move the lines parsed for a hunk into it, without any more room than they need. The
+// lines are parsed elsewhere first as it is only known how many there are once they have
+// all been parsed, and the room reserved while parsing is reused for the next hunk.
+static void take_hunk_lines(Hunk& hunk, PatchLines& lines, Arena& arena)
 {
+    hunk.lines = PatchLines(lines.begin(), lines.end(), ArenaAllocator<PatchLine>(&arena));
+    lines.clear();
+}
+
+Parser::Parser(File& file, size_t line_number)
+    : m_line_number(line_number)
+    , m_file(file)
+{
+}
+
+Parser::~Parser() = default;
+
+void Parser::parse_ahead(Format format, int strip, size_t number_of_threads)
+{
+#ifdef _WIN32
+    // There is no way to read a patch in memory as a File to parse it.
+    (void)format;
+    (void)strip;
+    (void)number_of_threads;
+#else
+    m_parse_ahead.reset(new ParseAhead(m_file, m_line_number, format, strip, number_of_threads));
+#endif
+}
+
+bool Parser::take_parsed_header(Patch& patch, PatchHeaderInfo& header_info, int strip, bool& should_parse_body)
+{
+    ParseAhead::Parsed parsed;
+    if (!m_parse_ahead->take(m_file.offset(), m_line_number, patch.format, strip, parsed) || !parsed.has_header)
+        return false;
+
+    patch = std::move(parsed.patch);
+    header_info = parsed.info;
+    header_info.patch_start = m_file.tellg();
+    should_parse_body = parsed.should_parse_body;
+
+    m_file.seek_to_offset(parsed.header_end);
+    m_line_number = parsed.header_end_line_number;
+
+    m_has_parsed_body = parsed.has_body;
+    m_parsed_body_end = parsed.body_end;
+    m_parsed_body_end_line_number = parsed.body_end_line_number;
+    return true;
 }
 
 bool Parser::get_line(std::string& line, NewLine* newline)
@@ -463,6 +586,11 @@ bool Parser::get_line(std::string& line, NewLine* newline)
     return true;
 }
 
+LineView Parser::patch_line_content(Arena& arena, const std::string& line, size_t prefix_length, NewLine newline)
+{
+    return { arena.copy(StringView(line).substr(prefix_length)), newline };
+}
+
 void Parser::print_header_info(const PatchHeaderInfo& header_info, std::ostream& out)
 {
     m_file.seekg(header_info.patch_start);
@@ -485,6 +613,12 @@ void Parser::print_header_info(const PatchHeaderInfo& header_info, std::ostream&
 
 bool Parser::parse_patch_header(Patch& patch, PatchHeaderInfo& header_info, int strip)
 {
+    m_has_parsed_body = false;
+
+    bool should_parse_body = true;
+    if (m_parse_ahead && take_parsed_header(patch, header_info, strip, should_parse_body))
+        return should_parse_body;
+
     header_info.patch_start = m_file.tellg();
 
     auto this_line_looks_like = Format::Unknown;
@@ -493,11 +627,13 @@ bool Parser::parse_patch_header(Patch& patch, PatchHeaderInfo& header_info, int
 
     size_t lines = 0;
     bool is_git_patch = false;
-    bool should_parse_body = true;
     Hunk hunk;
 
     auto start_line_number = m_line_number;
 
+    // Line of the first command which looks like it is part of an ed script.
+    size_t ed_script_start = 0;
+
     // Iterate through the input file looking for lines that look like a context, normal or unified diff.
     // If we do not know what the format is already, we use this information as a heuristic to determine
     // what the patch should be. Even if we already are told the format of the input patch, we still need
@@ -558,9 +694,27 @@ bool Parser::parse_patch_header(Patch& patch, PatchHeaderInfo& header_info, int
             continue;
         }
 
+        if (patch.is_git_binary) {
+            header_info.lines_till_first_hunk = lines;
+            break;
+        }
+
         // Try and determine where the fist hunk starts from. If we do not already know the format, also
         // make an attempt to determine what format this is.
 
+        // An ed script has no other markers to go by, so it is only assumed to be one if nothing
+        // else is found in the rest of the patch.
+        if (patch.format == Format::Unknown || patch.format == Format::Ed) {
+            EdCommand command;
+            if (parse_ed_command(command, line)) {
+                if (ed_script_start == 0)
+                    ed_script_start = lines;
+                if (patch.format == Format::Ed)
+                    break;
+                continue;
+            }
+        }
+
         if (patch.format == Format::Unknown || patch.format == Format::Unified) {
             if (last_line_looks_like == Format::Unified && (starts_with(line, "+") || starts_with(line, "-") || starts_with(line, " "))) {
                 // NOTE: We need to swap back the old and new lines. The old line was parsed as a new
@@ -614,8 +768,12 @@ bool Parser::parse_patch_header(Patch& patch, PatchHeaderInfo& header_info, int
         }
     }
 
-    if (is_git_patch)
+    if (is_git_patch) {
         patch.format = Format::Git;
+    } else if (patch.format == Format::Unknown || patch.format == Format::Ed) {
+        header_info.lines_till_first_hunk = ed_script_start;
+        patch.format = ed_script_start == 0 ? Format::Unknown : Format::Ed;
+    }
 
     m_file.clear();
     m_file.seekg(header_info.patch_start);
@@ -646,15 +804,27 @@ bool Parser::parse_patch_header(Patch& patch, PatchHeaderInfo& header_info, int
     return should_parse_body;
 }
 
-static Hunk hunk_from_context_parts(LineNumber old_start_line, const std::vector<PatchLine>& old_lines,
-    LineNumber new_start_line, const std::vector<PatchLine>& new_lines)
+static Hunk hunk_from_context_parts(LineNumber old_start_line, const PatchLines& old_lines,
+    LineNumber new_start_line, const PatchLines& new_lines, Arena& arena)
 {
     Hunk unified_hunk;
+    unified_hunk.lines = PatchLines(ArenaAllocator<PatchLine>(&arena));
     unified_hunk.old_file_range.start_line = old_start_line;
     unified_hunk.old_file_range.number_of_lines = 0;
     unified_hunk.new_file_range.start_line = new_start_line;
     unified_hunk.new_file_range.number_of_lines = 0;
 
+    // Context lines are in both parts (unless one was left out), but only once in the hunk.
+    size_t number_of_lines = old_lines.size();
+    if (old_lines.empty()) {
+        number_of_lines = new_lines.size();
+    } else {
+        number_of_lines += static_cast<size_t>(std::count_if(new_lines.begin(), new_lines.end(), [](const PatchLine& line) {
+            return line.operation != ' ';
+        }));
+    }
+    unified_hunk.lines.reserve(number_of_lines);
+
     size_t old_line_number = 0;
     size_t new_line_number = 0;
 
@@ -679,7 +849,7 @@ static Hunk hunk_from_context_parts(LineNumber old_start_line, const std::vector
             new_line_number++;
         } else if (old_line && old_line->operation == ' ' && new_line && new_line->operation == ' ') {
             if (old_line->line.content != new_line->line.content)
-                throw std::invalid_argument("Context patch line " + old_line->line.content + " does not match " + new_line->line.content);
+                throw std::invalid_argument("Context patch line " + old_line->line.content.to_string() + " does not match " + new_line->line.content.to_string());
             unified_hunk.lines.emplace_back(*old_line);
             unified_hunk.old_file_range.number_of_lines++;
             unified_hunk.new_file_range.number_of_lines++;
@@ -703,7 +873,7 @@ static Hunk hunk_from_context_parts(LineNumber old_start_line, const std::vector
     return unified_hunk;
 }
 
-static bool parse_context_range(LineNumber& start_line, LineNumber& end_line, const std::string& context_string)
+static bool parse_context_range(LineNumber& start_line, LineNumber& end_line, StringView context_string)
 {
     LineParser parser(context_string);
 
@@ -721,51 +891,56 @@ static bool parse_context_range(LineNumber& start_line, LineNumber& end_line, co
     return true;
 }
 
-void Parser::parse_context_hunk(std::vector<PatchLine>& old_lines, LineNumber& old_start_line, std::vector<PatchLine>& new_lines, LineNumber& new_start_line)
+void Parser::parse_context_hunk(ContextHunkPart& old_part, ContextHunkPart& new_part, Arena& arena, std::string& line)
 {
-    std::string line;
 
     LineNumber from_file_range_line_number = 0;
 
     LineNumber old_end_line = 0;
     LineNumber new_end_line = 0;
 
-    auto append_line = [&](std::vector<PatchLine>& lines, const std::string& content, NewLine newline) {
+    auto append_line = [&](ContextHunkPart& part, const std::string& content, NewLine newline) {
         if (content.size() < 2)
             throw std::invalid_argument("Unexpected empty patch line");
-        lines.emplace_back(content[0], Line(content.substr(2, content.size()), newline));
 
         if (content[1] == '-')
             throw parser_error("Premature '---' at line " + std::to_string(m_line_number - 1) + "; check line numbers at line " + std::to_string(from_file_range_line_number));
 
-        const auto& line = lines.back();
-        if (line.operation != ' ' && line.operation != '+' && line.operation != '-' && line.operation != '!') {
+        const char operation = content[0];
+        if (operation != ' ' && operation != '+' && operation != '-' && operation != '!') {
             std::ostringstream ss;
             ss << "malformed patch at line " << (m_line_number - 1) << ": " << content << '\n';
             throw parser_error(ss.str());
         }
+
+        ++part.number_of_lines;
+        if (operation != ' ')
+            ++part.number_of_changes;
+        if (!m_skip_line_content)
+            part.lines.emplace_back(operation, patch_line_content(arena, content, 2, newline));
     };
 
-    auto append_content = [&](std::vector<PatchLine>& lines, LineNumber start_line, LineNumber end_line) {
+    auto append_content = [&](ContextHunkPart& part, LineNumber end_line) {
         NewLine newline;
-        for (LineNumber i = start_line + static_cast<LineNumber>(lines.size()); i <= end_line; ++i) {
+        for (LineNumber i = part.start_line + static_cast<LineNumber>(part.number_of_lines); i <= end_line; ++i) {
             if (!get_line(line, &newline))
                 throw parser_error("context mangled in hunk at line " + std::to_string(from_file_range_line_number));
-            append_line(lines, line, newline);
+            append_line(part, line, newline);
         }
     };
 
-    auto check_for_no_newline = [&](std::vector<PatchLine>& lines) {
-        if (!lines.empty() && m_file.peek() == '\\') {
+    auto check_for_no_newline = [&](ContextHunkPart& part) {
+        if (part.number_of_lines != 0 && m_file.peek() == '\\') {
             get_line(line);
-            lines.back().line.newline = NewLine::None;
+            if (!part.lines.empty())
+                part.lines.back().line.newline = NewLine::None;
         }
     };
 
     auto parse_range = [&](LineNumber& start_line, LineNumber& end_line) {
         if (!starts_with(line, "--- ") || !ends_with(line, " ----"))
             return false;
-        if (!parse_context_range(start_line, end_line, line.substr(4, line.size() - 9)))
+        if (!parse_context_range(start_line, end_line, StringView(line).substr(4, line.size() - 9)))
             throw std::runtime_error("Invalid patch, unable to parse context range");
         return true;
     };
@@ -774,7 +949,7 @@ void Parser::parse_context_hunk(std::vector<PatchLine>& old_lines, LineNumber& o
     NewLine newline;
     while (get_line(line, &newline)) {
         if (starts_with(line, "*** ") && ends_with(line, " ****")) {
-            parse_context_range(old_start_line, old_end_line, line.substr(4, line.size() - 9));
+            parse_context_range(old_part.start_line, old_end_line, StringView(line).substr(4, line.size() - 9));
             from_file_range_line_number = m_line_number - 1;
             break;
         }
@@ -790,14 +965,16 @@ void Parser::parse_context_hunk(std::vector<PatchLine>& old_lines, LineNumber& o
     if (!get_line(line, &newline))
         throw std::runtime_error("Unable to retrieve line for context range");
 
-    if (!parse_range(new_start_line, new_end_line)) {
+    if (!parse_range(new_part.start_line, new_end_line)) {
         // Append in all of the expected lines that the range header told us to parse.
-        append_line(old_lines, line, newline);
-        append_content(old_lines, old_start_line, old_end_line);
-        check_for_no_newline(old_lines);
+        if (!m_skip_line_content)
+            reserve_lines(old_part.lines, old_end_line - old_part.start_line + 1);
+        append_line(old_part, line, newline);
+        append_content(old_part, old_end_line);
+        check_for_no_newline(old_part);
 
         get_line(line, &newline);
-        if (!parse_range(new_start_line, new_end_line))
+        if (!parse_range(new_part.start_line, new_end_line))
             throw std::runtime_error("Could not parse expected range!");
 
         get_line(line, &newline);
@@ -807,51 +984,165 @@ void Parser::parse_context_hunk(std::vector<PatchLine>& old_lines, LineNumber& o
         // Check if we have a 'to-file' that has been omitted, and we have reached the next patch.
         if (starts_with(line, "**********"))
             return;
-        append_line(new_lines, line, newline);
+        append_line(new_part, line, newline);
     }
 
-    append_content(new_lines, new_start_line, new_end_line);
-    check_for_no_newline(new_lines);
+    if (!m_skip_line_content)
+        reserve_lines(new_part.lines, new_end_line - new_part.start_line + 1);
+    append_content(new_part, new_end_line);
+    check_for_no_newline(new_part);
 }
 
-Patch Parser::parse_context_patch(Patch& patch)
+// The hunk for a context hunk whose lines were only counted. Either part may have been left
+// out, in which case the other part has every line of the hunk.
+static Hunk hunk_from_counted_context_parts(LineNumber old_start_line, size_t old_lines, size_t old_changes,
+    LineNumber new_start_line, size_t new_lines, size_t new_changes)
 {
-    while (true) {
-        std::vector<PatchLine> old_lines;
-        std::vector<PatchLine> new_lines;
-        LineNumber old_start_line = 0;
-        LineNumber new_start_line = 0;
+    Hunk hunk;
+    hunk.old_file_range.start_line = old_start_line;
+    hunk.old_file_range.number_of_lines = static_cast<LineNumber>(old_lines != 0 ? old_lines : new_lines - new_changes);
+    hunk.new_file_range.start_line = new_start_line;
+    hunk.new_file_range.number_of_lines = static_cast<LineNumber>(new_lines != 0 ? new_lines : old_lines - old_changes);
+    return hunk;
+}
+
+void Parser::parse_context_patch(Patch& patch)
+{
+    auto& arena = arena_of(patch);
+    ContextHunkPart old_part;
+    ContextHunkPart new_part;
+    std::string line;
 
-        parse_context_hunk(old_lines, old_start_line, new_lines, new_start_line);
+    while (true) {
+        old_part.clear();
+        new_part.clear();
+        parse_context_hunk(old_part, new_part, arena, line);
 
-        Hunk hunk = hunk_from_context_parts(old_start_line, old_lines, new_start_line, new_lines);
-        patch.hunks.push_back(hunk);
+        if (m_skip_line_content) {
+            patch.hunks.push_back(hunk_from_counted_context_parts(old_part.start_line, old_part.number_of_lines, old_part.number_of_changes,
+                new_part.start_line, new_part.number_of_lines, new_part.number_of_changes));
+        } else {
+            patch.hunks.push_back(hunk_from_context_parts(old_part.start_line, old_part.lines, new_part.start_line, new_part.lines, arena));
+        }
 
         auto pos = m_file.tellg();
-        std::string line;
         get_line(line);
         m_file.seekg(pos);
 
         if (!starts_with(line, "***"))
-            return patch;
+            return;
     }
 }
 
+PatchBodyRange Parser::skip_patch_body(Patch& patch)
+{
+    PatchBodyRange body;
+    body.start = m_file.tellg();
+    body.start_line_number = m_line_number;
+
+    m_skip_line_content = true;
+    try {
+        parse_patch_body(patch);
+    } catch (...) {
+        m_skip_line_content = false;
+        throw;
+    }
+    m_skip_line_content = false;
+
+    body.end = m_file.tellg();
+    body.end_line_number = m_line_number;
+    return body;
+}
+
+void Parser::parse_skipped_patch_body(Patch& patch, const PatchBodyRange& body)
+{
+    const auto position = m_file.tellg();
+    const auto line_number = m_line_number;
+
+    patch.hunks.clear();
+    patch.ed_commands.clear();
+    patch.binary_hunks.clear();
+
+    m_file.clear();
+    m_file.seekg(body.start);
+    m_line_number = body.start_line_number;
+    parse_patch_body(patch);
+
+    m_file.clear();
+    m_file.seekg(position);
+    m_line_number = line_number;
+}
+
+void Parser::parse_git_binary_patch(Patch& patch)
+{
+    std::string line;
+    if (!get_line(line) || line != "GIT binary patch")
+        throw parser_error("Expected git binary patch at line " + std::to_string(m_line_number - 1));
+
+    while (patch.binary_hunks.size() < 2) {
+        auto pos = m_file.tellg();
+        if (!get_line(line))
+            break;
+
+        BinaryHunk hunk;
+        LineParser parser(line);
+        if (parser.consume_specific("literal ")) {
+            hunk.type = BinaryHunk::Type::Literal;
+        } else if (parser.consume_specific("delta ")) {
+            hunk.type = BinaryHunk::Type::Delta;
+        } else {
+            --m_line_number;
+            m_file.seekg(pos);
+            break;
+        }
+
+        LineNumber size;
+        if (!string_to_line_number(parser.remaining(), size) || size < 0)
+            throw parser_error("corrupt binary patch at line " + std::to_string(m_line_number - 1) + ": " + line);
+        hunk.size = static_cast<uint64_t>(size);
+
+        // The data of the hunk is given until an empty line.
+        while (get_line(line) && !line.empty()) {
+            if (!m_skip_line_content && !decode_base85_line(line, hunk.data))
+                throw parser_error("corrupt binary patch at line " + std::to_string(m_line_number - 1) + ": " + line);
+        }
+
+        patch.binary_hunks.push_back(std::move(hunk));
+    }
+
+    if (patch.binary_hunks.empty())
+        throw parser_error("git binary patch without any data at line " + std::to_string(m_line_number - 1));
+}
+
 void Parser::parse_patch_body(Patch& patch)
 {
-    if (patch.format == Format::Unified || patch.format == Format::Git)
+    // The hunks of a patch parsed ahead were taken along with its header.
+    if (m_has_parsed_body) {
+        m_has_parsed_body = false;
+        m_file.seek_to_offset(m_parsed_body_end);
+        m_line_number = m_parsed_body_end_line_number;
+        return;
+    }
+
+    if (patch.is_git_binary)
+        parse_git_binary_patch(patch);
+    else if (patch.format == Format::Unified || patch.format == Format::Git)
         parse_unified_patch(patch);
     else if (patch.format == Format::Context)
         parse_context_patch(patch);
     else if (patch.format == Format::Normal)
         parse_normal_patch(patch);
+    else if (patch.format == Format::Ed)
+        parse_ed_patch(patch);
     else
         throw std::runtime_error("Unable to determine patch format");
 }
 
-Patch Parser::parse_unified_patch(Patch& patch)
+void Parser::parse_unified_patch(Patch& patch)
 {
+    auto& arena = arena_of(patch);
     Hunk hunk;
+    PatchLines lines;
     std::string line;
 
     enum class State {
@@ -875,6 +1166,8 @@ Patch Parser::parse_unified_patch(Patch& patch)
                 state = State::Content;
                 old_lines_expected = hunk.old_file_range.number_of_lines;
                 new_lines_expected = hunk.new_file_range.number_of_lines;
+                if (!m_skip_line_content)
+                    reserve_hunk_lines(lines, hunk);
             }
             break;
         }
@@ -889,13 +1182,15 @@ Patch Parser::parse_unified_patch(Patch& patch)
                 throw parser_error(ss.str());
             }
 
-            hunk.lines.emplace_back(what, Line(line.substr(1), newline));
+            if (!m_skip_line_content)
+                lines.emplace_back(what, patch_line_content(arena, line, 1, newline));
 
             if (what != '-') {
                 --new_lines_expected;
                 // At end of file for 'to', and found a '\ No newline at end of file'
                 if (new_lines_expected == 0 && m_file.peek() == '\\') {
-                    hunk.lines.back().line.newline = NewLine::None;
+                    if (!lines.empty())
+                        lines.back().line.newline = NewLine::None;
                     get_line(line);
                 }
             }
@@ -904,14 +1199,16 @@ Patch Parser::parse_unified_patch(Patch& patch)
                 --old_lines_expected;
                 // At end of file for 'old', and found a '\ No newline at end of file'
                 if (old_lines_expected == 0 && m_file.peek() == '\\') {
-                    hunk.lines.back().line.newline = NewLine::None;
+                    if (!lines.empty())
+                        lines.back().line.newline = NewLine::None;
                     get_line(line);
                 }
             }
 
             // We've found everything for the current hunk that we expect.
             if (old_lines_expected == 0 && new_lines_expected == 0) {
-                patch.hunks.push_back(hunk);
+                take_hunk_lines(hunk, lines, arena);
+                patch.hunks.push_back(std::move(hunk));
                 hunk.lines.clear();
 
                 // If we can spot another hunk on the next line, continue
@@ -919,17 +1216,19 @@ Patch Parser::parse_unified_patch(Patch& patch)
                 // this patch.
                 auto pos = m_file.tellg();
                 if (!get_line(line))
-                    return patch;
+                    return;
 
                 if (!parse_unified_range(hunk, line)) {
                     --m_line_number;
                     m_file.seekg(pos);
-                    return patch;
+                    return;
                 }
 
                 state = State::Content;
                 old_lines_expected = hunk.old_file_range.number_of_lines;
                 new_lines_expected = hunk.new_file_range.number_of_lines;
+                if (!m_skip_line_content)
+                    reserve_hunk_lines(lines, hunk);
             }
 
             break;
@@ -941,18 +1240,18 @@ Patch Parser::parse_unified_patch(Patch& patch)
     // extended format may be the only operation that is being undertaken for this
     // patch.
     if (state == State::InitialHunkContext && patch.hunks.empty())
-        return patch;
+        return;
 
     if (new_lines_expected != 0)
         throw std::invalid_argument("Expected 0 lines left in 'to', got " + std::to_string(new_lines_expected));
     if (old_lines_expected != 0)
         throw std::invalid_argument("Expected 0 lines left in 'old', got " + std::to_string(old_lines_expected));
 
-    return patch;
 }
 
-Patch Parser::parse_normal_patch(Patch& patch)
+void Parser::parse_normal_patch(Patch& patch)
 {
+    auto& arena = arena_of(patch);
     NewLine newline;
     std::string patch_line;
 
@@ -965,6 +1264,11 @@ Patch Parser::parse_normal_patch(Patch& patch)
         if (!parse_normal_range(current_hunk, patch_line))
             throw std::invalid_argument("Unable to parse normal range command: " + patch_line);
 
+        if (!m_skip_line_content) {
+            current_hunk.lines = PatchLines(ArenaAllocator<PatchLine>(&arena));
+            reserve_hunk_lines(current_hunk.lines, current_hunk);
+        }
+
         for (LineNumber i = 0; i < current_hunk.old_file_range.number_of_lines; ++i) {
             if (!get_line(patch_line, &newline))
                 throw parser_error("unexpected end of file in patch at line " + std::to_string(m_line_number - 1));
@@ -972,12 +1276,14 @@ Patch Parser::parse_normal_patch(Patch& patch)
             if (patch_line.size() < 2 || patch_line[0] != '<' || !is_whitespace(patch_line[1]))
                 throw parser_error("'<' followed by space or tab expected at line " + std::to_string(m_line_number - 1) + " of patch");
 
-            current_hunk.lines.emplace_back('-', Line(patch_line.substr(2, patch_line.size()), newline));
+            if (!m_skip_line_content)
+                current_hunk.lines.emplace_back('-', patch_line_content(arena, patch_line, 2, newline));
         }
 
         if (m_file.peek() == '\\') {
             get_line(patch_line, &newline);
-            current_hunk.lines.back().line.newline = NewLine::None;
+            if (!current_hunk.lines.empty())
+                current_hunk.lines.back().line.newline = NewLine::None;
         }
 
         // Expect --- if 'c' command
@@ -992,15 +1298,66 @@ Patch Parser::parse_normal_patch(Patch& patch)
             if (patch_line.size() < 2 || patch_line[0] != '>' || !is_whitespace(patch_line[1]))
                 throw parser_error("'>' followed by space or tab expected at line " + std::to_string(m_line_number - 1) + " of patch");
 
-            current_hunk.lines.emplace_back('+', Line(patch_line.substr(2, patch_line.size()), newline));
+            if (!m_skip_line_content)
+                current_hunk.lines.emplace_back('+', patch_line_content(arena, patch_line, 2, newline));
         }
 
         if (m_file.peek() == '\\') {
             get_line(patch_line, &newline);
-            current_hunk.lines.back().line.newline = NewLine::None;
+            if (!current_hunk.lines.empty())
+                current_hunk.lines.back().line.newline = NewLine::None;
+        }
+    }
+}
+
+void Parser::parse_ed_patch(Patch& patch)
+{
+    NewLine newline;
+    std::string line;
+
+    // How many lines of text the last command has been given. These are only counted (and
+    // not kept) when skipping over the body of the patch.
+    size_t number_of_text_lines = 0;
+
+    while (true) {
+        auto pos = m_file.tellg();
+        if (!get_line(line))
+            break;
+
+        EdCommand command;
+        if (parse_ed_command(command, line)) {
+            patch.ed_commands.push_back(std::move(command));
+            number_of_text_lines = 0;
+        } else if (line == "s/.//" || line == "s/^\\.\\././") {
+            // A line of text which is only a '.' can not be given directly as it would end the
+            // text, so diff writes it as '..' followed by a substitution to remove the extra dot.
+            if (number_of_text_lines == 0)
+                throw parser_error("ed substitution without any text to change at line " + std::to_string(m_line_number - 1));
+            if (!m_skip_line_content)
+                patch.ed_commands.back().lines.back().content = ".";
+            continue;
+        } else if (line == "a" && number_of_text_lines != 0) {
+            // Continue appending after the line which has just been substituted.
+        } else {
+            --m_line_number;
+            m_file.seekg(pos);
+            break;
+        }
+
+        auto& current = patch.ed_commands.back();
+        if (current.command == 'd')
+            continue;
+
+        while (true) {
+            if (!get_line(line, &newline))
+                throw parser_error("unexpected end of file in ed script at line " + std::to_string(m_line_number - 1));
+            if (line == ".")
+                break;
+            ++number_of_text_lines;
+            if (!m_skip_line_content)
+                current.lines.emplace_back(line, newline);
         }
     }
-    return patch;
 }
 
 Patch parse_patch(File& file, Format format, int strip)
@@ -1014,12 +1371,14 @@ Patch parse_patch(File& file, Format format, int strip)
     return patch;
 }
 
-std::string strip_path(const std::string& path, int amount)
+std::string strip_path(StringView path, int amount)
 {
     // A negative strip count (the default) indicates that we use the basename of the filepath.
     const bool use_basename = amount < 0;
-    if (use_basename)
-        return filesystem::basename(path);
+    if (use_basename) {
+        const auto last_seperator = std::find_if(std::reverse_iterator<const char*>(path.end()), std::reverse_iterator<const char*>(path.begin()), filesystem::is_seperator);
+        return { last_seperator.base(), path.end() };
+    }
 
     int remaining_to_strip = amount;
     auto stripped_begin = path.begin();
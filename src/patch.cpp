@@ -2,38 +2,66 @@
 // Copyright 2022-2024 Shannon Booth <shannon.ml.booth@gmail.com>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <climits>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <exception>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <patch/applier.h>
+#include <patch/binary.h>
 #include <patch/cmdline.h>
+#include <patch/compression.h>
+#include <patch/durability.h>
 #include <patch/file.h>
 #include <patch/hunk.h>
+#include <patch/line_buffer.h>
 #include <patch/locator.h>
 #include <patch/options.h>
 #include <patch/parser.h>
 #include <patch/patch.h>
+#include <patch/spsc_queue.h>
+#include <patch/stat_cache.h>
 #include <patch/system.h>
+#include <patch/thread_pool.h>
+#include <patch/timestamp.h>
+#include <patch/write_behind.h>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <system_error>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace Patch {
 
-static std::vector<Line> file_as_lines(File& input_file)
+// Past this many hunks, the lines of a file are hashed as they are read in so that the
+// many lines compared when searching for each hunk are mostly told apart by their hash.
+static constexpr size_t hunks_to_hash_lines_for = 4;
+
+// Files written once patching has finished are written this many at a time, as most of the
+// time taken writing each of them is spent waiting on the filesystem.
+static constexpr size_t write_behind_threads = 4;
+
+static LineBuffer file_as_lines(File& input_file, bool with_hashes = false)
 {
-    std::vector<Line> lines;
-    NewLine newline;
-    std::string line;
-    while (input_file.get_line(line, &newline))
-        lines.emplace_back(line, newline);
+    if (!input_file)
+        return {};
 
-    return lines;
+    // Read the file in one go, so that each line only refers to where it is in there
+    // rather than having its content allocated separately.
+    return LineBuffer(input_file.read_all_as_string(), with_hashes);
 }
 
 std::string to_string(Format format)
@@ -55,8 +83,18 @@ std::string to_string(Format format)
     throw std::invalid_argument("Unknown diff format");
 }
 
+// Set on the threads applying patches in the background with --jobs. Asking the user
+// a question from one of these threads throws instead, so that the patch can be applied
+// again from the main thread once all of the output before it has been written.
+static thread_local bool s_prompts_deferred = false;
+
+struct prompt_deferred { };
+
 bool check_with_user(const std::string& question, std::ostream& out, Default default_response)
 {
+    if (s_prompts_deferred)
+        throw prompt_deferred();
+
     char default_char = default_response == Default::True ? 'y' : 'n';
     out << question << " [" << default_char << "] " << std::flush;
 
@@ -68,7 +106,7 @@ bool check_with_user(const std::string& question, std::ostream& out, Default def
     return is_truthy;
 }
 
-static std::string guess_filepath(const Patch& patch)
+static std::string guess_filepath(const Patch& patch, StatCache& stat_cache)
 {
     // POSIX specifies that after stripping using the '-p' option then the existence of both the old
     // and new files are tested. If both paths exist then patch should not be able to determine
@@ -83,13 +121,13 @@ static std::string guess_filepath(const Patch& patch)
     // For now, this implementation matches the GNU behaviour when the --posix flag is specified. In
     // the future, we may want to make our implementation match whatever the behaviour of GNU patch
     // is for this path determination.
-    if (patch.old_file_path != "/dev/null" && filesystem::exists(patch.old_file_path))
+    if (patch.old_file_path != "/dev/null" && stat_cache.exists(patch.old_file_path))
         return patch.old_file_path;
 
-    if (patch.new_file_path != "/dev/null" && filesystem::exists(patch.new_file_path))
+    if (patch.new_file_path != "/dev/null" && stat_cache.exists(patch.new_file_path))
         return patch.new_file_path;
 
-    if (patch.index_file_path != "/dev/null" && filesystem::exists(patch.index_file_path))
+    if (patch.index_file_path != "/dev/null" && stat_cache.exists(patch.index_file_path))
         return patch.index_file_path;
 
     if (patch.operation == Operation::Add)
@@ -132,16 +170,63 @@ static Format diff_format_from_options(const Options& options)
     else if (options.interpret_as_unified)
         format = Format::Unified;
     else if (options.interpret_as_ed)
-        throw std::invalid_argument("ed format patches are not supported by this version of patch");
+        format = Format::Ed;
     return format;
 }
 
+// Resolves relative paths from the directory given with -d (or the working directory) for the
+// rest of the run. Setting the base directory also forgets any directories looked up before,
+// so nothing about them is kept from one run to the next, in case the working directory has
+// changed in between.
+class BaseDirectory {
+public:
+    explicit BaseDirectory(const std::string& path)
+    {
+        set_base_directory(path);
+    }
+
+    ~BaseDirectory()
+    {
+        set_base_directory("");
+    }
+
+    BaseDirectory(const BaseDirectory&) = delete;
+    BaseDirectory& operator=(const BaseDirectory&) = delete;
+};
+
 class PatchFile {
 public:
     explicit PatchFile(const Options& options)
     {
+        // A compressed patch is decompressed as it is read into a temporary file, as the
+        // parser needs to be able to seek backwards in the patch.
+        std::array<char, 6> magic;
+
         if (options.patch_file_path.empty() || options.patch_file_path == "-") {
-            m_patch_file = File::create_temporary(stdin);
+            // Standard input needs to be copied to a temporary file regardless. The magic bytes
+            // have already been consumed by the time the compression is known, so replay them.
+            size_t magic_size = std::fread(magic.data(), sizeof(char), magic.size(), stdin);
+            if (magic_size != magic.size() && std::ferror(stdin))
+                throw std::system_error(errno, std::generic_category(), "Failed reading patch from standard input");
+
+            size_t replayed = 0;
+            auto read = [&](char* buffer, size_t size) -> size_t {
+                if (replayed != magic_size) {
+                    const size_t n = std::min(size, magic_size - replayed);
+                    std::copy(magic.data() + replayed, magic.data() + replayed + n, buffer);
+                    replayed += n;
+                    return n;
+                }
+
+                const size_t n = std::fread(buffer, sizeof(char), size, stdin);
+                if (n == 0 && std::ferror(stdin))
+                    throw std::system_error(errno, std::generic_category(), "Failed reading patch from standard input");
+                return n;
+            };
+
+            m_patch_file = File::create_temporary();
+            decompress(detect_compression({ magic.data(), magic_size }), read, m_patch_file);
+            m_patch_file.rewind();
         } else {
             std::ios::openmode mode = std::ios::in | std::ios::out;
             if (options.newline_output != Options::NewlineOutput::Native)
@@ -150,6 +235,17 @@ public:
             m_patch_file.open(options.patch_file_path, mode);
             if (!m_patch_file)
                 throw std::system_error(errno, std::generic_category(), "Can't open patch file " + options.patch_file_path + " ");
+
+            const auto compression = detect_compression({ magic.data(), m_patch_file.read(magic.data(), magic.size()) });
+            m_patch_file.rewind();
+
+            if (compression != Compression::None) {
+                File decompressed = File::create_temporary();
+                decompress(
+                    compression, [this](char* buffer, size_t size) { return m_patch_file.read(buffer, size); }, decompressed);
+                decompressed.rewind();
+                m_patch_file = std::move(decompressed);
+            }
         }
     }
 
@@ -183,19 +279,42 @@ static void inform_hunks_failed(std::ostream& out, const char* reason, const std
     out << ' ' << reason;
 }
 
-static void refuse_to_patch(std::ostream& out, std::ios_base::openmode mode, const std::string& output_file, const Patch& patch, const Options& options)
+// The body of a patch which has been refused, which is only parsed if there are rejects to write.
+struct RefusedPatchBody {
+    Parser& parser;
+    bool skipped;
+    PatchBodyRange range;
+};
+
+static RefusedPatchBody skip_refused_patch_body(Parser& parser, Patch& patch, bool should_parse_body)
+{
+    RefusedPatchBody body { parser, should_parse_body, {} };
+    if (should_parse_body)
+        body.range = parser.skip_patch_body(patch);
+    return body;
+}
+
+static void refuse_to_patch(std::ostream& out, std::ios_base::openmode mode, const std::string& output_file, Patch& patch, const RefusedPatchBody& body, const Options& options, StatCache& stat_cache, DurableWrites& durable_writes)
 {
     out << " refusing to patch\n";
     inform_hunks_failed(out, "ignored", patch.hunks, patch.hunks.size());
 
     if (!options.dry_run) {
+        // The hunks of a refused patch are all written to the reject file.
+        if (body.skipped)
+            body.parser.parse_skipped_patch_body(patch, body.range);
+
         const auto reject_file = reject_path(options, output_file);
         out << " -- saving rejects to file " << reject_file;
         File file(reject_file, mode | std::ios::trunc);
+        stat_cache.invalidate(reject_file);
 
         RejectWriter reject_writer(patch, file, options.reject_format);
         for (const auto& hunk : patch.hunks)
             reject_writer.write_reject_file(hunk);
+
+        durable_writes.wrote(reject_file, file);
+        durable_writes.changed_entry(reject_file);
     }
     out << '\n';
 }
@@ -301,8 +420,10 @@ void check_prerequisite_handling(std::ostream& out, const Options& options, cons
 
 class Backup {
 public:
-    explicit Backup(const Options& options)
+    Backup(const Options& options, StatCache& stat_cache, DurableWrites& durable_writes)
         : m_options(options)
+        , m_stat_cache(stat_cache)
+        , m_durable_writes(durable_writes)
     {
     }
 
@@ -320,52 +441,352 @@ public:
         return m_options.backup_prefix + file_path + m_options.backup_suffix + ".orig";
     }
 
-    void make_backup_for(const std::string& file_path)
+    // Returns whether a backup was made, rather than there already being one.
+    bool make_backup_for(const std::string& file_path)
     {
         const auto backup_file = backup_name(file_path);
 
+        std::lock_guard<std::mutex> lock(m_mutex);
+
         // Per POSIX:
         // > if multiple patches are applied to the same file, the .orig file will be written only for the first patch
-        if (m_backed_up_files.emplace(backup_file).second) {
-            // If the output file being backed up exists, rename name that as the backup.
-            // For a missing output file just create an empty backup file instead.
-            if (filesystem::exists(file_path))
-                filesystem::rename(file_path, backup_file);
-            else
-                File::touch(backup_file);
+        if (!m_backed_up_files.emplace(backup_file).second)
+            return false;
+
+        // If the output file being backed up exists, rename name that as the backup.
+        // For a missing output file just create an empty backup file instead.
+        if (m_stat_cache.exists(file_path)) {
+            m_stat_cache.rename(file_path, backup_file);
+            m_durable_writes.renamed(file_path, backup_file);
+        } else {
+            File::touch(backup_file);
+            m_stat_cache.invalidate(backup_file);
+            m_durable_writes.changed_entry(backup_file);
         }
+        return true;
     }
 
 private:
     // to keep track in case there are multiple patches for the same file.
     std::unordered_set<std::string> m_backed_up_files;
+    std::mutex m_mutex;
     const Options& m_options;
+    StatCache& m_stat_cache;
+    DurableWrites& m_durable_writes;
+};
+
+// Time spent in one of the stages of patching a file, reported with --stats.
+struct StageStats {
+    std::atomic<uint64_t> items { 0 };
+    std::atomic<uint64_t> busy_nanoseconds { 0 };
+};
+
+class StageTimer {
+public:
+    explicit StageTimer(StageStats& stats)
+        : m_stats(stats)
+        , m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~StageTimer()
+    {
+        const auto elapsed = std::chrono::steady_clock::now() - m_start;
+        m_stats.busy_nanoseconds += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        ++m_stats.items;
+    }
+
+private:
+    StageStats& m_stats;
+    std::chrono::steady_clock::time_point m_start;
 };
 
 class DeferredWriter {
 public:
-    void deferred_write(File&& file, const std::string& destination_path, std::function<void(const std::string&)> permission_callback)
+    void deferred_write(File&& file, const std::string& destination_path, std::ios::openmode mode, std::function<void(const std::string&)> permission_callback)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_deferred_writes.push_back(FileWrite { std::move(file), destination_path, mode, std::move(permission_callback) });
+    }
+
+    bool will_write_to(const std::string& path)
     {
-        m_deferred_writes.push_back(FileWrite { std::move(file), destination_path, std::move(permission_callback) });
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return std::any_of(m_deferred_writes.begin(), m_deferred_writes.end(), [&path](const FileWrite& write) {
+            return write.destination_path == path;
+        });
     }
 
-    void finalize()
+    // Make every write, on the write-behind threads. Nothing is written unless every patch
+    // could be applied, so the writes are all made together once patching has finished.
+    void finalize(DurableWrites& durable_writes, WriteBehind& write_behind, StageStats& stats)
     {
         for (auto& deferred_write : m_deferred_writes) {
-            File file(deferred_write.destination_path, std::ios_base::out | std::ios::trunc);
-            deferred_write.source.write_entire_contents_to(file);
-            deferred_write.permission_callback(deferred_write.destination_path);
+            auto* write = &deferred_write;
+            write_behind.run(write->destination_path, [write, &durable_writes, &stats] {
+                StageTimer timer(stats);
+                File file(write->destination_path, write->mode | std::ios::trunc);
+                write->source.write_entire_contents_to(file);
+                durable_writes.wrote(write->destination_path, file);
+                durable_writes.changed_entry(write->destination_path);
+                write->permission_callback(write->destination_path);
+            });
         }
+        write_behind.wait();
     }
 
 private:
     struct FileWrite {
         File source;
         std::string destination_path;
+        std::ios::openmode mode;
         std::function<void(const std::string&)> permission_callback;
     };
 
     std::vector<FileWrite> m_deferred_writes;
+    std::mutex m_mutex;
+};
+
+// Files which have been patched, but not yet written out. Further patches to one of
+// these files are applied to the lines kept here rather than reading the file again,
+// so that a file changed by many patches is only written once at the end.
+class ResidentFiles {
+public:
+    explicit ResidentFiles(DurableWrites& durable_writes)
+        : m_durable_writes(durable_writes)
+    {
+    }
+
+    // The resident lines of the file, or nullptr if it needs to be read from disk.
+    std::shared_ptr<const LineBuffer> find(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_files.find(path);
+        if (it == m_files.end())
+            return nullptr;
+
+        m_recently_used.splice(m_recently_used.end(), m_recently_used, it->second.position);
+        return it->second.lines;
+    }
+
+    void keep(const std::string& path, LineBuffer lines, std::ios::openmode mode)
+    {
+        const size_t size = lines.content().size();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        discard_locked(path);
+
+        m_recently_used.push_back(path);
+        m_files.emplace(path, Entry { std::make_shared<const LineBuffer>(std::move(lines)), mode, size, std::prev(m_recently_used.end()) });
+        m_size += size;
+
+        // Write out the least recently patched files when too much is being kept.
+        while (m_size > max_size && m_recently_used.size() > 1) {
+            const auto oldest = m_recently_used.front();
+            write_locked(oldest);
+            discard_locked(oldest);
+        }
+    }
+
+    bool contains(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_files.count(path) != 0;
+    }
+
+    // Forget about a file which has been written or removed by other means.
+    void discard(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        discard_locked(path);
+    }
+
+    void write(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        write_locked(path);
+        discard_locked(path);
+    }
+
+    // Write out every file still being kept on the write-behind threads, which are given
+    // ownership of the lines to write. Each of the files is written even if some of them
+    // can not be, with the errors for those returned in the order they were last patched.
+    std::vector<std::exception_ptr> write_all(WriteBehind& write_behind, StageStats& stats)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        try {
+            if (write_all_in_batches(stats)) {
+                clear_locked();
+                return {};
+            }
+        } catch (...) {
+            // There is no telling which of the files failed to be written, so write each of
+            // them again by itself to find out.
+        }
+
+        std::vector<std::exception_ptr> errors(m_recently_used.size());
+        size_t index = 0;
+        for (const auto& path : m_recently_used) {
+            const auto& entry = m_files.at(path);
+            auto lines = entry.lines;
+            const auto mode = entry.mode;
+            auto* error = &errors[index++];
+            write_behind.run(path, [this, path, lines, mode, error, &stats] {
+                StageTimer timer(stats);
+                try {
+                    write_file(path, *lines, mode);
+                } catch (...) {
+                    *error = std::current_exception();
+                }
+            });
+        }
+
+        clear_locked();
+        write_behind.wait();
+
+        errors.erase(std::remove(errors.begin(), errors.end(), nullptr), errors.end());
+        return errors;
+    }
+
+private:
+    static constexpr size_t max_size = 64 * 1024 * 1024;
+
+    // Below this many files, setting up to write them in batches is not worth it.
+    static constexpr size_t files_to_write_in_batches = 16;
+    static constexpr size_t max_average_size_to_batch = 8 * 1024;
+
+    struct Entry {
+        std::shared_ptr<const LineBuffer> lines;
+        std::ios::openmode mode;
+        size_t size;
+        std::list<std::string>::iterator position;
+    };
+
+    void write_locked(const std::string& path)
+    {
+        auto it = m_files.find(path);
+        if (it == m_files.end())
+            return;
+
+        write_file(path, *it->second.lines, it->second.mode);
+    }
+
+    // Many small files are quickest to write in batches, where that is supported. Larger
+    // files are quicker to write on the write-behind threads, and so are writes which need
+    // to be made durable, as that is done file by file.
+    bool write_all_in_batches(StageStats& stats)
+    {
+        if (m_files.size() < files_to_write_in_batches || m_size / m_files.size() > max_average_size_to_batch || m_durable_writes.enabled())
+            return false;
+
+        std::vector<filesystem::FileContent> files;
+        std::vector<std::shared_ptr<const LineBuffer>> lines;
+        files.reserve(m_files.size());
+        lines.reserve(m_files.size());
+        for (const auto& path : m_recently_used) {
+            lines.push_back(m_files.at(path).lines);
+            files.push_back({ path, lines.back()->content() });
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        if (!filesystem::write_files(files))
+            return false;
+
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        stats.busy_nanoseconds += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        stats.items += files.size();
+        return true;
+    }
+
+    void write_file(const std::string& path, const LineBuffer& lines, std::ios::openmode mode)
+    {
+        // The lines hold exactly what was written when patching.
+        File file(path, mode | std::ios::binary | std::ios::trunc);
+        file << lines.content();
+        m_durable_writes.wrote(path, file);
+    }
+
+    void clear_locked()
+    {
+        m_files.clear();
+        m_recently_used.clear();
+        m_size = 0;
+    }
+
+    void discard_locked(const std::string& path)
+    {
+        auto it = m_files.find(path);
+        if (it == m_files.end())
+            return;
+
+        m_size -= it->second.size;
+        m_recently_used.erase(it->second.position);
+        m_files.erase(it);
+    }
+
+    std::unordered_map<std::string, Entry> m_files;
+    std::list<std::string> m_recently_used;
+    size_t m_size { 0 };
+    std::mutex m_mutex;
+    DurableWrites& m_durable_writes;
+};
+
+constexpr size_t ResidentFiles::max_size;
+constexpr size_t ResidentFiles::files_to_write_in_batches;
+constexpr size_t ResidentFiles::max_average_size_to_batch;
+
+// Starts reading files which are about to be patched as soon as they are known, so that
+// waiting for them to come off the disk overlaps with the patches before them being parsed,
+// applied and written. How far ahead this goes is limited by how much the pipeline holds.
+class Prefetcher {
+public:
+    // Whether prefetched files were in memory by the time they were loaded is only checked
+    // for --stats, as it is not free to find out.
+    explicit Prefetcher(bool track_hits)
+        : m_track_hits(track_hits)
+    {
+    }
+
+    void prefetch(const std::string& path)
+    {
+        if (!filesystem::prefetch(path))
+            return;
+
+        ++m_prefetched;
+        if (m_track_hits) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending.insert(path);
+        }
+    }
+
+    // Called with a file which has just been opened to be read.
+    void loading(const std::string& path, File& file)
+    {
+        if (!m_track_hits)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_pending.erase(path) == 0)
+                return;
+        }
+
+        ++m_loaded;
+        if (file.is_in_memory())
+            ++m_hits;
+    }
+
+    uint64_t prefetched() const { return m_prefetched; }
+    uint64_t loaded() const { return m_loaded; }
+    uint64_t hits() const { return m_hits; }
+
+private:
+    const bool m_track_hits;
+    std::atomic<uint64_t> m_prefetched { 0 };
+    std::atomic<uint64_t> m_loaded { 0 };
+    std::atomic<uint64_t> m_hits { 0 };
+    std::mutex m_mutex;
+    std::unordered_set<std::string> m_pending;
 };
 
 struct PermissionResult {
@@ -374,10 +795,10 @@ struct PermissionResult {
     bool had_failure { false };
 };
 
-static PermissionResult fix_permissions_if_needed(std::ostream& out, const Options& options, const std::string& output_file)
+static PermissionResult fix_permissions_if_needed(std::ostream& out, const Options& options, const std::string& output_file, StatCache& stat_cache)
 {
     PermissionResult result;
-    result.old_permissions = filesystem::get_permissions(output_file);
+    result.old_permissions = stat_cache.get_permissions(output_file);
     const auto write_perm_mask = filesystem::perms::group_write | filesystem::perms::owner_write | filesystem::perms::others_write;
     result.needed_to_fix_permissions = (result.old_permissions & write_perm_mask) == filesystem::perms::none;
 
@@ -393,28 +814,30 @@ static PermissionResult fix_permissions_if_needed(std::ostream& out, const Optio
         }
 
         if (!options.dry_run)
-            filesystem::permissions(output_file, result.old_permissions | write_perm_mask);
+            stat_cache.permissions(output_file, result.old_permissions | write_perm_mask);
     }
 
     return result;
 }
 
 void write_patched_result_to_file(const Patch& patch, const std::string& output_file_path, const PermissionResult& permission_result,
-    std::ios::openmode mode, DeferredWriter& deferred_writer, File& patched_file)
+    std::ios::openmode mode, DeferredWriter& deferred_writer, StatCache& stat_cache, DurableWrites& durable_writes, File& patched_file)
 {
     // Ensure that parent directories exist if we are adding a file.
     if (patch.operation == Operation::Add)
-        ensure_parent_directories(output_file_path);
+        stat_cache.ensure_parent_directories(output_file_path);
 
     const auto new_mode_copy = patch.new_file_mode;
 
-    auto permission_callback = [permission_result, new_mode_copy](const std::string& path) {
+    auto permission_callback = [permission_result, new_mode_copy, &stat_cache, &durable_writes](const std::string& path) {
         if (new_mode_copy != 0) {
             auto perms = static_cast<filesystem::perms>(new_mode_copy) & filesystem::perms::mask;
-            filesystem::permissions(path, perms);
+            stat_cache.permissions(path, perms);
+            durable_writes.changed_metadata(path);
         } else if (permission_result.needed_to_fix_permissions) {
             // Restore permissions to before they were changed.
-            filesystem::permissions(path, permission_result.old_permissions);
+            stat_cache.permissions(path, permission_result.old_permissions);
+            durable_writes.changed_metadata(path);
         }
     };
 
@@ -433,214 +856,1309 @@ void write_patched_result_to_file(const Patch& patch, const std::string& output_
             // A symlink patch should contain the filename in the contents of the patched file.
             const auto symlink_target = patched_file.read_all_as_string();
             filesystem::symlink(symlink_target, output_file_path);
+            stat_cache.invalidate(output_file_path);
+            durable_writes.changed_entry(output_file_path);
         } else {
-            deferred_writer.deferred_write(std::move(patched_file), output_file_path, std::move(permission_callback));
+            deferred_writer.deferred_write(std::move(patched_file), output_file_path, mode, std::move(permission_callback));
         }
     } else {
         File file(output_file_path, mode | std::ios::trunc);
+        stat_cache.invalidate(output_file_path);
         patched_file.write_entire_contents_to(file);
+        durable_writes.wrote(output_file_path, file);
+        if (patch.operation != Operation::Change)
+            durable_writes.changed_entry(output_file_path);
         permission_callback(output_file_path);
     }
 }
 
-int process_patch(const Options& options)
+// Whether the file has exactly the content of the given number of lines, as found by
+// line_at() for each of them. The file is compared a block at a time, and not read at all
+// if it has a different size.
+template<typename LineAt>
+static bool has_content(File& file, size_t count, LineAt line_at)
 {
-    if (options.show_help) {
-        show_usage(std::cout);
-        return 0;
+    uintmax_t size = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const LineView line = line_at(i);
+        size += line.content.size() + (line.newline == NewLine::CRLF ? 2 : line.newline == NewLine::LF ? 1 : 0);
     }
 
-    if (options.show_version) {
-        show_version(std::cout);
-        return 0;
-    }
+    if (file.size() != size)
+        return false;
 
-    if (!options.patch_directory_path.empty())
-        chdir(options.patch_directory_path);
+    std::array<char, 4096> buffer;
+    size_t buffered = 0;
+    size_t position = 0;
 
-    // When writing the patched file to cout - write any prompts to cerr instead.
-    const bool output_to_stdout = options.out_file_path == "-";
-    auto& out = output_to_stdout ? std::cerr : std::cout;
+    auto matches = [&](const char* data, size_t length) {
+        while (length != 0) {
+            if (position == buffered) {
+                buffered = file.read(buffer.data(), buffer.size());
+                position = 0;
+                if (buffered == 0)
+                    return false;
+            }
 
-    PatchFile patch_file(options);
-    Backup backup(options);
+            const auto n = std::min(length, buffered - position);
+            if (std::memcmp(buffer.data() + position, data, n) != 0)
+                return false;
 
-    const auto format = diff_format_from_options(options);
+            position += n;
+            data += n;
+            length -= n;
+        }
+        return true;
+    };
 
-    bool had_failure = false;
-    bool first_patch = true;
+    file.rewind();
+
+    bool same = true;
+    for (size_t i = 0; i < count; ++i) {
+        const LineView line = line_at(i);
+        const char* newline = line.newline == NewLine::CRLF ? "\r\n" : line.newline == NewLine::LF ? "\n" : "";
+        if (!matches(line.content.data(), line.content.size()) || !matches(newline, std::strlen(newline))) {
+            same = false;
+            break;
+        }
+    }
 
+    file.rewind();
+    return same;
+}
+
+// A patch which has been parsed and checked, and is ready to be applied to a file.
+struct FileToPatch {
+    Patch patch;
+    std::string file_to_patch;
+    std::string output_file;
+    std::ios::openmode mode;
+    PermissionResult permission_result;
+
+    // Any error parsing the body of the patch. This is only raised once the file is
+    // announced as being patched, which is when it would be found when parsing the
+    // patch as it is applied.
+    std::exception_ptr parse_error;
+};
+
+// State shared between every file being patched, which is used by multiple threads.
+struct PatchContext {
+    explicit PatchContext(const Options& options_)
+        : options(options_)
+        , durable_writes(options_.durable && !options_.dry_run)
+        , backup(options_, stat_cache, durable_writes)
+        , resident_files(durable_writes)
+        , prefetcher(options_.show_stats)
+    {
+    }
+
+    const Options& options;
+    StatCache stat_cache;
+    DurableWrites durable_writes;
+    Backup backup;
     DeferredWriter deferred_writer;
+    ResidentFiles resident_files;
+    Prefetcher prefetcher;
 
-    Parser parser(patch_file.file());
+    // Writes out the files which are only written once patching has finished.
+    WriteBehind write_behind { write_behind_threads };
 
-    // Continue parsing patches from the input file and applying them.
-    while (!parser.is_eof()) {
-        Patch patch(format);
-        PatchHeaderInfo info;
-        bool should_parse_body = parser.parse_patch_header(patch, info, options.strip_size);
-
-        if (patch.format == Format::Unknown) {
-            if (first_patch)
-                throw std::invalid_argument("Only garbage was found in the patch input.");
-            if (options.verbose)
-                out << "Hmm...  Ignoring the trailing garbage.\n";
-            break;
+    // Held while adding or removing files so that directories are not removed from under
+    // a file being added to them.
+    std::mutex directory_mutex;
+
+    bool output_to_stdout { false };
+
+    StageStats parse_stats;
+    StageStats load_stats;
+    StageStats apply_stats;
+    StageStats write_stats;
+    StageStats write_behind_stats;
+
+    // Waiting for everything to be on disk for --durable, once everything has been written.
+    DurableWrites::Summary durable_summary;
+    std::chrono::steady_clock::duration durable_time {};
+};
+
+// A patch which is applied to a file as a whole, without reading the file into lines and
+// applying hunks to them.
+enum class FastPath {
+    None,
+    Rename,
+    Copy,
+    Add,
+    Delete,
+};
+
+static bool only_has_lines(const Patch& patch, char operation)
+{
+    return patch.hunks.size() == 1 && !patch.hunks[0].lines.empty()
+        && std::all_of(patch.hunks[0].lines.begin(), patch.hunks[0].lines.end(), [operation](const PatchLine& line) {
+               return line.operation == operation;
+           });
+}
+
+// Which fast path (if any) could be taken to apply the patch, giving the same result (and
+// messages) as applying it normally would.
+static FastPath fast_path_for(const FileToPatch& file, const Options& options)
+{
+    const auto& patch = file.patch;
+
+    // Anything which may need the file to be looked at more closely, or may say more about
+    // how it was patched, is left to the normal path.
+    if (options.reverse_patch || options.verbose || options.dry_run || !options.out_file_path.empty()
+        || !options.define_macro.empty() || patch.is_git_binary || patch.format == Format::Ed
+        || !patch.prerequisite.empty() || file.parse_error || filesystem::is_symlink(patch.old_file_mode)
+        || filesystem::is_symlink(patch.new_file_mode)) {
+        return FastPath::None;
+    }
+
+    switch (patch.operation) {
+    case Operation::Rename:
+        return patch.hunks.empty() && file.file_to_patch != file.output_file ? FastPath::Rename : FastPath::None;
+    case Operation::Copy:
+        return patch.hunks.empty() && file.file_to_patch != file.output_file ? FastPath::Copy : FastPath::None;
+    case Operation::Add:
+        // Git patches are only written out once every patch has applied, so the added
+        // content needs to be kept somewhere until then anyway.
+        return patch.format != Format::Git && only_has_lines(patch, '+') ? FastPath::Add : FastPath::None;
+    case Operation::Delete:
+        return options.remove_empty_files == Options::OptionalBool::Yes && !options.ignore_whitespace && only_has_lines(patch, '-')
+            ? FastPath::Delete
+            : FastPath::None;
+    case Operation::Change:
+        break;
+    }
+
+    return FastPath::None;
+}
+
+// Whether writing the lines of the file out again would leave it exactly as it is, so that
+// it can be renamed or copied as is.
+static bool has_newlines_to_keep(File& file, const Options& options)
+{
+    if (options.newline_output == Options::NewlineOutput::Keep)
+        return true;
+
+#ifdef _WIN32
+    return false;
+#else
+    if (options.newline_output == Options::NewlineOutput::CRLF)
+        return false;
+
+    // Otherwise every newline is written as LF, so only a CRLF would be changed.
+    std::array<char, 65536> buffer;
+    bool after_cr = false;
+    size_t n;
+    while ((n = file.read(buffer.data(), buffer.size())) != 0) {
+        if (after_cr && buffer[0] == '\n')
+            return false;
+
+        const char* end = buffer.data() + n;
+        for (const char* cr = buffer.data(); (cr = static_cast<const char*>(std::memchr(cr, '\r', static_cast<size_t>(end - cr)))); ++cr) {
+            if (cr + 1 != end && cr[1] == '\n')
+                return false;
         }
+        after_cr = buffer[n - 1] == '\r';
+    }
+    return true;
+#endif
+}
 
-        first_patch = false;
+// The content of the file being patched.
+struct LoadedFile {
+    const LineBuffer& lines() const { return resident_lines ? *resident_lines : input_lines; }
 
-        if (patch.operation == Operation::Binary) {
-            out << "File " << (options.reverse_patch ? patch.new_file_path : patch.old_file_path) << ": git binary diffs are not supported.\n";
-            had_failure = true;
-            continue;
+    std::string input_content;
+    LineBuffer input_lines;
+
+    // Set instead of the lines above when the file is kept by ResidentFiles.
+    std::shared_ptr<const LineBuffer> resident_lines;
+
+    // Of the file as it was opened, when it was read from disk.
+    filesystem::Status input_status;
+
+    // Set if the file has not been read in, as it is patched as a whole.
+    FastPath fast_path { FastPath::None };
+
+    // Set instead of the lines above when the file is read as it is patched.
+    File streamed_file;
+    bool is_streamed { false };
+};
+
+// The result of applying a patch, which is yet to be written out.
+struct AppliedFile {
+    File tmp_out_file;
+    File tmp_reject_file;
+    Result result { 0, false, true };
+    bool had_failure { false };
+    bool should_write { true };
+
+    // Whether the patched file is exactly the same as it was before, for --skip-unchanged.
+    bool is_unchanged { false };
+
+    filesystem::Status input_status;
+    FastPath fast_path { FastPath::None };
+
+    // Whether the file was read as it was patched, in which case the result is not held
+    // in memory either.
+    bool is_streamed { false };
+};
+
+static void load_file(const FileToPatch& file, LoadedFile& loaded, PatchContext& context)
+{
+    if (!file.patch.is_git_binary) {
+        loaded.resident_lines = context.resident_files.find(file.file_to_patch);
+        if (loaded.resident_lines)
+            return;
+    }
+
+    File input_file;
+    input_file.open(file.file_to_patch, file.mode | std::ios_base::in);
+    if (!input_file && (errno != ENOENT || file.patch.operation != Operation::Add))
+        throw std::system_error(errno, std::generic_category(), "Unable to open input file " + file.file_to_patch);
+
+    if (input_file) {
+        context.prefetcher.loading(file.file_to_patch, input_file);
+        loaded.input_status = input_file.status();
+        context.stat_cache.update(file.file_to_patch, loaded.input_status);
+    }
+
+    const auto fast_path = fast_path_for(file, context.options);
+    if (fast_path != FastPath::None) {
+        bool can_take_fast_path = false;
+        if (fast_path == FastPath::Rename || fast_path == FastPath::Copy) {
+            // The changes of a git patch are made all at once, so nothing else in the patch
+            // can be reading from where the file is going if there is nothing there yet.
+            can_take_fast_path = !context.stat_cache.exists(file.output_file) && !context.deferred_writer.will_write_to(file.output_file)
+                && has_newlines_to_keep(input_file, context.options);
+        } else if (fast_path == FastPath::Add) {
+            can_take_fast_path = !input_file;
+        } else if (fast_path == FastPath::Delete) {
+            const auto& lines = file.patch.hunks[0].lines;
+            can_take_fast_path = has_content(input_file, lines.size(), [&lines](size_t i) -> LineView { return lines[i].line; });
         }
 
-        if (options.verbose)
-            out << "Hmm...  Looks like a " << to_string(info.format) << " diff to me...\n";
+        if (can_take_fast_path) {
+            loaded.fast_path = fast_path;
+            return;
+        }
 
-        auto file_to_patch = options.file_to_patch.empty() ? guess_filepath(patch) : options.file_to_patch;
+        if (input_file)
+            input_file.rewind();
+    }
 
-        if (file_to_patch.empty()) {
-            out << "can't find file to patch at input line " << parser.line_number()
-                << "\nPerhaps you "
-                << (options.strip_size == -1 ? "should have used the" : "used the wrong")
-                << " -p or --strip option?\n";
+    // With a limit on how far away a hunk can be found, only the lines where a hunk may
+    // still be found need to be held, so the file is read as it is patched.
+    if (context.options.max_offset >= 0 && !file.patch.is_git_binary && file.patch.format != Format::Ed
+        && file.patch.prerequisite.empty() && !context.options.skip_unchanged) {
+        loaded.streamed_file = std::move(input_file);
+        loaded.is_streamed = true;
+        return;
+    }
+
+    // The content of a file changed by a binary patch is not split into lines.
+    if (!file.patch.is_git_binary)
+        loaded.input_lines = file_as_lines(input_file, file.patch.hunks.size() >= hunks_to_hash_lines_for);
+    else if (input_file)
+        loaded.input_content = input_file.read_all_as_string();
+}
+
+static void apply_loaded_file(FileToPatch& file, LoadedFile& loaded, AppliedFile& applied, PatchContext& context, std::ostream& out)
+{
+    const auto& options = context.options;
+    auto& patch = file.patch;
+    const auto& file_to_patch = file.file_to_patch;
+    const auto& output_file = file.output_file;
+
+    if (!patch.prerequisite.empty() && !has_prerequisite(loaded.lines(), patch.prerequisite))
+        check_prerequisite_handling(out, options, patch.prerequisite);
+
+    out << patch_operation(options) << (filesystem::is_symlink(patch.new_file_mode) ? " symbolic link " : " file ") << format_filename(options.quoting_style, output_file);
+
+    if (patch.operation == Operation::Rename) {
+        if (file_to_patch == output_file) {
+            out << " (already renamed from " << (options.reverse_patch ? patch.new_file_path : patch.old_file_path) << ")";
+            patch.operation = Operation::Change;
+        } else {
+            out << " (renamed from " << file_to_patch << ")";
         }
+    } else if (patch.operation == Operation::Copy) {
+        out << " (copied from " << file_to_patch << ")";
+    } else if (!options.out_file_path.empty()) {
+        out << " (read from " << file_to_patch << ")";
+    }
+    out << '\n';
 
-        if (options.verbose || file_to_patch.empty())
-            parser.print_header_info(info, out);
+    if (file.parse_error)
+        std::rethrow_exception(file.parse_error);
 
-        if (file_to_patch.empty())
-            file_to_patch = prompt_for_filepath(out);
+    if (options.verbose)
+        out << "Using Plan A...\n";
 
-        if (file_to_patch.empty()) {
-            if (should_parse_body)
-                parser.parse_patch_body(patch);
+    applied.input_status = loaded.input_status;
+    applied.fast_path = loaded.fast_path;
+    if (applied.fast_path != FastPath::None)
+        return;
 
-            out << "Skipping patch.\n";
-            inform_hunks_failed(out, "ignored", patch.hunks, patch.hunks.size());
-            out << '\n';
-            had_failure = true;
-            continue;
+    // A dry run only checks where each hunk applies, so there is no need for somewhere to
+    // write the result to unless it is used. An added file may turn out to be a removal
+    // once the patch is reversed.
+    if (!options.dry_run || patch.is_git_binary || patch.operation == Operation::Add || needs_patched_output(patch, options))
+        applied.tmp_out_file = File::create_temporary();
+
+    if (!options.dry_run)
+        applied.tmp_reject_file = File::create_temporary();
+    RejectWriter reject_writer = options.dry_run ? RejectWriter(patch) : RejectWriter(patch, applied.tmp_reject_file, options.reject_format);
+
+    if (patch.is_git_binary) {
+        const char* reason = nullptr;
+        if (options.reverse_patch && patch.binary_hunks.size() < 2)
+            reason = "can not be reversed";
+        else if (!apply_git_binary_patch(applied.tmp_out_file, loaded.input_content, patch, options))
+            reason = "does not apply";
+
+        // There is no way to write a reject for a binary patch, so leave the file untouched.
+        if (reason) {
+            out << "File " << output_file << ": git binary patch " << reason << ".\n";
+            if (file.permission_result.needed_to_fix_permissions && !options.dry_run)
+                context.stat_cache.permissions(output_file, file.permission_result.old_permissions);
+            applied.had_failure = true;
+            applied.should_write = false;
         }
+    } else if (patch.format == Format::Ed) {
+        apply_ed_script(applied.tmp_out_file, loaded.lines(), patch, options);
+    } else if (loaded.is_streamed) {
+        applied.result = apply_patch_streaming(applied.tmp_out_file, reject_writer, loaded.streamed_file, patch, options, out);
+        applied.is_streamed = true;
+    } else {
+        applied.result = apply_patch(applied.tmp_out_file, reject_writer, loaded.lines(), patch, options, out);
+    }
 
-        const auto output_file = output_path(options, patch, file_to_patch);
+    // Only a file changed in place, and which is left with the same mode, can be left alone.
+    if (options.skip_unchanged && !options.dry_run && !patch.is_git_binary && patch.operation == Operation::Change
+        && file_to_patch == output_file && (patch.new_file_mode == 0 || patch.new_file_mode == patch.old_file_mode)) {
+        const auto& lines = loaded.lines();
+        applied.is_unchanged = has_content(applied.tmp_out_file, lines.size(), [&lines](size_t i) { return lines[i]; });
+    }
+}
 
-        std::ios::openmode mode = std::ios::out;
-        if (options.newline_output != Options::NewlineOutput::Native)
-            mode |= std::ios::binary;
+// Set the time of the patched file to the time given for it in the patch (for --set-time
+// or --set-utc), as long as the file was exactly as the patch expected it to be.
+static void set_time_from_patch(std::ostream& out, const FileToPatch& file, const AppliedFile& applied, PatchContext& context)
+{
+    const auto& options = context.options;
+    const bool assume_utc = options.set_time == Options::SetTime::UTC;
 
-        File tmp_reject_file = File::create_temporary();
-        RejectWriter reject_writer(patch, tmp_reject_file, options.reject_format);
+    filesystem::FileTime new_time;
+    if (!parse_timestamp(file.patch.new_file_time, assume_utc, new_time))
+        return;
 
-        if (filesystem::exists(file_to_patch) && !filesystem::is_regular_file(file_to_patch)) {
-            if (should_parse_body)
-                parser.parse_patch_body(patch);
-            out << "File " << file_to_patch << " is not a regular file --";
-            refuse_to_patch(out, mode, output_file, patch, options);
-            had_failure = true;
-            continue;
+    if (!options.force) {
+        filesystem::FileTime old_time;
+        if (applied.input_status.exists && parse_timestamp(file.patch.old_file_time, assume_utc, old_time)
+            && old_time != applied.input_status.modification_time) {
+            out << "Not setting time of file " << file.output_file << " (time mismatch)\n";
+            return;
         }
 
-        auto permission_result = fix_permissions_if_needed(out, options, output_file);
-        if (permission_result.had_failure) {
-            if (should_parse_body)
-                parser.parse_patch_body(patch);
-            refuse_to_patch(out, mode, output_file, patch, options);
-            had_failure = true;
-            continue;
+        if (applied.result.failed_hunks != 0 || !applied.result.all_hunks_applied_perfectly) {
+            out << "Not setting time of file " << file.output_file << " (contents mismatch)\n";
+            return;
         }
+    }
+
+    filesystem::set_modification_time(file.output_file, new_time);
+    context.durable_writes.changed_metadata(file.output_file);
+}
+
+// Write out a file which is patched as a whole, as decided by fast_path_for(), giving the
+// same result as writing out the file normally would.
+static void write_whole_file(const FileToPatch& file, const AppliedFile& applied, PatchContext& context, std::ostream& out)
+{
+    const auto& options = context.options;
+    const auto& patch = file.patch;
+    const auto& file_to_patch = file.file_to_patch;
+    const auto& output_file = file.output_file;
+
+    // The content has been checked to be exactly what the patch removes.
+    if (applied.fast_path == FastPath::Delete) {
+        context.resident_files.discard(output_file);
+        context.stat_cache.remove_file_and_empty_parent_folders(output_file);
+        context.durable_writes.changed_entry(output_file);
+        return;
+    }
 
-        File input_file;
-        input_file.open(file_to_patch, mode | std::ios_base::in);
-        if (!input_file && (errno != ENOENT || patch.operation != Operation::Add))
-            throw std::system_error(errno, std::generic_category(), "Unable to open input file " + file_to_patch);
+    if (options.save_backup) {
+        context.resident_files.write(output_file);
+        context.backup.make_backup_for(output_file);
+    }
 
-        const auto input_lines = file_as_lines(input_file);
+    context.resident_files.discard(output_file);
+    context.stat_cache.ensure_parent_directories(output_file);
 
-        input_file.close();
+    if (applied.fast_path == FastPath::Rename) {
+        context.stat_cache.rename(file_to_patch, output_file);
+        context.stat_cache.remove_empty_parent_folders(file_to_patch);
+        context.durable_writes.renamed(file_to_patch, output_file);
+    } else {
+        File output(output_file, file.mode | std::ios::trunc);
+        context.stat_cache.invalidate(output_file);
 
-        if (!patch.prerequisite.empty() && !has_prerequisite(input_lines, patch.prerequisite))
-            check_prerequisite_handling(out, options, patch.prerequisite);
+        if (applied.fast_path == FastPath::Copy) {
+            File input(file_to_patch, file.mode | std::ios::in);
+            input.copy_entire_contents_to(output);
+        } else {
+            write_added_lines(output, patch, options);
+        }
 
-        out << patch_operation(options) << (filesystem::is_symlink(patch.new_file_mode) ? " symbolic link " : " file ") << format_filename(options.quoting_style, output_file);
+        context.durable_writes.wrote(output_file, output);
+        context.durable_writes.changed_entry(output_file);
+    }
 
-        if (patch.operation == Operation::Rename) {
-            if (file_to_patch == output_file) {
-                out << " (already renamed from " << (options.reverse_patch ? patch.new_file_path : patch.old_file_path) << ")";
-                patch.operation = Operation::Change;
-            } else {
-                out << " (renamed from " << file_to_patch << ")";
-            }
-        } else if (patch.operation == Operation::Copy) {
-            out << " (copied from " << file_to_patch << ")";
-        } else if (!options.out_file_path.empty()) {
-            out << " (read from " << file_to_patch << ")";
+    if (patch.new_file_mode != 0) {
+        context.stat_cache.permissions(output_file, static_cast<filesystem::perms>(patch.new_file_mode) & filesystem::perms::mask);
+        context.durable_writes.changed_metadata(output_file);
+    } else if (file.permission_result.needed_to_fix_permissions) {
+        context.stat_cache.permissions(output_file, file.permission_result.old_permissions);
+        context.durable_writes.changed_metadata(output_file);
+    }
+
+    if (options.set_time != Options::SetTime::Never && applied.fast_path == FastPath::Add)
+        set_time_from_patch(out, file, applied, context);
+}
+
+// Returns whether the patch failed to apply.
+static bool write_applied_file(const FileToPatch& file, AppliedFile& applied, PatchContext& context, std::ostream& out)
+{
+    if (!applied.should_write)
+        return applied.had_failure;
+
+    const auto& options = context.options;
+    const auto& patch = file.patch;
+    const auto& output_file = file.output_file;
+    const auto& result = applied.result;
+    bool had_failure = applied.had_failure;
+
+    if (result.failed_hunks != 0) {
+        had_failure = true;
+        const char* reason = result.was_skipped ? "ignored" : "FAILED";
+        inform_hunks_failed(out, reason, patch.hunks, result.failed_hunks);
+        if (!options.dry_run) {
+            const auto reject_file = reject_path(options, output_file);
+            out << " -- saving rejects to file " << reject_file;
+
+            File reject(reject_file, file.mode | std::ios::trunc);
+            context.stat_cache.invalidate(reject_file);
+            applied.tmp_reject_file.write_entire_contents_to(reject);
+            context.durable_writes.wrote(reject_file, reject);
+            context.durable_writes.changed_entry(reject_file);
         }
         out << '\n';
+    }
 
-        if (should_parse_body)
-            parser.parse_patch_body(patch);
+    if (context.output_to_stdout) {
+        // Nothing else to do other than write to stdout :^)
+        applied.tmp_out_file.write_entire_contents_to(stdout);
+        return had_failure;
+    }
 
+    if (applied.is_unchanged) {
         if (options.verbose)
-            out << "Using Plan A...\n";
+            out << "Not rewriting file " << output_file << " as its content is unchanged\n";
+        if (file.permission_result.needed_to_fix_permissions)
+            context.stat_cache.permissions(output_file, file.permission_result.old_permissions);
+        return had_failure;
+    }
 
-        File tmp_out_file = File::create_temporary();
+    std::unique_lock<std::mutex> directory_lock(context.directory_mutex, std::defer_lock);
+    if (patch.operation != Operation::Change)
+        directory_lock.lock();
 
-        Result result = apply_patch(tmp_out_file, reject_writer, input_lines, patch, options, out);
+    if (applied.fast_path != FastPath::None) {
+        write_whole_file(file, applied, context, out);
+        return had_failure;
+    }
 
-        if (result.failed_hunks != 0) {
-            had_failure = true;
-            const char* reason = result.was_skipped ? "ignored" : "FAILED";
-            inform_hunks_failed(out, reason, patch.hunks, result.failed_hunks);
-            if (!options.dry_run) {
-                const auto reject_file = reject_path(options, output_file);
-                out << " -- saving rejects to file " << reject_file;
+    bool write_to_file = !options.dry_run;
 
-                File file(reject_file, mode | std::ios::trunc);
-                tmp_reject_file.write_entire_contents_to(file);
+    // Clean up the file if it looks like it was removed.
+    // NOTE: we check for file size for the degenerate case that the file is a removal, but has nothing left.
+    if (options.remove_empty_files == Options::OptionalBool::Yes && patch.operation == Operation::Delete) {
+        if (applied.tmp_out_file.size() == 0) {
+            if (!options.dry_run) {
+                context.resident_files.discard(output_file);
+                context.stat_cache.remove_file_and_empty_parent_folders(output_file);
+                context.durable_writes.changed_entry(output_file);
             }
-            out << '\n';
+            write_to_file = false;
+        } else {
+            out << "Not deleting file " << output_file << " as content differs from patch\n";
+            had_failure = true;
+        }
+    }
+
+    if (write_to_file) {
+        bool made_backup = false;
+        if (options.save_backup || (!result.all_hunks_applied_perfectly && !result.was_skipped && options.backup_if_mismatch == Options::OptionalBool::Yes)) {
+            // The backup is of the file as it was before the first patch to it, so it
+            // needs to be written out before being backed up.
+            context.resident_files.write(output_file);
+            made_backup = context.backup.make_backup_for(output_file);
         }
 
-        if (output_to_stdout) {
-            // Nothing else to do other than write to stdout :^)
-            tmp_out_file.write_entire_contents_to(stdout);
+        // Keep the result of a plain change to a file in memory in case there are more
+        // patches to it, as long as the file is left as it was on disk until then.
+        if (!made_backup && !applied.is_streamed && patch.operation == Operation::Change && patch.format != Format::Git
+            && output_file == file.file_to_patch && !file.permission_result.needed_to_fix_permissions
+            && options.set_time == Options::SetTime::Never) {
+            context.resident_files.keep(output_file, file_as_lines(applied.tmp_out_file), file.mode);
         } else {
-            bool write_to_file = !options.dry_run;
-
-            // Clean up the file if it looks like it was removed.
-            // NOTE: we check for file size for the degenerate case that the file is a removal, but has nothing left.
-            if (options.remove_empty_files == Options::OptionalBool::Yes && patch.operation == Operation::Delete) {
-                if (tmp_out_file.size() == 0) {
-                    if (!options.dry_run)
-                        remove_file_and_empty_parent_folders(output_file);
-                    write_to_file = false;
-                } else {
-                    out << "Not deleting file " << output_file << " as content differs from patch\n";
-                    had_failure = true;
+            context.resident_files.discard(output_file);
+            write_patched_result_to_file(patch, output_file, file.permission_result, file.mode, context.deferred_writer, context.stat_cache, context.durable_writes, applied.tmp_out_file);
+
+            // Git patches do not give any times, and are only written at the very end.
+            if (options.set_time != Options::SetTime::Never && patch.operation != Operation::Delete && patch.format != Format::Git)
+                set_time_from_patch(out, file, applied, context);
+        }
+    }
+
+    if (result.failed_hunks == 0) {
+        if (write_to_file && patch.operation == Operation::Rename) {
+            context.resident_files.discard(file.file_to_patch);
+            context.stat_cache.remove_file_and_empty_parent_folders(file.file_to_patch);
+            context.durable_writes.changed_entry(file.file_to_patch);
+        }
+    }
+
+    return had_failure;
+}
+
+// Returns whether the patch failed to apply.
+static bool apply_to_file(FileToPatch& file, PatchContext& context, std::ostream& out)
+{
+    LoadedFile loaded;
+    {
+        StageTimer timer(context.load_stats);
+        load_file(file, loaded, context);
+    }
+
+    AppliedFile applied;
+    {
+        StageTimer timer(context.apply_stats);
+        apply_loaded_file(file, loaded, applied, context, out);
+    }
+
+    StageTimer timer(context.write_stats);
+    return write_applied_file(file, applied, context, out);
+}
+
+// Applies patches to files away from the thread parsing them, writing the output for
+// each patch in the same order as the patches were given.
+class BackgroundApplier {
+public:
+    BackgroundApplier(PatchContext& context, std::ostream& out)
+        : m_context(context)
+        , m_out(out)
+    {
+    }
+
+    virtual ~BackgroundApplier() = default;
+
+    // Write output for a patch which is not being applied once everything before it is written.
+    virtual void add_output(const std::string& output) = 0;
+
+    // Apply a patch which uses the given paths, writing its output after any output before it.
+    void apply(std::shared_ptr<FileToPatch> file, const std::string& preceding_output, const std::vector<std::string>& paths)
+    {
+        const size_t sequence = submitted();
+        for (const auto& path : paths)
+            m_last_patch_for_path[path] = sequence;
+        start(std::move(file), preceding_output);
+    }
+
+    // Wait for any patch already given which uses the path to finish being applied.
+    void wait_for_path(const std::string& path)
+    {
+        auto it = m_last_patch_for_path.find(path);
+        if (it != m_last_patch_for_path.end())
+            wait_until_completed(it->second);
+    }
+
+    // Wait for every patch given so far, returning whether any of them failed.
+    virtual bool finish() = 0;
+
+    // Whether a patch has failed with an error, meaning that nothing more should be parsed.
+    virtual bool has_error() const { return false; }
+
+protected:
+    // The number of patches and outputs given so far.
+    virtual size_t submitted() const = 0;
+    virtual void start(std::shared_ptr<FileToPatch> file, const std::string& preceding_output) = 0;
+    virtual void wait_until_completed(size_t sequence) = 0;
+
+    PatchContext& m_context;
+    std::ostream& m_out;
+
+private:
+    std::unordered_map<std::string, size_t> m_last_patch_for_path;
+};
+
+// Patches a number of files at the same time on a pool of threads (--jobs).
+class ParallelApplier final : public BackgroundApplier {
+public:
+    ParallelApplier(PatchContext& context, std::ostream& out)
+        : BackgroundApplier(context, out)
+        , m_pool(static_cast<size_t>(context.options.jobs))
+    {
+    }
+
+    void add_output(const std::string& output) override
+    {
+        if (output.empty())
+            return;
+
+        if (m_pending.empty()) {
+            m_out << output;
+            return;
+        }
+
+        m_pending.emplace_back();
+        m_pending.back().preceding_output = output;
+    }
+
+    bool finish() override
+    {
+        while (!m_pending.empty())
+            complete_next();
+        return m_had_failure;
+    }
+
+private:
+    enum class Outcome {
+        Applied,
+        Failed,
+        NeedsPrompt,
+    };
+
+    struct Pending {
+        std::string preceding_output;
+        std::shared_ptr<FileToPatch> file;
+        std::shared_ptr<std::ostringstream> output;
+        std::future<Outcome> result;
+    };
+
+    size_t submitted() const override { return m_completed + m_pending.size(); }
+
+    void start(std::shared_ptr<FileToPatch> file, const std::string& preceding_output) override
+    {
+        auto output = std::make_shared<std::ostringstream>();
+        auto& context = m_context;
+
+        // A prompt means that the patch needs to be applied again, which needs the patch
+        // as it was before any changes made to it by applying it.
+        const bool may_prompt = !context.options.batch && !context.options.force;
+
+        auto result = m_pool.submit([file, output, may_prompt, &context]() {
+            s_prompts_deferred = true;
+
+            std::unique_ptr<FileToPatch> copy;
+            if (may_prompt)
+                copy.reset(new FileToPatch(*file));
+
+            try {
+                return apply_to_file(copy ? *copy : *file, context, *output) ? Outcome::Failed : Outcome::Applied;
+            } catch (const prompt_deferred&) {
+                return Outcome::NeedsPrompt;
+            }
+        });
+
+        m_pending.emplace_back();
+        auto& pending = m_pending.back();
+        pending.preceding_output = preceding_output;
+        pending.file = std::move(file);
+        pending.output = std::move(output);
+        pending.result = std::move(result);
+    }
+
+    void wait_until_completed(size_t sequence) override
+    {
+        while (m_completed <= sequence && !m_pending.empty())
+            complete_next();
+    }
+
+    void complete_next()
+    {
+        auto pending = std::move(m_pending.front());
+        m_pending.pop_front();
+        ++m_completed;
+
+        m_out << pending.preceding_output;
+        if (!pending.file)
+            return;
+
+        Outcome outcome;
+        try {
+            outcome = pending.result.get();
+        } catch (...) {
+            m_out << pending.output->str();
+            throw;
+        }
+
+        if (outcome == Outcome::NeedsPrompt)
+            outcome = apply_to_file(*pending.file, m_context, m_out) ? Outcome::Failed : Outcome::Applied;
+        else
+            m_out << pending.output->str();
+
+        if (outcome == Outcome::Failed)
+            m_had_failure = true;
+    }
+
+    std::deque<Pending> m_pending;
+    size_t m_completed { 0 };
+    bool m_had_failure { false };
+
+    // Last, so that any running work finishes before anything it uses is destroyed.
+    ThreadPool m_pool;
+};
+
+// Patches one file at a time, with each file going through a pipeline of stages each on
+// their own thread: the file is read, the patch is applied, and the result is written.
+// This means that the next file is read while the one before is being patched, and the
+// patch after that is parsed while both of those happen.
+class Pipeline final : public BackgroundApplier {
+public:
+    Pipeline(PatchContext& context, std::ostream& out)
+        : BackgroundApplier(context, out)
+        , m_to_load(queue_capacity)
+        , m_to_apply(queue_capacity)
+        , m_to_write(queue_capacity)
+    {
+        m_loader = std::thread([this] { load_stage(); });
+        m_applier = std::thread([this] { apply_stage(); });
+        m_writer = std::thread([this] { write_stage(); });
+    }
+
+    ~Pipeline() override
+    {
+        m_to_load.push(nullptr);
+        m_loader.join();
+        m_applier.join();
+        m_writer.join();
+    }
+
+    void add_output(const std::string& output) override
+    {
+        if (output.empty())
+            return;
+
+        std::unique_ptr<Item> item(new Item);
+        item->preceding_output = output;
+        submit(std::move(item));
+    }
+
+    bool finish() override
+    {
+        if (m_submitted != 0)
+            wait_until_completed(m_submitted - 1);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_error)
+            std::rethrow_exception(m_error);
+        return m_had_failure;
+    }
+
+    bool has_error() const override { return m_has_error; }
+
+private:
+    // How many files may be waiting between each of the stages.
+    static constexpr size_t queue_capacity = 8;
+
+    struct Item {
+        std::string preceding_output;
+        std::shared_ptr<FileToPatch> file;
+
+        // The patch as changed by applying it. This is a copy when the patch may need to
+        // be applied again to ask the user a question, otherwise it is the file above.
+        std::unique_ptr<FileToPatch> applied_file;
+
+        LoadedFile loaded;
+        AppliedFile applied;
+        std::ostringstream output;
+        std::exception_ptr error;
+        bool needs_prompt { false };
+    };
+
+    size_t submitted() const override { return m_submitted; }
+
+    void start(std::shared_ptr<FileToPatch> file, const std::string& preceding_output) override
+    {
+        std::unique_ptr<Item> item(new Item);
+        item->preceding_output = preceding_output;
+        item->file = std::move(file);
+        submit(std::move(item));
+    }
+
+    void submit(std::unique_ptr<Item> item)
+    {
+        ++m_submitted;
+        m_to_load.push(std::move(item));
+    }
+
+    void wait_until_completed(size_t sequence) override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_item_completed.wait(lock, [&] { return m_completed > sequence; });
+    }
+
+    void load_stage()
+    {
+        while (auto item = m_to_load.pop()) {
+            if (item->file && !m_has_error) {
+                StageTimer timer(m_context.load_stats);
+                try {
+                    load_file(*item->file, item->loaded, m_context);
+                } catch (...) {
+                    item->error = std::current_exception();
                 }
             }
+            m_to_apply.push(std::move(item));
+        }
+        m_to_apply.push(nullptr);
+    }
 
-            if (write_to_file) {
-                if (options.save_backup || (!result.all_hunks_applied_perfectly && !result.was_skipped && options.backup_if_mismatch == Options::OptionalBool::Yes))
-                    backup.make_backup_for(output_file);
-                write_patched_result_to_file(patch, output_file, permission_result, mode, deferred_writer, tmp_out_file);
+    void apply_stage()
+    {
+        s_prompts_deferred = true;
+        const bool may_prompt = !m_context.options.batch && !m_context.options.force;
+
+        while (auto item = m_to_apply.pop()) {
+            if (item->file && !item->error && !m_has_error) {
+                StageTimer timer(m_context.apply_stats);
+                if (may_prompt)
+                    item->applied_file.reset(new FileToPatch(*item->file));
+
+                try {
+                    apply_loaded_file(item->applied_file ? *item->applied_file : *item->file, item->loaded, item->applied, m_context, item->output);
+                } catch (const prompt_deferred&) {
+                    item->needs_prompt = true;
+                } catch (...) {
+                    item->error = std::current_exception();
+                }
             }
+            m_to_write.push(std::move(item));
+        }
+        m_to_write.push(nullptr);
+    }
 
-            if (result.failed_hunks == 0) {
-                if (write_to_file && patch.operation == Operation::Rename)
-                    remove_file_and_empty_parent_folders(file_to_patch);
+    void write_stage()
+    {
+        while (auto item = m_to_write.pop()) {
+            if (!m_has_error) {
+                try {
+                    write_item(*item);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_error = std::current_exception();
+                    m_has_error = true;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_completed;
+            m_item_completed.notify_all();
+        }
+    }
+
+    void write_item(Item& item)
+    {
+        m_out << item.preceding_output;
+        if (!item.file)
+            return;
+
+        bool had_failure;
+        if (item.needs_prompt) {
+            // Now that everything before this patch has been written, apply it again
+            // from here where the user can be asked. A file read as it was patched has
+            // already been read from, so is loaded again to read it from the start.
+            item.applied = AppliedFile();
+            if (item.loaded.is_streamed) {
+                item.loaded = LoadedFile();
+                load_file(*item.file, item.loaded, m_context);
+            }
+            apply_loaded_file(*item.file, item.loaded, item.applied, m_context, m_out);
+            StageTimer timer(m_context.write_stats);
+            had_failure = write_applied_file(*item.file, item.applied, m_context, m_out);
+        } else {
+            m_out << item.output.str();
+            if (item.error)
+                std::rethrow_exception(item.error);
+
+            StageTimer timer(m_context.write_stats);
+            had_failure = write_applied_file(item.applied_file ? *item.applied_file : *item.file, item.applied, m_context, m_out);
+        }
+
+        if (had_failure) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_had_failure = true;
+        }
+    }
+
+    SpscQueue<std::unique_ptr<Item>> m_to_load;
+    SpscQueue<std::unique_ptr<Item>> m_to_apply;
+    SpscQueue<std::unique_ptr<Item>> m_to_write;
+
+    std::thread m_loader;
+    std::thread m_applier;
+    std::thread m_writer;
+
+    size_t m_submitted { 0 };
+
+    std::mutex m_mutex;
+    std::condition_variable m_item_completed;
+    size_t m_completed { 0 };
+    bool m_had_failure { false };
+    std::exception_ptr m_error;
+    std::atomic<bool> m_has_error { false };
+};
+
+constexpr size_t Pipeline::queue_capacity;
+
+static std::string take_output(std::ostringstream& stream)
+{
+    auto output = stream.str();
+    stream.str({});
+    return output;
+}
+
+// Every file held until the end of the run is written, even if some of them fail to be. As
+// with any other file which fails to be written, the first failure is the error for the run
+// (unless it already has one), and the rest are reported here.
+static void report_write_errors(std::ostream& out, const std::vector<std::exception_ptr>& write_errors, std::exception_ptr& error)
+{
+    for (const auto& write_error : write_errors) {
+        if (!error) {
+            error = write_error;
+            continue;
+        }
+
+        try {
+            std::rethrow_exception(write_error);
+        } catch (const std::exception& e) {
+            out << e.what() << '\n';
+        }
+    }
+}
+
+static void print_stats(std::ostream& out, const PatchContext& context, std::chrono::steady_clock::duration wall_time)
+{
+    const double wall_ms = std::chrono::duration<double, std::milli>(wall_time).count();
+
+    auto print_stage = [&](const char* name, const StageStats& stats) {
+        const double busy_ms = static_cast<double>(stats.busy_nanoseconds.load()) / 1e6;
+        out << "  " << name << ": " << stats.items.load() << " files, " << busy_ms << "ms busy ("
+            << (wall_ms > 0 ? busy_ms * 100 / wall_ms : 0) << "% utilization)\n";
+    };
+
+    out << "patch statistics:\n";
+    out << "  wall time: " << wall_ms << "ms\n";
+    print_stage("parse", context.parse_stats);
+    print_stage("load", context.load_stats);
+    print_stage("apply", context.apply_stats);
+    print_stage("write", context.write_stats);
+    print_stage("write-behind", context.write_behind_stats);
+
+    const auto& prefetcher = context.prefetcher;
+    out << "  prefetch: " << prefetcher.prefetched() << " files, " << prefetcher.hits() << " of " << prefetcher.loaded()
+        << " loaded were already in memory (" << (prefetcher.loaded() > 0 ? prefetcher.hits() * 100.0 / prefetcher.loaded() : 0) << "% hit rate)\n";
+
+    if (context.durable_writes.enabled()) {
+        const double durable_ms = std::chrono::duration<double, std::milli>(context.durable_time).count();
+        out << "  durable: " << context.durable_summary.files << " files, " << context.durable_summary.directories << " directories, "
+            << durable_ms << "ms" << (context.durable_summary.synced_filesystem ? " (synced filesystem)" : "") << '\n';
+    }
+}
+
+// Apply a patch to a single file read from stdin, writing the result to stdout as it goes
+// (for --filter). Anything else that would have been written to stdout goes to stderr.
+static int filter_patch(const Options& options)
+{
+    if (options.patch_file_path == "-")
+        throw std::invalid_argument("the patch can not be read from stdin, as the file to patch is read from there");
+
+    // Without a limit on how far away a hunk may be, the whole input may need to be held to
+    // find it.
+    Options filter_options = options;
+    if (filter_options.max_offset < 0)
+        filter_options.max_offset = 10000;
+
+    auto& out = std::cerr;
+    PatchFile patch_file(filter_options);
+    Parser parser(patch_file.file());
+    const auto format = diff_format_from_options(filter_options);
+
+    Patch patch(format);
+    PatchHeaderInfo info;
+    if (parser.parse_patch_header(patch, info, filter_options.strip_size))
+        parser.parse_patch_body(patch);
+
+    if (patch.format == Format::Unknown)
+        throw std::invalid_argument("Only garbage was found in the patch input.");
+    if (patch.format == Format::Ed || patch.is_git_binary)
+        throw std::invalid_argument("only unified, context and normal format patches can be used as a filter");
+
+    // Everything is checked before anything is written, as there is nowhere else to send
+    // the patched output.
+    if (!parser.is_eof()) {
+        Patch next_patch(format);
+        PatchHeaderInfo next_info;
+        parser.parse_patch_header(next_patch, next_info, filter_options.strip_size);
+        if (next_patch.format != Format::Unknown)
+            throw std::invalid_argument("only a patch to a single file can be used as a filter");
+    }
+
+    std::ios::openmode binary = {};
+    if (filter_options.newline_output != Options::NewlineOutput::Native)
+        binary = std::ios::binary;
+    const std::ios::openmode mode = binary | std::ios::out;
+
+    File input_file = File::standard_stream(stdin, binary | std::ios::in);
+    File output_file = File::standard_stream(stdout, mode);
+
+    File reject_file;
+    if (!filter_options.reject_file_path.empty() && !filter_options.dry_run)
+        reject_file = File(filter_options.reject_file_path, mode | std::ios::trunc);
+    RejectWriter reject_writer = reject_file ? RejectWriter(patch, reject_file, filter_options.reject_format) : RejectWriter(patch);
+
+    const auto result = apply_patch_streaming(output_file, reject_writer, input_file, patch, filter_options, out);
+
+    if (result.failed_hunks != 0) {
+        inform_hunks_failed(out, result.was_skipped ? "ignored" : "FAILED", patch.hunks, result.failed_hunks);
+        if (reject_file)
+            out << " -- saving rejects to file " << filter_options.reject_file_path;
+        out << '\n';
+    }
+
+    return result.failed_hunks != 0 ? 1 : 0;
+}
+
+int process_patch(const Options& options)
+{
+    if (options.show_help) {
+        show_usage(std::cout);
+        return 0;
+    }
+
+    if (options.show_version) {
+        show_version(std::cout);
+        return 0;
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    BaseDirectory base_directory(options.patch_directory_path);
+
+    if (options.filter)
+        return filter_patch(options);
+
+    PatchContext context(options);
+
+    // When writing the patched file to cout - write any prompts to cerr instead.
+    context.output_to_stdout = options.out_file_path == "-";
+    auto& out = context.output_to_stdout ? std::cerr : std::cout;
+
+    PatchFile patch_file(options);
+
+    const auto format = diff_format_from_options(options);
+
+    bool had_failure = false;
+    bool first_patch = true;
+
+    // Files are patched in the background, so the output for each patch is buffered
+    // until everything before it has been written.
+    std::unique_ptr<BackgroundApplier> applier;
+    if (options.jobs > 1 && !context.output_to_stdout)
+        applier.reset(new ParallelApplier(context, out));
+    else
+        applier.reset(new Pipeline(context, out));
+
+    std::ostringstream patch_out;
+
+    Parser parser(patch_file.file());
+
+    // With more than one job, the patches can also be parsed at the same time as each other.
+    if (options.jobs > 1)
+        parser.parse_ahead(format, options.strip_size, static_cast<size_t>(options.jobs));
+
+    std::exception_ptr error;
+    try {
+        // Continue parsing patches from the input file and applying them.
+        while (!parser.is_eof() && !applier->has_error()) {
+            applier->add_output(take_output(patch_out));
+
+            Patch patch(format);
+            PatchHeaderInfo info;
+            bool should_parse_body;
+            {
+                StageTimer timer(context.parse_stats);
+                should_parse_body = parser.parse_patch_header(patch, info, options.strip_size);
             }
+
+            if (patch.format == Format::Unknown) {
+                if (first_patch)
+                    throw std::invalid_argument("Only garbage was found in the patch input.");
+                if (options.verbose)
+                    patch_out << "Hmm...  Ignoring the trailing garbage.\n";
+                break;
+            }
+
+            first_patch = false;
+
+            if (patch.is_git_binary && !supports_git_binary_patches()) {
+                if (should_parse_body)
+                    parser.skip_patch_body(patch);
+                patch_out << "File " << (options.reverse_patch ? patch.new_file_path : patch.old_file_path) << ": git binary diffs are not supported.\n";
+                had_failure = true;
+                continue;
+            }
+
+            if (patch.format == Format::Ed && options.reverse_patch)
+                throw std::invalid_argument("ed scripts can not be reversed");
+
+            if (options.verbose) {
+                if (patch.format == Format::Ed)
+                    patch_out << "Hmm...  Looks like an ed script to me...\n";
+                else
+                    patch_out << "Hmm...  Looks like a " << to_string(info.format) << " diff to me...\n";
+            }
+
+            // Which file is patched depends on what exists, so wait for any earlier patches
+            // which may be adding or removing the file.
+            applier->wait_for_path(options.file_to_patch);
+            applier->wait_for_path(patch.old_file_path);
+            applier->wait_for_path(patch.new_file_path);
+            applier->wait_for_path(patch.index_file_path);
+
+            auto file_to_patch = options.file_to_patch.empty() ? guess_filepath(patch, context.stat_cache) : options.file_to_patch;
+
+            if (file_to_patch.empty()) {
+                patch_out << "can't find file to patch at input line " << parser.line_number()
+                          << "\nPerhaps you "
+                          << (options.strip_size == -1 ? "should have used the" : "used the wrong")
+                          << " -p or --strip option?\n";
+            }
+
+            if (options.verbose || file_to_patch.empty())
+                parser.print_header_info(info, patch_out);
+
+            if (file_to_patch.empty()) {
+                // Everything before the prompt needs to be shown before asking for the file.
+                applier->add_output(take_output(patch_out));
+                had_failure |= applier->finish();
+                file_to_patch = prompt_for_filepath(out);
+            }
+
+            if (file_to_patch.empty()) {
+                if (should_parse_body)
+                    parser.skip_patch_body(patch);
+
+                patch_out << "Skipping patch.\n";
+                inform_hunks_failed(patch_out, "ignored", patch.hunks, patch.hunks.size());
+                patch_out << '\n';
+                had_failure = true;
+                continue;
+            }
+
+            const auto output_file = output_path(options, patch, file_to_patch);
+            const std::vector<std::string> paths_used { file_to_patch, output_file, reject_path(options, output_file) };
+            for (const auto& path : paths_used)
+                applier->wait_for_path(path);
+
+            std::ios::openmode mode = std::ios::out;
+            if (options.newline_output != Options::NewlineOutput::Native || patch.is_git_binary)
+                mode |= std::ios::binary;
+
+            if (context.stat_cache.exists(file_to_patch) && !context.stat_cache.is_regular_file(file_to_patch)) {
+                const auto body = skip_refused_patch_body(parser, patch, should_parse_body);
+                patch_out << "File " << file_to_patch << " is not a regular file --";
+                refuse_to_patch(patch_out, mode, output_file, patch, body, options, context.stat_cache, context.durable_writes);
+                had_failure = true;
+                continue;
+            }
+
+            auto permission_result = fix_permissions_if_needed(patch_out, options, output_file, context.stat_cache);
+            if (permission_result.had_failure) {
+                const auto body = skip_refused_patch_body(parser, patch, should_parse_body);
+                refuse_to_patch(patch_out, mode, output_file, patch, body, options, context.stat_cache, context.durable_writes);
+                had_failure = true;
+                continue;
+            }
+
+            // Start reading the file while the rest of the patch is parsed, and any patches
+            // ahead of it are applied. Files patched before are already held in memory.
+            if (context.stat_cache.is_regular_file(file_to_patch) && !context.resident_files.contains(file_to_patch))
+                context.prefetcher.prefetch(file_to_patch);
+
+            auto file = std::make_shared<FileToPatch>(FileToPatch { std::move(patch), file_to_patch, output_file, mode, permission_result, nullptr });
+
+            if (should_parse_body) {
+                StageTimer timer(context.parse_stats);
+                try {
+                    parser.parse_patch_body(file->patch);
+                } catch (...) {
+                    file->parse_error = std::current_exception();
+                }
+            }
+
+            // Nothing after an error parsing the patch can be parsed.
+            const bool had_parse_error = static_cast<bool>(file->parse_error);
+            applier->apply(std::move(file), take_output(patch_out), paths_used);
+            if (had_parse_error)
+                break;
         }
+    } catch (...) {
+        error = std::current_exception();
     }
 
-    deferred_writer.finalize();
+    // Write the output of any patches before an error first, reporting their errors instead.
+    applier->add_output(take_output(patch_out));
+    try {
+        had_failure |= applier->finish();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    applier.reset();
+
+    // Anything patched before an error is still written. Should that fail too, it is the
+    // error which happened first which is reported.
+    try {
+        report_write_errors(out, context.resident_files.write_all(context.write_behind, context.write_behind_stats), error);
+        if (!error)
+            context.deferred_writer.finalize(context.durable_writes, context.write_behind, context.write_behind_stats);
+    } catch (...) {
+        if (!error)
+            error = std::current_exception();
+    }
+
+    // Whatever was written before an error should make it to disk too.
+    const auto durable_start = std::chrono::steady_clock::now();
+    try {
+        context.durable_summary = context.durable_writes.sync();
+    } catch (...) {
+        if (!error)
+            error = std::current_exception();
+    }
+    context.durable_time = std::chrono::steady_clock::now() - durable_start;
+
+    if (error)
+        std::rethrow_exception(error);
 
     if (options.verbose)
         out << "done\n";
 
+    if (options.show_stats)
+        print_stats(std::cerr, context, std::chrono::steady_clock::now() - start_time);
+
     return had_failure ? 1 : 0;
 }
 
@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#include <algorithm>
+#include <patch/piece_table.h>
+#include <stdexcept>
+
+namespace Patch {
+
+template<typename Lines>
+BasicPieceTable<Lines>::BasicPieceTable(const Lines& original)
+    : m_original(original)
+    , m_size(original.size())
+{
+    if (!original.empty())
+        m_pieces.push_back({ true, 0, original.size() });
+}
+
+template<typename Lines>
+void BasicPieceTable<Lines>::append(std::vector<Piece>& pieces, const Piece& piece)
+{
+    // Extend the last piece where possible so that runs of lines stay as one piece.
+    if (!pieces.empty()) {
+        auto& last = pieces.back();
+        if (last.is_original == piece.is_original && last.start + last.count == piece.start) {
+            last.count += piece.count;
+            return;
+        }
+    }
+
+    pieces.push_back(piece);
+}
+
+template<typename Lines>
+void BasicPieceTable<Lines>::append_original(std::vector<Piece>& pieces, size_t line) const
+{
+    if (line >= m_original.size())
+        throw std::out_of_range("line is past the end of the file");
+    append(pieces, { true, line, 1 });
+}
+
+template<typename Lines>
+void BasicPieceTable<Lines>::append_added(std::vector<Piece>& pieces, LineView line)
+{
+    m_added.push_back(line);
+    append(pieces, { false, m_added.size() - 1, 1 });
+}
+
+template<typename Lines>
+void BasicPieceTable<Lines>::append_added(std::vector<Piece>& pieces, const Line& line)
+{
+    append_added(pieces, LineView(line));
+}
+
+template<typename Lines>
+void BasicPieceTable<Lines>::append_added(std::vector<Piece>& pieces, Line&& line)
+{
+    m_owned.push_back(std::move(line));
+    append_added(pieces, m_owned.back());
+}
+
+template<typename Lines>
+size_t BasicPieceTable<Lines>::split_at(size_t line)
+{
+    size_t piece_start = 0;
+    for (size_t i = 0; i < m_pieces.size(); ++i) {
+        auto& piece = m_pieces[i];
+        if (piece_start == line)
+            return i;
+
+        if (line < piece_start + piece.count) {
+            const auto offset = line - piece_start;
+            const Piece second { piece.is_original, piece.start + offset, piece.count - offset };
+            piece.count = offset;
+            m_pieces.insert(m_pieces.begin() + static_cast<std::ptrdiff_t>(i) + 1, second);
+            return i + 1;
+        }
+
+        piece_start += piece.count;
+    }
+
+    return m_pieces.size();
+}
+
+template<typename Lines>
+void BasicPieceTable<Lines>::replace(size_t start, size_t count, const std::vector<Piece>& replacement)
+{
+    if (start + count > m_size)
+        throw std::out_of_range("replaced lines are past the end of the file");
+
+    const auto first = split_at(start);
+    const auto last = split_at(start + count);
+
+    m_pieces.erase(m_pieces.begin() + static_cast<std::ptrdiff_t>(first), m_pieces.begin() + static_cast<std::ptrdiff_t>(last));
+    m_pieces.insert(m_pieces.begin() + static_cast<std::ptrdiff_t>(first), replacement.begin(), replacement.end());
+
+    m_size -= count;
+    for (const auto& piece : replacement)
+        m_size += piece.count;
+}
+
+template<typename Lines>
+void BasicPieceTable<Lines>::apply(std::vector<Edit>& edits)
+{
+    std::stable_sort(edits.begin(), edits.end(), [](const Edit& a, const Edit& b) {
+        return a.start < b.start;
+    });
+
+    std::vector<Piece> pieces;
+    pieces.reserve(m_pieces.size() + edits.size() * 2);
+
+    auto piece = m_pieces.begin();
+    size_t piece_offset = 0;
+    size_t line = 0;
+
+    // Move along the current pieces up to the given line, keeping them if asked to.
+    auto advance_to = [&](size_t target, bool keep) {
+        while (line < target && piece != m_pieces.end()) {
+            const auto count = std::min(piece->count - piece_offset, target - line);
+            if (keep)
+                append(pieces, { piece->is_original, piece->start + piece_offset, count });
+
+            line += count;
+            piece_offset += count;
+            if (piece_offset == piece->count) {
+                ++piece;
+                piece_offset = 0;
+            }
+        }
+    };
+
+    size_t size = m_size;
+    for (const auto& edit : edits) {
+        const auto end = std::max(edit.end, line);
+        if (end > m_size)
+            throw std::out_of_range("replaced lines are past the end of the file");
+
+        advance_to(edit.start, true);
+        size -= end - line;
+        advance_to(end, false);
+
+        for (const auto& replacement : edit.replacement) {
+            append(pieces, replacement);
+            size += replacement.count;
+        }
+    }
+    advance_to(m_size, true);
+
+    m_pieces = std::move(pieces);
+    m_size = size;
+}
+
+template class BasicPieceTable<std::vector<Line>>;
+template class BasicPieceTable<LineBuffer>;
+
+} // namespace Patch
@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#include <patch/stat_cache.h>
+#include <patch/system.h>
+#include <stdexcept>
+#include <system_error>
+
+namespace Patch {
+
+filesystem::Status StatCache::status(const std::string& path)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_statuses.find(path);
+        if (it != m_statuses.end())
+            return it->second;
+    }
+
+    const auto status = filesystem::status(path);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_statuses.emplace(path, status);
+    return status;
+}
+
+void StatCache::update(const std::string& path, const filesystem::Status& status)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_statuses[path] = status;
+}
+
+void StatCache::invalidate(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_statuses.erase(path);
+}
+
+void StatCache::ensure_parent_directories(const std::string& file_path)
+{
+    if (file_path.empty())
+        throw std::system_error(std::make_error_code(std::errc::invalid_argument), "Invalid path to create directories");
+
+    const auto parent = file_path.substr(0, file_path.find_last_of('/') + 1);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Most added files are next to another which has already been added.
+    if (parent.empty() || m_directories.count(parent.substr(0, parent.size() - 1)))
+        return;
+
+    size_t pos = 0;
+    while ((pos = parent.find_first_of('/', pos)) != std::string::npos) {
+        auto dir = parent.substr(0, pos++);
+        if (dir.empty() || m_directories.count(dir))
+            continue;
+
+        filesystem::create_directory(dir);
+        m_statuses.erase(dir);
+        m_directories.insert(std::move(dir));
+    }
+}
+
+void StatCache::remove_file_and_empty_parent_folders(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Patch::remove_file_and_empty_parent_folders(path);
+    m_statuses.erase(path);
+    forget_parent_directories(path);
+}
+
+void StatCache::remove_empty_parent_folders(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Patch::remove_empty_parent_folders(path);
+    forget_parent_directories(path);
+}
+
+void StatCache::forget_parent_directories(const std::string& path)
+{
+    // Any of the parent directories may have been removed.
+    auto dir = path;
+    size_t pos;
+    while ((pos = dir.find_last_of('/')) != std::string::npos) {
+        dir.resize(pos);
+        m_statuses.erase(dir);
+        m_directories.erase(dir);
+    }
+}
+
+void StatCache::rename(const std::string& old_path, const std::string& new_path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    filesystem::rename(old_path, new_path);
+    m_statuses.erase(old_path);
+    m_statuses.erase(new_path);
+}
+
+void StatCache::permissions(const std::string& path, filesystem::perms permissions)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    filesystem::permissions(path, permissions);
+    m_statuses.erase(path);
+}
+
+} // namespace Patch
@@ -11,16 +11,23 @@
 #include <ctime>
 #include <fcntl.h>
 #include <functional>
+#include <initializer_list>
 #include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <patch/system.h>
 #include <random>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <system_error>
+#include <unordered_map>
+#include <vector>
 
 #ifdef _WIN32
 #    include <direct.h>
 #    include <io.h>
+#    include <sys/utime.h>
 #    include <windows.h>
 #    define close _close
 #    define read _read
@@ -30,6 +37,17 @@
 #    include <unistd.h>
 #endif
 
+#ifdef __linux__
+#    include <linux/fs.h>
+#    include <sys/ioctl.h>
+#    include <sys/mman.h>
+#endif
+
+#ifdef PATCH_HAVE_IO_URING
+#    include <linux/io_uring.h>
+#    include <sys/syscall.h>
+#endif
+
 namespace Patch {
 
 static std::mt19937 random_generator()
@@ -58,6 +76,485 @@ static std::string generate_random_alphanumeric_string(std::size_t len)
     return result;
 }
 
+#ifndef _WIN32
+
+namespace {
+
+// An open directory which paths can be looked up relative to with the *at() family of
+// syscalls. Closed once the last path resolved relative to it is finished with.
+class DirectoryHandle {
+public:
+    explicit DirectoryHandle(int fd)
+        : m_fd(fd)
+    {
+    }
+
+    ~DirectoryHandle()
+    {
+        if (m_fd >= 0)
+            ::close(m_fd);
+    }
+
+    DirectoryHandle(const DirectoryHandle&) = delete;
+    DirectoryHandle& operator=(const DirectoryHandle&) = delete;
+
+    int fd() const { return m_fd; }
+
+private:
+    int m_fd;
+};
+
+// A path split up into the directory containing it, and the name within that directory.
+struct ResolvedPath {
+    std::shared_ptr<DirectoryHandle> directory;
+    std::string name;
+
+    int fd() const { return directory->fd(); }
+    const char* c_str() const { return name.c_str(); }
+};
+
+// Keeps descriptors of recently used directories open so that the kernel only needs to
+// walk each directory of a deep path once, rather than on every operation on a file
+// inside of it. Relative paths are looked up from the base directory, which is the
+// current working directory unless changed through set_base_directory().
+class DirectoryCache {
+public:
+    explicit DirectoryCache(size_t capacity)
+        : m_base(std::make_shared<DirectoryHandle>(AT_FDCWD))
+        , m_capacity(capacity)
+    {
+    }
+
+    void set_base_directory(const std::string& path)
+    {
+        auto base = std::make_shared<DirectoryHandle>(AT_FDCWD);
+
+        if (!path.empty()) {
+            base = std::make_shared<DirectoryHandle>(::open(path.c_str(), directory_flags));
+            if (base->fd() < 0 || ::faccessat(base->fd(), ".", X_OK, 0) != 0)
+                throw std::system_error(errno, std::generic_category(), "Can't change to directory " + path + " ");
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_base = std::move(base);
+        m_directories.clear();
+        m_recently_used.clear();
+    }
+
+    ResolvedPath resolve(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Absolute paths and paths naming a directory are left for the kernel to look up
+        // in full. So is anything with a parent directory which could not be opened, so
+        // that whatever error the kernel gives for that path is reported as usual.
+        const auto slash = path.find_last_of('/');
+        if (slash == std::string::npos || slash == 0 || slash + 1 == path.size() || path[0] == '/')
+            return { m_base, path };
+
+        auto directory = open_directory(normalized(path.substr(0, slash)));
+        if (!directory)
+            return { m_base, path };
+
+        return { std::move(directory), path.substr(slash + 1) };
+    }
+
+    // Stop using the given directory, or any beneath it, e.g after it has been removed or
+    // renamed. Anything looked up through a parent directory ('..') is forgotten too, as
+    // there is no telling which directory it is without asking the kernel.
+    void forget(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        const auto directory = normalized(path);
+        const auto prefix = directory + '/';
+        for (auto it = m_directories.begin(); it != m_directories.end();) {
+            if (it->first == directory || it->first.compare(0, prefix.size(), prefix) == 0 || has_parent_component(it->first)) {
+                m_recently_used.erase(it->second.position);
+                it = m_directories.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+private:
+    // The same directory can be named in more than one way, so the directories are kept by
+    // their path without any repeated slashes, '.' components or trailing slash.
+    static std::string normalized(const std::string& path)
+    {
+        std::string result;
+        size_t start = 0;
+        while (start <= path.size()) {
+            auto end = path.find('/', start);
+            if (end == std::string::npos)
+                end = path.size();
+
+            const auto length = end - start;
+            if (length != 0 && !(length == 1 && path[start] == '.')) {
+                if (!result.empty())
+                    result += '/';
+                result.append(path, start, length);
+            }
+
+            start = end + 1;
+        }
+
+        return result;
+    }
+
+    static bool has_parent_component(const std::string& path)
+    {
+        return path == ".." || path.compare(0, 3, "../") == 0 || path.find("/../") != std::string::npos
+            || (path.size() >= 3 && path.compare(path.size() - 3, 3, "/..") == 0);
+    }
+
+#    ifdef O_PATH
+    static constexpr int directory_flags = O_PATH | O_DIRECTORY | O_CLOEXEC;
+#    else
+    static constexpr int directory_flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+#    endif
+
+    std::shared_ptr<DirectoryHandle> open_directory(const std::string& path)
+    {
+        auto it = m_directories.find(path);
+        if (it != m_directories.end()) {
+            m_recently_used.splice(m_recently_used.begin(), m_recently_used, it->second.position);
+            return it->second.handle;
+        }
+
+        // Each directory is opened relative to its (possibly already open) parent.
+        auto parent = m_base;
+        std::string name = path;
+
+        const auto slash = path.find_last_of('/');
+        if (slash != std::string::npos) {
+            if (slash == 0)
+                return nullptr;
+            parent = open_directory(path.substr(0, slash));
+            if (!parent)
+                return nullptr;
+            name = path.substr(slash + 1);
+        }
+
+        if (name.empty())
+            return nullptr;
+
+        int fd = ::openat(parent->fd(), name.c_str(), directory_flags);
+        if (fd < 0)
+            return nullptr;
+
+        auto handle = std::make_shared<DirectoryHandle>(fd);
+
+        m_recently_used.push_front(path);
+        m_directories.emplace(path, Entry { handle, m_recently_used.begin() });
+
+        if (m_directories.size() > m_capacity) {
+            m_directories.erase(m_recently_used.back());
+            m_recently_used.pop_back();
+        }
+
+        return handle;
+    }
+
+    struct Entry {
+        std::shared_ptr<DirectoryHandle> handle;
+        std::list<std::string>::iterator position;
+    };
+
+    std::mutex m_mutex;
+    std::shared_ptr<DirectoryHandle> m_base;
+    std::unordered_map<std::string, Entry> m_directories;
+    std::list<std::string> m_recently_used;
+    size_t m_capacity;
+};
+
+DirectoryCache& directory_cache()
+{
+    static DirectoryCache cache(64);
+    return cache;
+}
+
+ResolvedPath resolve(const std::string& path)
+{
+    return directory_cache().resolve(path);
+}
+
+} // namespace
+
+#endif
+
+#ifdef PATCH_HAVE_IO_URING
+
+namespace {
+
+// Just enough of io_uring to submit a batch of file operations and wait for all of them to
+// complete, using the system calls directly so that liburing is not needed.
+class IoUring {
+public:
+    // Returns nullptr if io_uring can not be used, such as on an older kernel, or where it
+    // has been disabled.
+    static std::unique_ptr<IoUring> create(unsigned entries)
+    {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+
+        const int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0)
+            return nullptr;
+
+        std::unique_ptr<IoUring> ring(new IoUring(fd));
+        if (!ring->map(params) || !ring->supports({ IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_CLOSE }))
+            return nullptr;
+
+        return ring;
+    }
+
+    ~IoUring()
+    {
+        if (m_sqes != MAP_FAILED)
+            ::munmap(m_sqes, m_sqes_size);
+        if (m_cq_ring != MAP_FAILED && m_cq_ring != m_sq_ring)
+            ::munmap(m_cq_ring, m_cq_ring_size);
+        if (m_sq_ring != MAP_FAILED)
+            ::munmap(m_sq_ring, m_sq_ring_size);
+        ::close(m_fd);
+    }
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // How many entries can be submitted at once.
+    unsigned capacity() const { return m_sq_entries; }
+
+    // The next entry to be submitted, which is given back with its result once it completes.
+    io_uring_sqe& next_entry(uint64_t user_data)
+    {
+        const unsigned index = m_sq_local_tail++ & *m_sq_mask;
+        io_uring_sqe& entry = m_sqes[index];
+        std::memset(&entry, 0, sizeof(entry));
+        entry.user_data = user_data;
+        m_sq_array[index] = index;
+        ++m_unsubmitted;
+        return entry;
+    }
+
+    // Submit every entry given since the last submission, and wait for each of them to
+    // complete, calling the function with the user data and result of each.
+    template<typename OnCompletion>
+    void submit_and_wait(OnCompletion on_completion)
+    {
+        __atomic_store_n(m_sq_tail, m_sq_local_tail, __ATOMIC_RELEASE);
+
+        unsigned to_submit = m_unsubmitted;
+        unsigned to_complete = m_unsubmitted;
+        m_unsubmitted = 0;
+
+        while (to_complete > 0) {
+            const int submitted = static_cast<int>(::syscall(__NR_io_uring_enter, m_fd, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+            if (submitted < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw std::system_error(errno, std::generic_category(), "Unable to submit file operations");
+            }
+            to_submit -= std::min(to_submit, static_cast<unsigned>(submitted));
+
+            unsigned head = *m_cq_head;
+            const unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head) {
+                const io_uring_cqe& completion = m_cqes[head & *m_cq_mask];
+                on_completion(completion.user_data, completion.res);
+                --to_complete;
+            }
+            __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+        }
+    }
+
+private:
+    explicit IoUring(int fd)
+        : m_fd(fd)
+    {
+    }
+
+    bool map(const io_uring_params& params)
+    {
+        m_sq_entries = params.sq_entries;
+        m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+        // Both rings may be mapped at once, in which case they share the larger size.
+        const bool single_mapping = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mapping)
+            m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+
+        m_sq_ring = ::mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+        if (m_sq_ring == MAP_FAILED)
+            return false;
+
+        m_cq_ring = single_mapping ? m_sq_ring : ::mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+        if (m_cq_ring == MAP_FAILED)
+            return false;
+
+        m_sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES));
+        if (m_sqes == MAP_FAILED)
+            return false;
+
+        auto* sq = static_cast<char*>(m_sq_ring);
+        m_sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        m_sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        m_sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        m_sq_local_tail = *m_sq_tail;
+
+        auto* cq = static_cast<char*>(m_cq_ring);
+        m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        m_cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        return true;
+    }
+
+    bool supports(std::initializer_list<unsigned> operations)
+    {
+        // The probe is followed by an entry for every operation which may be supported.
+        constexpr unsigned max_operations = 256;
+        std::vector<uint64_t> buffer((sizeof(io_uring_probe) + max_operations * sizeof(io_uring_probe_op)) / sizeof(uint64_t), 0);
+        auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+
+        if (::syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_PROBE, probe, max_operations) < 0)
+            return false;
+
+        return std::all_of(operations.begin(), operations.end(), [probe](unsigned operation) {
+            return operation <= probe->last_op && (probe->ops[operation].flags & IO_URING_OP_SUPPORTED);
+        });
+    }
+
+    int m_fd;
+
+    void* m_sq_ring { MAP_FAILED };
+    void* m_cq_ring { MAP_FAILED };
+    io_uring_sqe* m_sqes { static_cast<io_uring_sqe*>(MAP_FAILED) };
+    size_t m_sq_ring_size { 0 };
+    size_t m_cq_ring_size { 0 };
+    size_t m_sqes_size { 0 };
+
+    unsigned m_sq_entries { 0 };
+    unsigned* m_sq_tail { nullptr };
+    unsigned* m_sq_mask { nullptr };
+    unsigned* m_sq_array { nullptr };
+    unsigned m_sq_local_tail { 0 };
+    unsigned m_unsubmitted { 0 };
+
+    unsigned* m_cq_head { nullptr };
+    unsigned* m_cq_tail { nullptr };
+    unsigned* m_cq_mask { nullptr };
+    io_uring_cqe* m_cqes { nullptr };
+};
+
+// Write a batch of files, which takes three entries of the ring for each file.
+void write_batch(IoUring& ring, const std::vector<filesystem::FileContent>& files, size_t start, size_t end)
+{
+    struct State {
+        ResolvedPath path;
+        int fd { -1 };
+        int open_error { 0 };
+        int write_error { 0 };
+        size_t written { 0 };
+        bool closed { false };
+    };
+
+    std::vector<State> states(end - start);
+
+    // Open every file first, as what is written to each depends on which were opened.
+    for (size_t i = 0; i < states.size(); ++i) {
+        auto& state = states[i];
+        state.path = resolve(files[start + i].path);
+
+        auto& entry = ring.next_entry(i);
+        entry.opcode = IORING_OP_OPENAT;
+        entry.fd = state.path.fd();
+        entry.addr = reinterpret_cast<uintptr_t>(state.path.c_str());
+        entry.open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        entry.len = 0666;
+    }
+
+    ring.submit_and_wait([&states](uint64_t i, int32_t result) {
+        if (result < 0)
+            states[i].open_error = -result;
+        else
+            states[i].fd = result;
+    });
+
+    // Then write each of them, closing them once written. Should the write fail or only be
+    // partly done, the close is cancelled and left to be done below.
+    constexpr size_t max_write = 1 << 30;
+    for (size_t i = 0; i < states.size(); ++i) {
+        if (states[i].fd < 0)
+            continue;
+
+        const auto& content = files[start + i].content;
+        if (!content.empty()) {
+            auto& write = ring.next_entry(i * 2);
+            write.opcode = IORING_OP_WRITE;
+            write.fd = states[i].fd;
+            write.addr = reinterpret_cast<uintptr_t>(content.data());
+            write.len = static_cast<uint32_t>(std::min(content.size(), max_write));
+            write.off = 0;
+            write.flags = IOSQE_IO_LINK;
+        }
+
+        auto& close = ring.next_entry(i * 2 + 1);
+        close.opcode = IORING_OP_CLOSE;
+        close.fd = states[i].fd;
+    }
+
+    ring.submit_and_wait([&states](uint64_t user_data, int32_t result) {
+        auto& state = states[user_data / 2];
+        if (user_data % 2 == 0) {
+            if (result < 0)
+                state.write_error = -result;
+            else
+                state.written = static_cast<size_t>(result);
+        } else {
+            state.closed = result != -ECANCELED;
+        }
+    });
+
+    for (size_t i = 0; i < states.size(); ++i) {
+        auto& state = states[i];
+        if (state.fd < 0)
+            continue;
+
+        const auto& content = files[start + i].content;
+        while (state.write_error == 0 && state.written < content.size()) {
+            const auto n = ::pwrite(state.fd, content.data() + state.written, content.size() - state.written, static_cast<off_t>(state.written));
+            if (n < 0) {
+                if (errno != EINTR)
+                    state.write_error = errno;
+                continue;
+            }
+            state.written += static_cast<size_t>(n);
+        }
+
+        if (!state.closed)
+            ::close(state.fd);
+    }
+
+    // Report the first of the files which could not be written, as if each had been
+    // written in turn.
+    for (size_t i = 0; i < states.size(); ++i) {
+        if (states[i].open_error != 0)
+            throw std::system_error(states[i].open_error, std::generic_category(), "Unable to open file " + files[start + i].path);
+        if (states[i].write_error != 0)
+            throw std::system_error(states[i].write_error, std::generic_category(), "Failed writing content to file");
+    }
+}
+
+} // namespace
+
+#endif
+
 std::string read_tty_until_enter()
 {
     // NOTE: we need to read from /dev/tty and not stdin. This is for two reasons:
@@ -106,11 +603,16 @@ static bool remove_empty_directory(const std::string& path)
 #ifdef _WIN32
     int ret = ::_wrmdir(to_native(path).c_str());
 #else
-    int ret = ::rmdir(path.c_str());
+    const auto resolved = resolve(path);
+    int ret = ::unlinkat(resolved.fd(), resolved.c_str(), AT_REMOVEDIR);
 #endif
 
-    if (ret == 0)
+    if (ret == 0) {
+#ifndef _WIN32
+        directory_cache().forget(path);
+#endif
         return true;
+    }
 
     // POSIX allows for either ENOTEMPTY or EEXIST.
     if (errno != ENOTEMPTY && errno != EEXIST)
@@ -124,12 +626,18 @@ void remove_file_and_empty_parent_folders(std::string path)
 #ifdef _WIN32
     int ret = _wremove(to_native(path).c_str());
 #else
-    int ret = std::remove(path.c_str());
+    const auto resolved = resolve(path);
+    int ret = ::unlinkat(resolved.fd(), resolved.c_str(), 0);
 #endif
 
     if (ret != 0)
         throw std::system_error(errno, std::generic_category(), "Unable to remove file " + path);
 
+    remove_empty_parent_folders(std::move(path));
+}
+
+void remove_empty_parent_folders(std::string path)
+{
     while (true) {
 
         std::size_t i = path.find_last_of('/');
@@ -181,6 +689,16 @@ void chdir(const std::string& path)
         throw std::system_error(errno, std::generic_category(), "Can't change to directory " + path + " ");
 }
 
+void set_base_directory(const std::string& path)
+{
+#ifdef _WIN32
+    if (!path.empty())
+        chdir(path);
+#else
+    directory_cache().set_base_directory(path);
+#endif
+}
+
 std::string current_path()
 {
 #ifdef _WIN32
@@ -239,6 +757,25 @@ FILE* create_temporary_file()
     throw std::system_error(errno, std::generic_category(), "Failed creating temporary file");
 }
 
+FILE* duplicate_file(FILE* file, const std::string& mode)
+{
+#ifdef _WIN32
+    int fd = ::_dup(_fileno(file));
+#else
+    int fd = ::dup(fileno(file));
+#endif
+    if (fd == -1)
+        return nullptr;
+
+    FILE* duplicate = ::fdopen(fd, mode.c_str());
+    if (!duplicate) {
+        const int error = errno;
+        ::close(fd);
+        errno = error;
+    }
+    return duplicate;
+}
+
 namespace filesystem {
 
 std::string temp_directory_path()
@@ -299,7 +836,8 @@ void symlink(const std::string& target, const std::string& linkpath)
     // FIXME: How do we implement this properly on Windows??
     throw std::system_error(ENOSYS, std::generic_category(), "Can't create symbolic link " + target + " ");
 #else
-    int ret = ::symlink(target.c_str(), linkpath.c_str());
+    const auto resolved = resolve(linkpath);
+    int ret = ::symlinkat(target.c_str(), resolved.fd(), resolved.c_str());
     if (ret != 0)
         throw std::system_error(errno, std::generic_category(), "Can't create symbolic link " + target + " ");
 #endif
@@ -328,7 +866,8 @@ bool create_directory(const std::string& path)
 #ifdef _WIN32
     int ret = _wmkdir(to_native(path).c_str());
 #else
-    int ret = mkdir(path.c_str(), 0777);
+    const auto resolved = resolve(path);
+    int ret = ::mkdirat(resolved.fd(), resolved.c_str(), 0777);
 #endif
 
     if (ret != 0) {
@@ -360,8 +899,9 @@ bool exists(const std::string& path)
         return true;
     }
 #else
+    const auto resolved = resolve(path);
     struct stat buf;
-    return ::stat(path.c_str(), &buf) == 0;
+    return ::fstatat(resolved.fd(), resolved.c_str(), &buf, 0) == 0;
 #endif
 }
 
@@ -380,8 +920,9 @@ bool is_regular_file(const std::string& path)
 
     return true;
 #else
+    const auto resolved = resolve(path);
     struct stat buf;
-    return ::stat(path.c_str(), &buf) == 0 && S_ISREG(buf.st_mode);
+    return ::fstatat(resolved.fd(), resolved.c_str(), &buf, 0) == 0 && S_ISREG(buf.st_mode);
 #endif
 }
 
@@ -391,8 +932,9 @@ bool is_symlink(const std::string& path)
     // FIXME: support this
     return false;
 #else
+    const auto resolved = resolve(path);
     struct stat buf;
-    if (::lstat(path.c_str(), &buf) != 0)
+    if (::fstatat(resolved.fd(), resolved.c_str(), &buf, AT_SYMLINK_NOFOLLOW) != 0)
         return false;
 
     return S_ISLNK(buf.st_mode);
@@ -406,8 +948,14 @@ void rename(const std::string& old_path, const std::string& new_path)
     if (MoveFileExW(to_native(old_path).c_str(), to_native(new_path).c_str(), MOVEFILE_REPLACE_EXISTING) == 0)
         throw std::system_error(GetLastError(), std::system_category(), "Unable to rename " + old_path + " to " + new_path);
 #else
-    if (std::rename(old_path.c_str(), new_path.c_str()) != 0)
+    const auto resolved_old = resolve(old_path);
+    const auto resolved_new = resolve(new_path);
+    if (::renameat(resolved_old.fd(), resolved_old.c_str(), resolved_new.fd(), resolved_new.c_str()) != 0)
         throw std::system_error(errno, std::generic_category(), "Unable to rename " + old_path + " to " + new_path);
+
+    // Either path may have been a directory, which is no longer where it was.
+    directory_cache().forget(old_path);
+    directory_cache().forget(new_path);
 #endif
 }
 
@@ -441,7 +989,8 @@ void permissions(const std::string& path, perms permissions)
         throw std::system_error(GetLastError(), std::system_category(), "Unable to set permissions to " + path);
 
 #else
-    if (::chmod(path.c_str(), static_cast<mode_t>(permissions)) != 0)
+    const auto resolved = resolve(path);
+    if (::fchmodat(resolved.fd(), resolved.c_str(), static_cast<mode_t>(permissions), 0) != 0)
         throw std::system_error(errno, std::generic_category(), "Unable to change permissions for " + path);
 #endif
 }
@@ -461,14 +1010,54 @@ perms get_permissions(const std::string& path)
     return permissions;
 #else
 
+    const auto resolved = resolve(path);
     struct stat buf;
-    if (::stat(path.c_str(), &buf) != 0)
+    if (::fstatat(resolved.fd(), resolved.c_str(), &buf, 0) != 0)
         return perms::unknown;
 
     return static_cast<perms>(buf.st_mode) & perms::mask;
 #endif
 }
 
+FILE* fopen(const std::string& path, const std::string& mode)
+{
+#ifdef _WIN32
+    return ::_wfopen(to_native(path).c_str(), to_native(mode).c_str());
+#else
+    int flags = O_CLOEXEC;
+    const bool update = mode.find('+') != std::string::npos;
+
+    switch (mode.empty() ? '\0' : mode[0]) {
+    case 'r':
+        flags |= update ? O_RDWR : O_RDONLY;
+        break;
+    case 'w':
+        flags |= (update ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC;
+        break;
+    case 'a':
+        flags |= (update ? O_RDWR : O_WRONLY) | O_CREAT | O_APPEND;
+        break;
+    default:
+        errno = EINVAL;
+        return nullptr;
+    }
+
+    const auto resolved = resolve(path);
+    int fd = ::openat(resolved.fd(), resolved.c_str(), flags, 0666);
+    if (fd < 0)
+        return nullptr;
+
+    FILE* file = ::fdopen(fd, mode.c_str());
+    if (!file) {
+        int saved_errno = errno;
+        ::close(fd);
+        errno = saved_errno;
+    }
+
+    return file;
+#endif
+}
+
 uintmax_t file_size(FILE* file)
 {
     struct stat buf;
@@ -478,6 +1067,295 @@ uintmax_t file_size(FILE* file)
     return buf.st_size;
 }
 
+bool copy_file_contents(FILE* from, FILE* to)
+{
+#ifdef __linux__
+    const int from_fd = fileno(from);
+    const int to_fd = fileno(to);
+
+#    ifdef FICLONE
+    // Share the data of the file where the filesystem supports it, so nothing is copied at all.
+    if (::ioctl(to_fd, FICLONE, from_fd) == 0)
+        return true;
+#    endif
+
+#    if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+    // Otherwise let the kernel copy the data, without it needing to pass through here.
+    auto remaining = file_size(from);
+    bool copied_any = false;
+    while (remaining > 0) {
+        const auto n = ::copy_file_range(from_fd, nullptr, to_fd, nullptr, static_cast<size_t>(std::min<uintmax_t>(remaining, 1 << 30)), 0);
+        if (n < 0) {
+            // Only some filesystems (and kernel versions) support copying between them.
+            if (!copied_any && (errno == EXDEV || errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP))
+                return false;
+            throw std::system_error(errno, std::generic_category(), "Unable to copy file");
+        }
+
+        // The file has shrunk since its size was taken.
+        if (n == 0)
+            break;
+
+        copied_any = true;
+        remaining -= static_cast<uintmax_t>(n);
+    }
+    return true;
+#    else
+    return false;
+#    endif
+#else
+    (void)from;
+    (void)to;
+    return false;
+#endif
+}
+
+void start_writeback(FILE* file)
+{
+#ifdef SYNC_FILE_RANGE_WRITE
+    // Only a hint, the file is synced properly later on.
+    (void)::sync_file_range(fileno(file), 0, 0, SYNC_FILE_RANGE_WRITE);
+#else
+    (void)file;
+#endif
+}
+
+bool prefetch(const std::string& path)
+{
+#if !defined(_WIN32) && defined(POSIX_FADV_WILLNEED)
+    const auto resolved = resolve(path);
+
+    // Opening a FIFO for reading would otherwise wait for a writer.
+    int fd = ::openat(resolved.fd(), resolved.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    // The kernel carries on reading the file after it has been closed.
+    struct stat buf;
+    const bool started = ::fstat(fd, &buf) == 0 && S_ISREG(buf.st_mode) && ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED) == 0;
+    ::close(fd);
+    return started;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+bool is_in_memory(FILE* file)
+{
+#ifdef __linux__
+    const int fd = fileno(file);
+    struct stat buf;
+    if (::fstat(fd, &buf) != 0 || !S_ISREG(buf.st_mode))
+        return false;
+    if (buf.st_size == 0)
+        return true;
+
+    const auto size = static_cast<size_t>(buf.st_size);
+    void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    const auto page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    std::vector<unsigned char> pages((size + page_size - 1) / page_size);
+    const bool resident = ::mincore(mapping, size, pages.data()) == 0
+        && std::all_of(pages.begin(), pages.end(), [](unsigned char page) { return page & 1; });
+
+    ::munmap(mapping, size);
+    return resident;
+#else
+    (void)file;
+    return false;
+#endif
+}
+
+bool write_files(const std::vector<FileContent>& files)
+{
+#ifdef PATCH_HAVE_IO_URING
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    static const auto ring = IoUring::create(256);
+    if (!ring)
+        return false;
+
+    // Each file needs an entry to open it, and up to two more to write and close it.
+    const size_t batch_size = ring->capacity() / 2;
+    for (size_t start = 0; start < files.size(); start += batch_size)
+        write_batch(*ring, files, start, std::min(files.size(), start + batch_size));
+
+    return true;
+#else
+    (void)files;
+    return false;
+#endif
+}
+
+bool sync_file(const std::string& path, bool include_metadata)
+{
+#ifdef _WIN32
+    (void)include_metadata;
+    int fd = ::_wopen(to_native(path).c_str(), _O_RDWR | _O_BINARY);
+    if (fd < 0) {
+        if (errno == ENOENT)
+            return false;
+        throw std::system_error(errno, std::generic_category(), "Unable to open " + path + " to write it to disk");
+    }
+
+    int ret = ::_commit(fd);
+#else
+    const auto resolved = resolve(path);
+    int fd = ::openat(resolved.fd(), resolved.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT)
+            return false;
+        throw std::system_error(errno, std::generic_category(), "Unable to open " + path + " to write it to disk");
+    }
+
+#    ifdef __APPLE__
+    (void)include_metadata;
+    int ret = ::fsync(fd);
+#    else
+    int ret = include_metadata ? ::fsync(fd) : ::fdatasync(fd);
+#    endif
+#endif
+
+    int saved_errno = errno;
+    ::close(fd);
+    if (ret != 0)
+        throw std::system_error(saved_errno, std::generic_category(), "Unable to write " + path + " to disk");
+
+    return true;
+}
+
+bool sync_directory(const std::string& path)
+{
+#ifdef _WIN32
+    // Directory entries can not be synced on their own, NTFS journals them anyway.
+    (void)path;
+    return true;
+#else
+    const auto resolved = resolve(path);
+    int fd = ::openat(resolved.fd(), resolved.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT)
+            return false;
+        throw std::system_error(errno, std::generic_category(), "Unable to open directory " + path + " to write it to disk");
+    }
+
+    int ret = ::fsync(fd);
+    int saved_errno = errno;
+    ::close(fd);
+
+    // Some filesystems do not support syncing directories at all.
+    if (ret != 0 && saved_errno != EINVAL)
+        throw std::system_error(saved_errno, std::generic_category(), "Unable to write directory " + path + " to disk");
+
+    return true;
+#endif
+}
+
+bool sync_filesystem(const std::string& path)
+{
+#ifdef __linux__
+    const auto resolved = resolve(path);
+    int fd = ::openat(resolved.fd(), resolved.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    int ret = ::syncfs(fd);
+    int saved_errno = errno;
+    ::close(fd);
+
+    if (ret != 0)
+        throw std::system_error(saved_errno, std::generic_category(), "Unable to write the filesystem containing " + path + " to disk");
+
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+uintmax_t device_id(const std::string& path)
+{
+#ifdef _WIN32
+    (void)path;
+    return 0;
+#else
+    const auto resolved = resolve(path);
+    struct stat buf;
+    if (::fstatat(resolved.fd(), resolved.c_str(), &buf, 0) != 0)
+        return 0;
+
+    return static_cast<uintmax_t>(buf.st_dev);
+#endif
+}
+
+static Status status_from_stat(const struct stat& buf)
+{
+    Status status;
+    status.exists = true;
+    status.is_regular_file = (buf.st_mode & S_IFMT) == S_IFREG;
+    status.permissions = static_cast<perms>(buf.st_mode) & perms::mask;
+    status.modification_time.seconds = static_cast<int64_t>(buf.st_mtime);
+#if defined(__APPLE__)
+    status.modification_time.nanoseconds = static_cast<uint32_t>(buf.st_mtimespec.tv_nsec);
+#elif !defined(_WIN32)
+    status.modification_time.nanoseconds = static_cast<uint32_t>(buf.st_mtim.tv_nsec);
+#endif
+    return status;
+}
+
+Status status(const std::string& path)
+{
+#ifdef _WIN32
+    Status status;
+    status.exists = exists(path);
+    if (status.exists) {
+        status.is_regular_file = is_regular_file(path);
+        status.permissions = get_permissions(path);
+    }
+    return status;
+#else
+    const auto resolved = resolve(path);
+    struct stat buf;
+    if (::fstatat(resolved.fd(), resolved.c_str(), &buf, 0) != 0)
+        return {};
+
+    return status_from_stat(buf);
+#endif
+}
+
+void set_modification_time(const std::string& path, const FileTime& time)
+{
+#ifdef _WIN32
+    __utimbuf64 times;
+    times.actime = time.seconds;
+    times.modtime = time.seconds;
+    if (::_wutime64(to_native(path).c_str(), &times) != 0)
+        throw std::system_error(errno, std::generic_category(), "Unable to set the time of " + path);
+#else
+    std::array<struct timespec, 2> times;
+    times[0].tv_sec = static_cast<time_t>(time.seconds);
+    times[0].tv_nsec = static_cast<long>(time.nanoseconds);
+    times[1] = times[0];
+
+    const auto resolved = resolve(path);
+    if (::utimensat(resolved.fd(), resolved.c_str(), times.data(), 0) != 0)
+        throw std::system_error(errno, std::generic_category(), "Unable to set the time of " + path);
+#endif
+}
+
+Status status(FILE* file)
+{
+    struct stat buf;
+    if (fstat(fileno(file), &buf) != 0)
+        throw std::system_error(errno, std::generic_category(), "Unable to fstat file");
+
+    return status_from_stat(buf);
+}
+
 } // namespace filesystem
 
 #ifdef _WIN32
@@ -0,0 +1,235 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#include <array>
+#include <cstring>
+#include <ctime>
+#include <patch/timestamp.h>
+
+namespace Patch {
+
+namespace {
+
+struct DateTime {
+    int year { 0 };
+    int month { 0 };
+    int day { 0 };
+    int hour { 0 };
+    int minute { 0 };
+    int second { 0 };
+    uint32_t nanoseconds { 0 };
+    bool has_utc_offset { false };
+    int utc_offset_minutes { 0 };
+};
+
+class TimestampParser {
+public:
+    explicit TimestampParser(const std::string& timestamp)
+        : m_current(timestamp.c_str())
+    {
+    }
+
+    bool parse(DateTime& date_time)
+    {
+        skip_whitespace();
+
+        // Anything starting with a digit is expected to be in the ISO 8601 like format of
+        // diff -u, otherwise this is the format of ctime(3) used by diff -c.
+        if (is_digit(*m_current)) {
+            if (!parse_number(4, date_time.year) || !consume('-') || !parse_number(2, date_time.month)
+                || !consume('-') || !parse_number(2, date_time.day))
+                return false;
+
+            if (!consume(' ') && !consume('T'))
+                return false;
+
+            if (!parse_time(date_time))
+                return false;
+        } else {
+            // The day of the week is redundant, so is only checked to be there.
+            int day_of_week;
+            if (!parse_name(day_names, day_of_week) || !consume(' '))
+                return false;
+
+            if (!parse_name(month_names, date_time.month))
+                return false;
+            ++date_time.month;
+
+            skip_whitespace();
+            if (!parse_number(2, date_time.day, true) || !consume(' ') || !parse_time(date_time) || !consume(' ')
+                || !parse_number(4, date_time.year))
+                return false;
+        }
+
+        skip_whitespace();
+        if (*m_current != '\0' && !parse_utc_offset(date_time))
+            return false;
+
+        skip_whitespace();
+        return *m_current == '\0' && is_valid(date_time);
+    }
+
+private:
+    static constexpr std::array<const char*, 7> day_names { { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" } };
+    static constexpr std::array<const char*, 12> month_names { { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" } };
+
+    static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+    static bool is_valid(const DateTime& date_time)
+    {
+        return date_time.month >= 1 && date_time.month <= 12 && date_time.day >= 1 && date_time.day <= 31
+            && date_time.hour <= 23 && date_time.minute <= 59 && date_time.second <= 60;
+    }
+
+    void skip_whitespace()
+    {
+        while (*m_current == ' ' || *m_current == '\t')
+            ++m_current;
+    }
+
+    bool consume(char c)
+    {
+        if (*m_current != c)
+            return false;
+        ++m_current;
+        return true;
+    }
+
+    // Parse a number of exactly the given number of digits, or up to it if allowed.
+    bool parse_number(int digits, int& number, bool allow_fewer_digits = false)
+    {
+        number = 0;
+        int parsed = 0;
+        while (parsed < digits && is_digit(*m_current)) {
+            number = number * 10 + (*m_current - '0');
+            ++m_current;
+            ++parsed;
+        }
+        return parsed == digits || (allow_fewer_digits && parsed > 0);
+    }
+
+    template<size_t N>
+    bool parse_name(const std::array<const char*, N>& names, int& index)
+    {
+        for (size_t i = 0; i < N; ++i) {
+            if (std::strncmp(m_current, names[i], 3) == 0) {
+                index = static_cast<int>(i);
+                m_current += 3;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool parse_time(DateTime& date_time)
+    {
+        if (!parse_number(2, date_time.hour) || !consume(':') || !parse_number(2, date_time.minute)
+            || !consume(':') || !parse_number(2, date_time.second))
+            return false;
+
+        if (!consume('.'))
+            return true;
+
+        // Only nanosecond precision is kept from any fraction of a second.
+        int digits = 0;
+        while (is_digit(*m_current)) {
+            if (digits < 9) {
+                date_time.nanoseconds = date_time.nanoseconds * 10 + static_cast<uint32_t>(*m_current - '0');
+                ++digits;
+            }
+            ++m_current;
+        }
+
+        if (digits == 0)
+            return false;
+
+        for (; digits < 9; ++digits)
+            date_time.nanoseconds *= 10;
+
+        return true;
+    }
+
+    bool parse_utc_offset(DateTime& date_time)
+    {
+        if (std::strncmp(m_current, "UTC", 3) == 0 || std::strncmp(m_current, "GMT", 3) == 0) {
+            m_current += 3;
+            date_time.has_utc_offset = true;
+            return true;
+        }
+
+        if (consume('Z')) {
+            date_time.has_utc_offset = true;
+            return true;
+        }
+
+        int sign;
+        if (consume('+'))
+            sign = 1;
+        else if (consume('-'))
+            sign = -1;
+        else
+            return false;
+
+        int hours;
+        int minutes;
+        if (!parse_number(2, hours))
+            return false;
+        consume(':');
+        if (!parse_number(2, minutes) || hours > 23 || minutes > 59)
+            return false;
+
+        date_time.has_utc_offset = true;
+        date_time.utc_offset_minutes = sign * (hours * 60 + minutes);
+        return true;
+    }
+
+    const char* m_current;
+};
+
+constexpr std::array<const char*, 7> TimestampParser::day_names;
+constexpr std::array<const char*, 12> TimestampParser::month_names;
+
+// The number of days since the epoch of the given date in the (proleptic) Gregorian calendar.
+int64_t days_from_civil(int64_t year, int64_t month, int64_t day)
+{
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const int64_t year_of_era = year - era * 400;
+    const int64_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+} // namespace
+
+bool parse_timestamp(const std::string& timestamp, bool assume_utc, filesystem::FileTime& time)
+{
+    DateTime date_time;
+    TimestampParser parser(timestamp);
+    if (!parser.parse(date_time))
+        return false;
+
+    if (date_time.has_utc_offset || assume_utc) {
+        const int64_t days = days_from_civil(date_time.year, date_time.month, date_time.day);
+        time.seconds = days * 86400 + date_time.hour * 3600 + date_time.minute * 60 + date_time.second - date_time.utc_offset_minutes * 60;
+    } else {
+        std::tm local {};
+        local.tm_year = date_time.year - 1900;
+        local.tm_mon = date_time.month - 1;
+        local.tm_mday = date_time.day;
+        local.tm_hour = date_time.hour;
+        local.tm_min = date_time.minute;
+        local.tm_sec = date_time.second;
+        local.tm_isdst = -1;
+
+        const std::time_t seconds = std::mktime(&local);
+        if (seconds == static_cast<std::time_t>(-1))
+            return false;
+        time.seconds = static_cast<int64_t>(seconds);
+    }
+
+    time.nanoseconds = date_time.nanoseconds;
+    return true;
+}
+
+} // namespace Patch
@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#include <patch/write_behind.h>
+
+namespace Patch {
+
+WriteBehind::WriteBehind(size_t number_of_threads, size_t queue_capacity)
+    : m_number_of_threads(number_of_threads == 0 ? 1 : number_of_threads)
+    , m_queue_capacity(queue_capacity == 0 ? 1 : queue_capacity)
+    , m_queues(m_number_of_threads)
+{
+}
+
+WriteBehind::~WriteBehind()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_changed.notify_all();
+
+    for (auto& thread : m_threads)
+        thread.join();
+}
+
+void WriteBehind::run(const std::string& path, std::function<void()> write)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_changed.wait(lock, [this] { return m_queued < m_queue_capacity; });
+
+    if (m_threads.empty()) {
+        m_threads.reserve(m_number_of_threads);
+        for (size_t i = 0; i < m_number_of_threads; ++i)
+            m_threads.emplace_back([this, i] { thread_main(i); });
+    }
+
+    auto& queue = m_queues[std::hash<std::string>()(path) % m_number_of_threads];
+    queue.push_back(Write { m_next_sequence++, std::move(write) });
+    ++m_queued;
+
+    lock.unlock();
+    m_changed.notify_all();
+}
+
+void WriteBehind::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_changed.wait(lock, [this] { return m_queued == 0 && m_running == 0; });
+
+    if (m_error) {
+        auto error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void WriteBehind::thread_main(size_t index)
+{
+    auto& queue = m_queues[index];
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_changed.wait(lock, [&] { return m_stopping || !queue.empty(); });
+        if (queue.empty())
+            return;
+
+        auto write = std::move(queue.front());
+        queue.pop_front();
+        --m_queued;
+        ++m_running;
+
+        // Nothing given after a write which failed is done.
+        const bool skip = m_error && m_error_sequence < write.sequence;
+
+        lock.unlock();
+        m_changed.notify_all();
+
+        std::exception_ptr error;
+        if (!skip) {
+            try {
+                write.function();
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+
+        lock.lock();
+        if (error && (!m_error || write.sequence < m_error_sequence)) {
+            m_error = error;
+            m_error_sequence = write.sequence;
+        }
+        --m_running;
+        m_changed.notify_all();
+    }
+}
+
+} // namespace Patch
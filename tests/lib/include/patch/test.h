@@ -7,6 +7,7 @@
 #include <iomanip>
 #include <iostream>
 #include <patch/file.h>
+#include <patch/string_view.h>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -30,6 +31,11 @@ void test_error_format(const T& a)
     std::cerr << static_cast<typename std::underlying_type<T>::type>(a);
 }
 
+inline void test_error_format(StringView a)
+{
+    std::cerr.write(a.data(), static_cast<std::streamsize>(a.size()));
+}
+
 inline std::string escaped_string_for_test_output(const std::string& value)
 {
     std::ostringstream out;
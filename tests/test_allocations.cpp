@@ -0,0 +1,284 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <patch/file.h>
+#include <patch/formatter.h>
+#include <patch/hunk.h>
+#include <patch/parser.h>
+#include <patch/test.h>
+#include <string>
+
+// Replace the global allocation functions so that tests are able to verify that
+// performance sensitive code paths do not perform any unexpected heap allocations.
+static std::atomic<size_t> s_allocation_count { 0 };
+static std::atomic<size_t> s_free_count { 0 };
+
+void* operator new(std::size_t size)
+{
+    ++s_allocation_count;
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr)
+        ++s_free_count;
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    ::operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    ::operator delete(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    ::operator delete(ptr);
+}
+
+class AllocationCounter {
+public:
+    AllocationCounter()
+        : m_start(s_allocation_count.load())
+        , m_start_frees(s_free_count.load())
+    {
+    }
+
+    size_t count() const { return s_allocation_count.load() - m_start; }
+    size_t frees() const { return s_free_count.load() - m_start_frees; }
+
+private:
+    size_t m_start;
+    size_t m_start_frees;
+};
+
+TEST(allocations_parse_unified_range)
+{
+    const std::string line = "@@ -1234,56 +1240,78 @@ int main()";
+    Patch::Hunk hunk;
+
+    AllocationCounter counter;
+    EXPECT_TRUE(Patch::parse_unified_range(hunk, line));
+    EXPECT_EQ(counter.count(), 0);
+
+    EXPECT_EQ(hunk.old_file_range.start_line, 1234);
+    EXPECT_EQ(hunk.old_file_range.number_of_lines, 56);
+    EXPECT_EQ(hunk.new_file_range.start_line, 1240);
+    EXPECT_EQ(hunk.new_file_range.number_of_lines, 78);
+}
+
+TEST(allocations_parse_normal_range)
+{
+    const std::string line = "10c10,15";
+    Patch::Hunk hunk;
+
+    AllocationCounter counter;
+    EXPECT_TRUE(Patch::parse_normal_range(hunk, line));
+    EXPECT_EQ(counter.count(), 0);
+
+    EXPECT_EQ(hunk.old_file_range.start_line, 10);
+    EXPECT_EQ(hunk.old_file_range.number_of_lines, 1);
+    EXPECT_EQ(hunk.new_file_range.start_line, 10);
+    EXPECT_EQ(hunk.new_file_range.number_of_lines, 6);
+}
+
+TEST(allocations_rejected_range_does_not_allocate)
+{
+    const std::string line = "+    return 0;";
+    Patch::Hunk hunk;
+
+    AllocationCounter counter;
+    EXPECT_FALSE(Patch::parse_unified_range(hunk, line));
+    EXPECT_FALSE(Patch::parse_normal_range(hunk, line));
+    EXPECT_EQ(counter.count(), 0);
+}
+
+// Each of the lines below is long enough to not fit in any small string buffer, meaning
+// that every copy of a line made while parsing or formatting would result in an allocation.
+static constexpr size_t number_of_hunks = 64;
+static constexpr size_t lines_per_hunk = 7;
+
+static std::string generate_unified_patch()
+{
+    std::string patch = "--- a/file.txt\n+++ b/file.txt\n";
+    for (size_t i = 0; i < number_of_hunks; ++i) {
+        const auto line = std::to_string(i * 10 + 1);
+        patch += "@@ -" + line + ",6 +" + line + ",6 @@\n";
+        patch += " first line of context which is fairly long\n";
+        patch += " second line of context which is fairly long\n";
+        patch += " third line of context which is fairly long\n";
+        patch += "-a line which has been removed from the file\n";
+        patch += "+a line which has been added in to the file\n";
+        patch += " fourth line of context which is fairly long\n";
+        patch += " fifth line of context which is fairly long\n";
+    }
+    return patch;
+}
+
+static std::string generate_context_patch()
+{
+    std::string patch = "*** a/file.txt\n--- b/file.txt\n";
+    for (size_t i = 0; i < number_of_hunks; ++i) {
+        const auto range = std::to_string(i * 10 + 1) + "," + std::to_string(i * 10 + 6);
+        patch += "***************\n*** " + range + " ****\n";
+        patch += "  first line of context which is fairly long\n";
+        patch += "  second line of context which is fairly long\n";
+        patch += "  third line of context which is fairly long\n";
+        patch += "- a line which has been removed from the file\n";
+        patch += "  fourth line of context which is fairly long\n";
+        patch += "  fifth line of context which is fairly long\n";
+        patch += "--- " + range + " ----\n";
+        patch += "  first line of context which is fairly long\n";
+        patch += "  second line of context which is fairly long\n";
+        patch += "  third line of context which is fairly long\n";
+        patch += "+ a line which has been added in to the file\n";
+        patch += "  fourth line of context which is fairly long\n";
+        patch += "  fifth line of context which is fairly long\n";
+    }
+    return patch;
+}
+
+// An ed script as written by 'diff -e', with the commands from the end of the file to the
+// start. The text of the last command has a line which is only a '.'.
+static std::string generate_ed_script()
+{
+    std::string script;
+    for (size_t i = number_of_hunks; i > 0; --i) {
+        const auto line = std::to_string(i * 10 + 1);
+        script += line + "," + std::to_string(i * 10 + 2) + "c\n";
+        for (size_t j = 0; j < lines_per_hunk; ++j)
+            script += "a line which has been added in to the file\n";
+        script += ".\n";
+    }
+    script += "1a\n..\n.\ns/.//\na\na line which has been added in to the file\n.\n";
+    return script;
+}
+
+TEST(allocations_parse_unified_patch_does_not_copy_lines)
+{
+    Patch::File file = Patch::File::create_temporary_with_content(generate_unified_patch());
+
+    AllocationCounter counter;
+    auto patch = Patch::parse_patch(file);
+    const auto allocations = counter.count();
+
+    EXPECT_EQ(patch.hunks.size(), number_of_hunks);
+
+    // The lines of every hunk and their content are kept in the arena of the patch, which
+    // only needs a few blocks however many lines there are.
+    EXPECT_TRUE(allocations < 32);
+}
+
+TEST(allocations_parse_context_patch_does_not_copy_lines)
+{
+    Patch::File file = Patch::File::create_temporary_with_content(generate_context_patch());
+
+    AllocationCounter counter;
+    auto patch = Patch::parse_patch(file);
+    const auto allocations = counter.count();
+
+    EXPECT_EQ(patch.hunks.size(), number_of_hunks);
+    EXPECT_EQ(patch.hunks[0].lines.size(), lines_per_hunk);
+
+    // Each part of a hunk is gathered into a list of lines before they are merged into the
+    // hunk, but those lists are kept from one hunk to the next.
+    EXPECT_TRUE(allocations < 32);
+}
+
+TEST(allocations_free_parsed_patch_all_at_once)
+{
+    for (const auto& content : { generate_unified_patch(), generate_context_patch() }) {
+        Patch::File file = Patch::File::create_temporary_with_content(content);
+        std::unique_ptr<Patch::Patch> patch(new Patch::Patch(Patch::parse_patch(file)));
+        EXPECT_EQ(patch->hunks.size(), number_of_hunks);
+
+        const auto blocks = patch->arena->number_of_blocks();
+        EXPECT_TRUE(blocks < 8);
+
+        // Only the blocks of the arena and the list of hunks are freed, not each line.
+        AllocationCounter counter;
+        patch.reset();
+        EXPECT_TRUE(counter.frees() <= blocks + 4);
+    }
+}
+
+TEST(allocations_hunk_lines_hold_no_more_room_than_needed)
+{
+    for (const auto& content : { generate_unified_patch(), generate_context_patch() }) {
+        Patch::File file = Patch::File::create_temporary_with_content(content);
+        auto patch = Patch::parse_patch(file);
+
+        // Context lines are counted in both the old and new ranges, but only appear once.
+        EXPECT_EQ(patch.hunks.size(), number_of_hunks);
+        for (const auto& hunk : patch.hunks) {
+            EXPECT_EQ(hunk.lines.size(), lines_per_hunk);
+            EXPECT_EQ(hunk.lines.capacity(), lines_per_hunk);
+        }
+    }
+}
+
+TEST(allocations_write_hunk_as_context_does_not_copy_lines)
+{
+    Patch::File file = Patch::File::create_temporary_with_content(generate_unified_patch());
+    auto patch = Patch::parse_patch(file);
+    Patch::File out = Patch::File::create_temporary();
+
+    AllocationCounter counter;
+    for (const auto& hunk : patch.hunks)
+        Patch::write_hunk_as_context(hunk, out);
+    const auto allocations = counter.count();
+
+    // Only the old and new list of lines should be allocated for each hunk.
+    EXPECT_TRUE(allocations <= number_of_hunks * 2);
+}
+
+TEST(allocations_skip_patch_body_does_not_allocate_lines)
+{
+    Patch::File file = Patch::File::create_temporary_with_content(generate_unified_patch());
+    Patch::Parser parser(file);
+    Patch::Patch patch;
+    Patch::PatchHeaderInfo info;
+    EXPECT_TRUE(parser.parse_patch_header(patch, info));
+
+    AllocationCounter counter;
+    parser.skip_patch_body(patch);
+    const auto allocations = counter.count();
+
+    EXPECT_EQ(patch.hunks.size(), number_of_hunks);
+
+    // No lines should be allocated, only the storage for the hunks themselves.
+    EXPECT_TRUE(allocations < 32);
+
+    Patch::File ed_file = Patch::File::create_temporary_with_content(generate_ed_script());
+    Patch::Parser ed_parser(ed_file);
+    Patch::Patch ed_patch;
+    EXPECT_TRUE(ed_parser.parse_patch_header(ed_patch, info));
+    EXPECT_TRUE(ed_patch.format == Patch::Format::Ed);
+
+    AllocationCounter ed_counter;
+    ed_parser.skip_patch_body(ed_patch);
+    const auto ed_allocations = ed_counter.count();
+
+    EXPECT_EQ(ed_patch.ed_commands.size(), number_of_hunks + 1);
+    for (const auto& command : ed_patch.ed_commands)
+        EXPECT_TRUE(command.lines.empty());
+
+    // As for hunks, only the storage for the commands themselves.
+    EXPECT_TRUE(ed_allocations < 32);
+}
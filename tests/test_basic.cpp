@@ -425,6 +425,31 @@ PATCH_TEST(basic_patch_dry_run_remove_file)
     EXPECT_FILE_EQ("a", "1\n");
 }
 
+PATCH_TEST(basic_patch_dry_run_remove_file_with_content_left)
+{
+    {
+        Patch::File file("diff.patch", std::ios_base::out);
+        file << R"(
+--- a
++++ /dev/null
+@@ -1 +0,0 @@
+-1
+)";
+    }
+
+    {
+        Patch::File file("a", std::ios_base::out);
+        file << "1\n2\n";
+    }
+
+    Process process(patch_path, { patch_path, "-i", "diff.patch", "--dry-run", nullptr });
+
+    EXPECT_EQ(process.stdout_data(), "checking file a\nNot deleting file a as content differs from patch\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 1);
+    EXPECT_FILE_EQ("a", "1\n2\n");
+}
+
 PATCH_TEST(set_patch_file)
 {
     {
@@ -915,44 +940,6 @@ File libarchive is not a regular file -- refusing to patch
     EXPECT_EQ(process.return_code(), 1);
 }
 
-PATCH_TEST(git_binary_patch)
-{
-    {
-        Patch::File file("diff.patch", std::ios_base::out);
-
-        file << R"(
-From f933cb15f717a43ef1961d797874ca4a5650ff08 Mon Sep 17 00:00:00 2001
-From: Shannon Booth <shannon.ml.booth@gmail.com>
-Date: Mon, 18 Jul 2022 10:16:19 +1200
-Subject: [PATCH] add utf16
-
----
- a.txt | Bin 0 -> 14 bytes
- 1 file changed, 0 insertions(+), 0 deletions(-)
- create mode 100644 a.txt
-
-diff --git a/a.txt b/a.txt
-new file mode 100644
-index 0000000000000000000000000000000000000000..c193b2437ca5bca3eaee833d9cc40b04875da742
-GIT binary patch
-literal 14
-ScmezWFOh+ZAqj|+ffxWJ!UIA8
-
-literal 0
-HcmV?d00001
-
---
-2.25.1
-)";
-        file.close();
-    }
-
-    Process process(patch_path, { patch_path, "-i", "diff.patch", nullptr });
-    EXPECT_EQ(process.stdout_data(), "File a.txt: git binary diffs are not supported.\n");
-    EXPECT_EQ(process.stderr_data(), "");
-    EXPECT_EQ(process.return_code(), 1);
-}
-
 PATCH_TEST(basic_unicode_patch_filepaths)
 {
     {
@@ -2366,3 +2353,55 @@ index 0000000..2e65efe
     EXPECT_EQ(process.stderr_data(), "patching symbolic link - (read from b)\n");
     EXPECT_EQ(process.return_code(), 0);
 }
+
+PATCH_TEST(multiple_patches_to_same_file_then_removed)
+{
+    {
+        Patch::File file("diff.patch", std::ios_base::out);
+
+        file << R"(--- a.txt
++++ a.txt
+@@ -1,3 +1,3 @@
+ 1
+-2
++two
+ 3
+--- b.txt
++++ b.txt
+@@ -1 +1 @@
+-b
++bee
+--- a.txt
++++ a.txt
+@@ -1,3 +1,3 @@
+ 1
+-two
++2 again
+ 3
+--- a.txt
++++ /dev/null
+@@ -1,3 +0,0 @@
+-1
+-2 again
+-3
+)";
+    }
+
+    {
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "1\n2\n3\n";
+    }
+
+    {
+        Patch::File file("b.txt", std::ios_base::out);
+        file << "b\n";
+    }
+
+    Process process(patch_path, { patch_path, "-i", "diff.patch", nullptr });
+    EXPECT_EQ(process.stdout_data(), "patching file a.txt\npatching file b.txt\npatching file a.txt\npatching file a.txt\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 0);
+
+    EXPECT_FALSE(Patch::filesystem::exists("a.txt"));
+    EXPECT_FILE_EQ("b.txt", "bee\n");
+}
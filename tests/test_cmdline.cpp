@@ -167,6 +167,92 @@ TEST(cmdline_with_invalid_fuzz_option_set)
         "fuzz factor thingy is not a number");
 }
 
+TEST(cmdline_with_jobs_option_set)
+{
+    const std::vector<const char*> dummy_args {
+        "./patch",
+        "--jobs",
+        "8",
+        nullptr,
+    };
+
+    auto options = parse_cmdline(dummy_args.size() - 1, dummy_args.data());
+    EXPECT_EQ(options.jobs, 8);
+}
+
+TEST(cmdline_with_invalid_jobs_option_set)
+{
+    const std::vector<const char*> dummy_args {
+        "./patch",
+        "--jobs=0",
+        nullptr,
+    };
+
+    EXPECT_THROW_WITH_MSG(parse_cmdline(dummy_args.size() - 1, dummy_args.data()), Patch::cmdline_parse_error,
+        "jobs count 0 is not a positive number");
+}
+
+TEST(cmdline_with_stats_option_set)
+{
+    const std::vector<const char*> dummy_args {
+        "./patch",
+        "--stats",
+        nullptr,
+    };
+
+    auto options = parse_cmdline(dummy_args.size() - 1, dummy_args.data());
+    EXPECT_TRUE(options.show_stats);
+}
+
+TEST(cmdline_with_durable_option_set)
+{
+    const std::vector<const char*> dummy_args {
+        "./patch",
+        "--durable",
+        nullptr,
+    };
+
+    auto options = parse_cmdline(dummy_args.size() - 1, dummy_args.data());
+    EXPECT_TRUE(options.durable);
+}
+
+TEST(cmdline_with_skip_unchanged_option_set)
+{
+    const std::vector<const char*> dummy_args {
+        "./patch",
+        "--skip-unchanged",
+        nullptr,
+    };
+
+    auto options = parse_cmdline(dummy_args.size() - 1, dummy_args.data());
+    EXPECT_TRUE(options.skip_unchanged);
+}
+
+TEST(cmdline_with_max_offset_and_filter_options_set)
+{
+    const std::vector<const char*> dummy_args {
+        "./patch",
+        "--max-offset=100",
+        "--filter",
+        "diff.patch",
+        nullptr,
+    };
+
+    auto options = parse_cmdline(dummy_args.size() - 1, dummy_args.data());
+    EXPECT_EQ(options.max_offset, 100);
+    EXPECT_TRUE(options.filter);
+    EXPECT_EQ(options.patch_file_path, "diff.patch");
+}
+
+TEST(cmdline_with_set_time_options)
+{
+    const std::vector<const char*> set_time_args { "./patch", "-T", nullptr };
+    EXPECT_EQ(parse_cmdline(set_time_args.size() - 1, set_time_args.data()).set_time, Patch::Options::SetTime::Local);
+
+    const std::vector<const char*> set_utc_args { "./patch", "--set-utc", nullptr };
+    EXPECT_EQ(parse_cmdline(set_utc_args.size() - 1, set_utc_args.data()).set_time, Patch::Options::SetTime::UTC);
+}
+
 TEST(cmdline_with_long_opt_set_with_equal_sign)
 {
     const std::vector<const char*> dummy_args {
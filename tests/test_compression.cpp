@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#include <patch/compression.h>
+#include <patch/file.h>
+#include <patch/process.h>
+#include <patch/test.h>
+
+// Each of these is the following patch, compressed in the given format:
+//
+// --- a.txt
+// +++ a.txt
+// @@ -1,3 +1,3 @@
+//  a
+// -b
+// +c
+//  d
+static const std::string gzip_patch(
+    "\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\x03\xd3\xd5\xd5\x55\x48\xd4\x2b\xa9\x28\xe1\xd2\xd6\xd6\x86\xb2\x1c\x1c\x14\x74\x0d"
+    "\x75\x8c\x15\xb4\x41\x84\x83\x03\x97\x42\x22\x97\x6e\x12\x97\x76\x32\x97\x42\x0a\x17\x00\x52\x9a\xd4\x63\x30\x00\x00\x00",
+    60);
+
+static const std::string xz_patch(
+    "\xfd\x37\x7a\x58\x5a\x00\x00\x04\xe6\xd6\xb4\x46\x04\xc0\x33\x30\x21\x01\x16\x00\x00\x00\x00\x00\x00\x00\x00\x00\xac\xb9"
+    "\x92\x04\xe0\x00\x2f\x00\x2b\x5d\x00\x16\xe8\x04\x0c\x22\xe3\xbc\x10\xcf\x66\x53\xd6\x16\xd2\x7b\x93\x1d\xc9\xcb\x00\x9d"
+    "\x90\x73\xd9\x6f\x78\x06\xd9\xe0\x50\xc6\x94\xb2\x2f\xb1\x3a\x07\x7e\xb1\x18\xca\x77\x11\x00\x00\xdd\x3f\xae\x5c\xbd\x57"
+    "\xe3\x3b\x00\x01\x4f\x30\x4d\xd6\xbe\x71\x1f\xb6\xf3\x7d\x01\x00\x00\x00\x00\x04\x59\x5a",
+    112);
+
+static const std::string zstd_patch(
+    "\x28\xb5\x2f\xfd\x24\x30\x81\x01\x00\x2d\x2d\x2d\x20\x61\x2e\x74\x78\x74\x0a\x2b\x2b\x2b\x20\x61\x2e\x74\x78\x74\x0a\x40"
+    "\x40\x20\x2d\x31\x2c\x33\x20\x2b\x31\x2c\x33\x20\x40\x40\x0a\x20\x61\x0a\x2d\x62\x0a\x2b\x63\x0a\x20\x64\x0a\xe2\xfe\xa8"
+    "\x63",
+    61);
+
+static void write_file_to_patch()
+{
+    Patch::File file("a.txt", std::ios_base::out);
+    file << "a\nb\nd\n";
+}
+
+static void check_compressed_patch_applies(const char* patch_path, Patch::Compression compression, const std::string& compressed_patch, bool from_stdin)
+{
+    write_file_to_patch();
+
+    std::string stdin_data;
+    if (from_stdin) {
+        stdin_data = compressed_patch;
+    } else {
+        Patch::File file("diff.patch", std::ios_base::out | std::ios_base::binary);
+        file << compressed_patch;
+    }
+
+    Process process(patch_path, { patch_path, "-i", from_stdin ? "-" : "diff.patch", nullptr }, stdin_data);
+
+    if (!Patch::supports_decompression(compression)) {
+        EXPECT_EQ(process.stdout_data(), "");
+        EXPECT_EQ(process.stderr_data(), std::string(patch_path) + ": **** Unable to read " + Patch::to_string(compression) + " compressed patch, support for it is not enabled in this build\n");
+        EXPECT_EQ(process.return_code(), 2);
+        EXPECT_FILE_EQ("a.txt", "a\nb\nd\n");
+        return;
+    }
+
+    EXPECT_EQ(process.stdout_data(), "patching file a.txt\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 0);
+    EXPECT_FILE_EQ("a.txt", "a\nc\nd\n");
+}
+
+TEST(compression_detect_from_magic)
+{
+    EXPECT_TRUE(Patch::detect_compression(gzip_patch) == Patch::Compression::Gzip);
+    EXPECT_TRUE(Patch::detect_compression(xz_patch) == Patch::Compression::Xz);
+    EXPECT_TRUE(Patch::detect_compression(zstd_patch) == Patch::Compression::Zstd);
+    EXPECT_TRUE(Patch::detect_compression("--- a.txt\n") == Patch::Compression::None);
+    EXPECT_TRUE(Patch::detect_compression("") == Patch::Compression::None);
+    EXPECT_TRUE(Patch::detect_compression({ "\x1f", 1 }) == Patch::Compression::None);
+}
+
+PATCH_TEST(compression_gzip_patch_file)
+{
+    check_compressed_patch_applies(patch_path, Patch::Compression::Gzip, gzip_patch, false);
+}
+
+PATCH_TEST(compression_gzip_patch_stdin)
+{
+    check_compressed_patch_applies(patch_path, Patch::Compression::Gzip, gzip_patch, true);
+}
+
+PATCH_TEST(compression_xz_patch_file)
+{
+    check_compressed_patch_applies(patch_path, Patch::Compression::Xz, xz_patch, false);
+}
+
+PATCH_TEST(compression_xz_patch_stdin)
+{
+    check_compressed_patch_applies(patch_path, Patch::Compression::Xz, xz_patch, true);
+}
+
+PATCH_TEST(compression_zstd_patch_file)
+{
+    check_compressed_patch_applies(patch_path, Patch::Compression::Zstd, zstd_patch, false);
+}
+
+PATCH_TEST(compression_zstd_patch_stdin)
+{
+    check_compressed_patch_applies(patch_path, Patch::Compression::Zstd, zstd_patch, true);
+}
+
+PATCH_TEST(compression_truncated_gzip_patch)
+{
+    write_file_to_patch();
+
+    if (!Patch::supports_decompression(Patch::Compression::Gzip))
+        return;
+
+    {
+        Patch::File file("diff.patch", std::ios_base::out | std::ios_base::binary);
+        file << gzip_patch.substr(0, 30);
+    }
+
+    Process process(patch_path, { patch_path, "-i", "diff.patch", nullptr });
+    EXPECT_EQ(process.stdout_data(), "");
+    EXPECT_EQ(process.stderr_data(), std::string(patch_path) + ": **** Unexpected end of gzip compressed patch\n");
+    EXPECT_EQ(process.return_code(), 2);
+    EXPECT_FILE_EQ("a.txt", "a\nb\nd\n");
+}
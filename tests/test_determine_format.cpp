@@ -177,7 +177,8 @@ HcmV?d00001
     EXPECT_EQ(patch.format, Patch::Format::Git);
     EXPECT_EQ(patch.old_file_path, "a.txt");
     EXPECT_EQ(patch.new_file_path, "a.txt");
-    EXPECT_EQ(patch.operation, Patch::Operation::Binary);
+    EXPECT_EQ(patch.operation, Patch::Operation::Add);
+    EXPECT_TRUE(patch.is_git_binary);
 
     std::stringstream output;
     parser.print_header_info(info, output);
@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#include <patch/file.h>
+#include <patch/parser.h>
+#include <patch/process.h>
+#include <patch/test.h>
+#include <stdexcept>
+
+// Output of 'diff -e' changing "a b c d e" to "a . c x y e f", one line each.
+static const char* ed_script = R"(5a
+f
+.
+4c
+x
+y
+.
+2c
+..
+.
+s/.//
+)";
+
+TEST(ed_parse_command)
+{
+    Patch::EdCommand command;
+    EXPECT_TRUE(Patch::parse_ed_command(command, "12,15c"));
+    EXPECT_EQ(command.command, 'c');
+    EXPECT_EQ(command.start_line, 12);
+    EXPECT_EQ(command.end_line, 15);
+
+    EXPECT_TRUE(Patch::parse_ed_command(command, "0a"));
+    EXPECT_EQ(command.command, 'a');
+    EXPECT_EQ(command.start_line, 0);
+    EXPECT_EQ(command.end_line, 0);
+
+    EXPECT_FALSE(Patch::parse_ed_command(command, "3"));
+    EXPECT_FALSE(Patch::parse_ed_command(command, "3x"));
+    EXPECT_FALSE(Patch::parse_ed_command(command, "3dd"));
+    EXPECT_FALSE(Patch::parse_ed_command(command, "1,2a"));
+    EXPECT_FALSE(Patch::parse_ed_command(command, "0d"));
+    EXPECT_FALSE(Patch::parse_ed_command(command, "5,2d"));
+    EXPECT_FALSE(Patch::parse_ed_command(command, "1a3"));
+}
+
+TEST(ed_parse_script)
+{
+    auto file = Patch::File::create_temporary_with_content(ed_script);
+    auto patch = Patch::parse_patch(file);
+
+    EXPECT_TRUE(patch.format == Patch::Format::Ed);
+    EXPECT_EQ(patch.ed_commands.size(), 3);
+
+    const auto& append = patch.ed_commands[0];
+    EXPECT_EQ(append.command, 'a');
+    EXPECT_EQ(append.start_line, 5);
+    EXPECT_EQ(append.lines.size(), 1);
+    EXPECT_EQ(append.lines[0].content, "f");
+
+    const auto& change = patch.ed_commands[1];
+    EXPECT_EQ(change.command, 'c');
+    EXPECT_EQ(change.start_line, 4);
+    EXPECT_EQ(change.end_line, 4);
+    EXPECT_EQ(change.lines.size(), 2);
+
+    // The substitution removes the extra '.' written by diff.
+    const auto& dot = patch.ed_commands[2];
+    EXPECT_EQ(dot.lines.size(), 1);
+    EXPECT_EQ(dot.lines[0].content, ".");
+}
+
+TEST(ed_parse_script_missing_terminator)
+{
+    auto file = Patch::File::create_temporary_with_content("2a\nb\n");
+    EXPECT_THROW(Patch::parse_patch(file, Patch::Format::Ed), std::runtime_error);
+}
+
+PATCH_TEST(ed_script_detected)
+{
+    {
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "a\nb\nc\nd\ne\n";
+
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << ed_script;
+    }
+
+    Process process(patch_path, { patch_path, "-i", "diff.patch", "a.txt", nullptr });
+
+    EXPECT_EQ(process.stdout_data(), "patching file a.txt\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 0);
+    EXPECT_FILE_EQ("a.txt", "a\n.\nc\nx\ny\ne\nf\n");
+}
+
+PATCH_TEST(ed_script_forced_with_continued_append)
+{
+    {
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "1\n2\n3\n";
+
+        // A '.' line followed by more text, as written by diff.
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << "2a\n..\n.\ns/.//\na\nmore\n.\n";
+    }
+
+    Process process(patch_path, { patch_path, "--ed", "-i", "diff.patch", "a.txt", nullptr });
+
+    EXPECT_EQ(process.stdout_data(), "patching file a.txt\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 0);
+    EXPECT_FILE_EQ("a.txt", "1\n2\n.\nmore\n3\n");
+}
+
+PATCH_TEST(ed_script_commands_in_file_order)
+{
+    {
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "1\n2\n3\n4";
+
+        // Each command sees the line numbers as changed by the command before it.
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << "1d\n1c\ntwo\n.\n3a\nfive\n.\n0a\nzero\n.\n";
+    }
+
+    Process process(patch_path, { patch_path, "--ed", "-i", "diff.patch", "a.txt", nullptr });
+
+    EXPECT_EQ(process.stdout_data(), "patching file a.txt\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 0);
+    EXPECT_FILE_EQ("a.txt", "zero\ntwo\n3\n4\nfive\n");
+}
+
+PATCH_TEST(ed_script_past_end_of_file)
+{
+    {
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "1\n2\n";
+
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << "3,4d\n";
+    }
+
+    Process process(patch_path, { patch_path, "--ed", "-i", "diff.patch", "a.txt", nullptr });
+
+    EXPECT_EQ(process.stdout_data(), "patching file a.txt\n");
+    EXPECT_EQ(process.stderr_data(), std::string(patch_path) + ": **** ed script refers to a line past the end of the file\n");
+    EXPECT_EQ(process.return_code(), 2);
+    EXPECT_FILE_EQ("a.txt", "1\n2\n");
+}
+
+PATCH_TEST(ed_script_reversed)
+{
+    {
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "1\n2\n";
+
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << "2d\n";
+    }
+
+    Process process(patch_path, { patch_path, "-R", "--ed", "-i", "diff.patch", "a.txt", nullptr });
+
+    EXPECT_EQ(process.stdout_data(), "");
+    EXPECT_EQ(process.stderr_data(), std::string(patch_path) + ": **** ed scripts can not be reversed\n");
+    EXPECT_EQ(process.return_code(), 2);
+    EXPECT_FILE_EQ("a.txt", "1\n2\n");
+}
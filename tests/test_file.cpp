@@ -3,6 +3,8 @@
 
 #include <ios>
 #include <patch/file.h>
+#include <patch/options.h>
+#include <patch/patch.h>
 #include <patch/system.h>
 #include <patch/test.h>
 #include <system_error>
@@ -202,3 +204,104 @@ PATCH_TEST(file_open_failure)
 {
     EXPECT_THROW(Patch::File("file-that-does-not-exist"), std::system_error);
 }
+
+PATCH_TEST(file_relative_to_base_directory)
+{
+    (void)patch_path;
+
+    Patch::filesystem::create_directory("base");
+    const auto working_directory = Patch::current_path();
+
+    Patch::set_base_directory("base");
+    {
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "a\n";
+    }
+    Patch::ensure_parent_directories("x/y/b.txt");
+    {
+        Patch::File file("x/y/b.txt", std::ios_base::out);
+        file << "b\n";
+    }
+    Patch::filesystem::rename("x/y/b.txt", "x/c.txt");
+    EXPECT_TRUE(Patch::filesystem::is_regular_file("x/c.txt"));
+    EXPECT_EQ(Patch::current_path(), working_directory);
+    Patch::set_base_directory("");
+
+    EXPECT_FILE_EQ("base/a.txt", "a\n");
+    EXPECT_FILE_EQ("base/x/c.txt", "b\n");
+    EXPECT_FALSE(Patch::filesystem::exists("a.txt"));
+    EXPECT_THROW(Patch::set_base_directory("does-not-exist"), std::system_error);
+}
+
+PATCH_TEST(file_in_directory_renamed_and_created_again)
+{
+    (void)patch_path;
+
+    Patch::ensure_parent_directories("a/b/c.txt");
+    {
+        Patch::File file("a/b/c.txt", std::ios_base::out);
+        file << "first\n";
+    }
+
+    // The directory is named differently to how the file inside of it was.
+    Patch::filesystem::rename("./a/", "z");
+
+    Patch::ensure_parent_directories("a/b/c.txt");
+    {
+        Patch::File file("a/b/c.txt", std::ios_base::out);
+        file << "second\n";
+    }
+    EXPECT_FILE_EQ("a/b/c.txt", "second\n");
+    EXPECT_FILE_EQ("z/b/c.txt", "first\n");
+}
+
+PATCH_TEST(file_patched_after_changing_working_directory)
+{
+    (void)patch_path;
+
+    for (const char* directory : { "one", "two" }) {
+        Patch::ensure_parent_directories(std::string(directory) + "/sub/a.txt");
+        Patch::File file(std::string(directory) + "/sub/a.txt", std::ios_base::out);
+        file << "1\n";
+    }
+    {
+        Patch::File file("diff.patch", std::ios_base::out);
+        file << "--- sub/a.txt\n+++ sub/a.txt\n@@ -1 +1 @@\n-1\n+2\n";
+    }
+
+    Patch::Options options;
+    options.patch_file_path = "../diff.patch";
+    options.strip_size = 0;
+    options.batch = true;
+
+    // Nothing looked up by the first run should be used by the second.
+    Patch::chdir("one");
+    EXPECT_EQ(Patch::process_patch(options), 0);
+    Patch::chdir("../two");
+    EXPECT_EQ(Patch::process_patch(options), 0);
+    Patch::chdir("..");
+
+    EXPECT_FILE_EQ("one/sub/a.txt", "2\n");
+    EXPECT_FILE_EQ("two/sub/a.txt", "2\n");
+}
+
+PATCH_TEST(file_in_directory_removed_and_created_again)
+{
+    (void)patch_path;
+
+    Patch::ensure_parent_directories("a/b/c.txt");
+    {
+        Patch::File file("a/b/c.txt", std::ios_base::out);
+        file << "first\n";
+    }
+
+    Patch::remove_file_and_empty_parent_folders("a/b/c.txt");
+    EXPECT_FALSE(Patch::filesystem::exists("a"));
+
+    Patch::ensure_parent_directories("a/b/c.txt");
+    {
+        Patch::File file("a/b/c.txt", std::ios_base::out);
+        file << "second\n";
+    }
+    EXPECT_FILE_EQ("a/b/c.txt", "second\n");
+}
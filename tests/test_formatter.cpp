@@ -211,7 +211,7 @@ TEST(formatter_no_new_line_at_end_of_file_both_sides)
         { ' ', "int main()" },
         { ' ', "{" },
         { '+', "    return 0;" },
-        { ' ', { "}", Patch::NewLine::None } },
+        { ' ', Patch::LineView { "}", Patch::NewLine::None } },
     };
 
     hunk.old_file_range.start_line = 1;
@@ -250,7 +250,7 @@ TEST(formatter_no_new_line_at_end_of_file_for_to_file)
         { ' ', "{" },
         { '-', "}" },
         { '+', "    return 0;" },
-        { '+', { "}", Patch::NewLine::None } },
+        { '+', Patch::LineView { "}", Patch::NewLine::None } },
     };
 
     hunk.old_file_range.start_line = 1;
@@ -292,7 +292,7 @@ TEST(formatter_no_new_line_at_end_of_file_for_old_file)
         { ' ', "int main()" },
         { ' ', "{" },
         { '-', "    return 0;" },
-        { '-', { "}", Patch::NewLine::None } },
+        { '-', Patch::LineView { "}", Patch::NewLine::None } },
         { '+', "}" },
     };
 
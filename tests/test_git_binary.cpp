@@ -0,0 +1,242 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#include <patch/binary.h>
+#include <patch/file.h>
+#include <patch/process.h>
+#include <patch/system.h>
+#include <patch/test.h>
+
+static std::string original_binary_content()
+{
+    std::string content;
+    for (int i = 0; i < 3000; ++i)
+        content.push_back(static_cast<char>((i * 7) % 256));
+    return content;
+}
+
+static std::string patched_binary_content()
+{
+    std::string content = original_binary_content();
+    content[100] = '\0';
+    content.insert(2000, std::string("\0inserted\0", 10));
+    return content;
+}
+
+static void write_binary_file(const std::string& path, const std::string& content)
+{
+    Patch::File file(path, std::ios_base::out | std::ios_base::binary);
+    file << content;
+}
+
+static const char* binary_delta_patch = R"(diff --git a/bin.dat b/bin.dat
+index bc5c09e9fa79ad4daa554d4ec2aa22eaf1a56805..b9f073240fad9422fe09bddabe4edd4aa3851ee2 100644
+GIT binary patch
+delta 27
+jcmdlXen@;m3M0eD)NFPxhRnR;)S{Bq6o!o#UN8dygc1q*
+
+delta 12
+UcmX>kzC(Ny;{~>j7hbRc03*Exp8x;=
+
+)";
+
+TEST(git_binary_decode_base85_line)
+{
+    std::string output;
+    EXPECT_TRUE(Patch::decode_base85_line("HcmV?d00001", output));
+    EXPECT_EQ(output, std::string("\x78\x01\x03\x00\x00\x00\x00\x01", 8));
+
+    // Line is too short for the number of bytes given.
+    EXPECT_FALSE(Patch::decode_base85_line("IcmV?d00001", output));
+
+    // Invalid length character and base85 character.
+    EXPECT_FALSE(Patch::decode_base85_line("1cmV?d", output));
+    EXPECT_FALSE(Patch::decode_base85_line("Dcm\"?d", output));
+}
+
+TEST(git_binary_object_id)
+{
+    EXPECT_EQ(Patch::git_object_id(""), "e69de29bb2d1d6434b8b29ae775ad8c2e48c5391");
+    EXPECT_EQ(Patch::git_object_id(original_binary_content()), "bc5c09e9fa79ad4daa554d4ec2aa22eaf1a56805");
+    EXPECT_EQ(Patch::git_object_id(patched_binary_content()), "b9f073240fad9422fe09bddabe4edd4aa3851ee2");
+}
+
+PATCH_TEST(git_binary_patch)
+{
+    if (!Patch::supports_git_binary_patches())
+        return;
+
+    {
+        Patch::File file("diff.patch", std::ios_base::out);
+
+        file << R"(
+From f933cb15f717a43ef1961d797874ca4a5650ff08 Mon Sep 17 00:00:00 2001
+From: Shannon Booth <shannon.ml.booth@gmail.com>
+Date: Mon, 18 Jul 2022 10:16:19 +1200
+Subject: [PATCH] add utf16
+
+---
+ a.txt | Bin 0 -> 14 bytes
+ 1 file changed, 0 insertions(+), 0 deletions(-)
+ create mode 100644 a.txt
+
+diff --git a/a.txt b/a.txt
+new file mode 100644
+index 0000000000000000000000000000000000000000..c193b2437ca5bca3eaee833d9cc40b04875da742
+GIT binary patch
+literal 14
+ScmezWFOh+ZAqj|+ffxWJ!UIA8
+
+literal 0
+HcmV?d00001
+
+--
+2.25.1
+)";
+        file.close();
+    }
+
+    Process process(patch_path, { patch_path, "-i", "diff.patch", nullptr });
+    EXPECT_EQ(process.stdout_data(), "patching file a.txt\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 0);
+    EXPECT_FILE_BINARY_EQ("a.txt", std::string("\xff\xfe\x61\x00\x0a\x00\x62\x00\x0a\x00\x63\x00\x0a\x00", 14));
+}
+
+PATCH_TEST(git_binary_patch_delta)
+{
+    if (!Patch::supports_git_binary_patches())
+        return;
+
+    {
+        Patch::File file("diff.patch", std::ios_base::out);
+        file << binary_delta_patch;
+    }
+    write_binary_file("bin.dat", original_binary_content());
+
+    Process process(patch_path, { patch_path, "-i", "diff.patch", nullptr });
+    EXPECT_EQ(process.stdout_data(), "patching file bin.dat\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 0);
+    EXPECT_FILE_BINARY_EQ("bin.dat", patched_binary_content());
+}
+
+PATCH_TEST(git_binary_patch_delta_reversed)
+{
+    if (!Patch::supports_git_binary_patches())
+        return;
+
+    {
+        Patch::File file("diff.patch", std::ios_base::out);
+        file << binary_delta_patch;
+    }
+    write_binary_file("bin.dat", patched_binary_content());
+
+    Process process(patch_path, { patch_path, "-R", "-i", "diff.patch", nullptr });
+    EXPECT_EQ(process.stdout_data(), "patching file bin.dat\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 0);
+    EXPECT_FILE_BINARY_EQ("bin.dat", original_binary_content());
+}
+
+PATCH_TEST(git_binary_patch_does_not_apply)
+{
+    if (!Patch::supports_git_binary_patches())
+        return;
+
+    {
+        Patch::File file("diff.patch", std::ios_base::out);
+        file << binary_delta_patch;
+    }
+    write_binary_file("bin.dat", patched_binary_content());
+
+    Process process(patch_path, { patch_path, "-i", "diff.patch", nullptr });
+    EXPECT_EQ(process.stdout_data(), "patching file bin.dat\nFile bin.dat: git binary patch does not apply.\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 1);
+    EXPECT_FILE_BINARY_EQ("bin.dat", patched_binary_content());
+}
+
+PATCH_TEST(git_binary_patch_not_reversible)
+{
+    if (!Patch::supports_git_binary_patches())
+        return;
+
+    {
+        Patch::File file("diff.patch", std::ios_base::out);
+        file << R"(diff --git a/a.txt b/a.txt
+index 0000000000000000000000000000000000000000..c193b2437ca5bca3eaee833d9cc40b04875da742
+GIT binary patch
+literal 14
+ScmezWFOh+ZAqj|+ffxWJ!UIA8
+
+)";
+    }
+    write_binary_file("a.txt", std::string("\xff\xfe\x61\x00\x0a\x00\x62\x00\x0a\x00\x63\x00\x0a\x00", 14));
+
+    Process process(patch_path, { patch_path, "-R", "-i", "diff.patch", nullptr });
+    EXPECT_EQ(process.stdout_data(), "patching file a.txt\nFile a.txt: git binary patch can not be reversed.\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 1);
+}
+
+PATCH_TEST(git_binary_patch_delete_and_text_patch)
+{
+    if (!Patch::supports_git_binary_patches())
+        return;
+
+    {
+        Patch::File file("diff.patch", std::ios_base::out);
+        file << R"(diff --git a/bin.dat b/bin.dat
+deleted file mode 100644
+index bc5c09e9fa79ad4daa554d4ec2aa22eaf1a56805..0000000000000000000000000000000000000000
+GIT binary patch
+literal 0
+HcmV?d00001
+
+literal 3000
+zcmZQz=M$At)-trPck>O2PRcAOuWRj@JZs^K_1pFyIeqEogXizQ{$b`4l#o}`HL-T`
+z3<!@)%_**G?C761cggBaI}aQ`clFNWS08`;XX6!-R?;*uw{!Igj!MkPFRN|oo-}j8
+z@^xGH96ojN#{Fk+zx-z66cCqF)iJhm^zaXhP022*Y-sPBI%n~!jXU-qJA38!qn97P
+z|6}D5mQvKvH?wu|4vI`j&nvBI?wUAb{<5`Ob{{%<;rhL&Z$AHG<lq;RRna!Gba3|z
+zjY-Zbtf+76oicmT$_?B19X)gT*25R?zx`$57Lrs@*E6+o_6m%MPs=T-Zt9#cecsYF
+wn|B>NasJxfC$B&KWEl1TX#9_+|Iz$ETK<ie|D*NaX#GFh{uyom4T1JA0LnPlC;$Ke
+
+diff --git a/a.txt b/a.txt
+index 7898192..6178079 100644
+--- a/a.txt
++++ b/a.txt
+@@ -1 +1 @@
+-a
++b
+)";
+    }
+    write_binary_file("bin.dat", original_binary_content());
+    {
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "a\n";
+    }
+
+    Process process(patch_path, { patch_path, "-i", "diff.patch", nullptr });
+    EXPECT_EQ(process.stdout_data(), "patching file bin.dat\npatching file a.txt\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 0);
+    EXPECT_FALSE(Patch::filesystem::exists("bin.dat"));
+    EXPECT_FILE_EQ("a.txt", "b\n");
+}
+
+PATCH_TEST(git_binary_patch_without_zlib)
+{
+    if (Patch::supports_git_binary_patches())
+        return;
+
+    {
+        Patch::File file("diff.patch", std::ios_base::out);
+        file << binary_delta_patch;
+    }
+
+    Process process(patch_path, { patch_path, "-i", "diff.patch", nullptr });
+    EXPECT_EQ(process.stdout_data(), "File bin.dat: git binary diffs are not supported.\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 1);
+}
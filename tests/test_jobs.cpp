@@ -0,0 +1,268 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#include <patch/file.h>
+#include <patch/process.h>
+#include <patch/system.h>
+#include <patch/test.h>
+#include <string>
+
+PATCH_TEST(jobs_output_in_patch_order)
+{
+    std::string patch;
+    std::string expected_output;
+
+    for (int i = 0; i < 20; ++i) {
+        const auto name = "file" + std::to_string(i) + ".txt";
+        {
+            Patch::File file(name, std::ios_base::out);
+            // Every 5th file is missing the line which is changed, so fails to apply.
+            if (i % 5 == 4)
+                file << "1\n2\nwrong\n4\n5\n";
+            else
+                file << "1\n2\n3\n4\n5\n";
+        }
+
+        patch += "--- a/" + name + "\n+++ b/" + name + "\n@@ -2,3 +2,3 @@\n 2\n-3\n+three\n 4\n";
+
+        expected_output += "patching file " + name + "\n";
+        if (i % 5 == 4)
+            expected_output += "Hunk #1 FAILED at 2.\n1 out of 1 hunk FAILED -- saving rejects to file " + name + ".rej\n";
+    }
+
+    {
+        Patch::File file("diff.patch", std::ios_base::out);
+        file << patch;
+    }
+
+    Process process(patch_path, { patch_path, "-p1", "--jobs", "4", "-i", "diff.patch", nullptr });
+
+    EXPECT_EQ(process.stdout_data(), expected_output);
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 1);
+
+    EXPECT_FILE_EQ("file0.txt", "1\n2\nthree\n4\n5\n");
+    EXPECT_FILE_EQ("file4.txt", "1\n2\nwrong\n4\n5\n");
+    EXPECT_FILE_EQ("file19.txt", "1\n2\nwrong\n4\n5\n");
+}
+
+PATCH_TEST(jobs_same_file_patched_in_order)
+{
+    {
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "1\n2\n3\n";
+
+        // The second patch to a.txt only applies to the result of the first, and
+        // the backup should be of the file before either of them were applied.
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << R"(--- /dev/null
++++ b/b.txt
+@@ -0,0 +1 @@
++new
+--- a/a.txt
++++ b/a.txt
+@@ -1,3 +1,3 @@
+ 1
+-2
++two
+ 3
+--- a/b.txt
++++ b/b.txt
+@@ -1 +1,2 @@
+ new
++more
+--- a/a.txt
++++ b/a.txt
+@@ -1,3 +1,3 @@
+ 1
+-two
++2 again
+ 3
+)";
+    }
+
+    Process process(patch_path, { patch_path, "-p1", "-b", "--jobs", "3", "-i", "diff.patch", nullptr });
+
+    EXPECT_EQ(process.stdout_data(), "patching file b.txt\npatching file a.txt\npatching file b.txt\npatching file a.txt\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 0);
+
+    EXPECT_FILE_EQ("a.txt", "1\n2 again\n3\n");
+    EXPECT_FILE_EQ("a.txt.orig", "1\n2\n3\n");
+    EXPECT_FILE_EQ("b.txt", "new\nmore\n");
+}
+
+PATCH_TEST(jobs_parse_error_after_earlier_patches)
+{
+    {
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "1\n2\n3\n";
+
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << R"(--- a.txt
++++ a.txt
+@@ -1,3 +1,3 @@
+ 1
+-2
++two
+ 3
+--- a.txt
++++ a.txt
+@@ -1,3 +1,3 @@
+ 1
+?
+)";
+    }
+
+    Process process(patch_path, { patch_path, "--jobs", "2", "-i", "diff.patch", nullptr });
+
+    EXPECT_EQ(process.stdout_data(), "patching file a.txt\npatching file a.txt\n");
+    EXPECT_EQ(process.stderr_data(), std::string(patch_path) + ": **** malformed patch at line 12: ?\n\n");
+    EXPECT_EQ(process.return_code(), 2);
+    EXPECT_FILE_EQ("a.txt", "1\ntwo\n3\n");
+}
+
+PATCH_TEST(stats_reported_for_each_stage)
+{
+    {
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "1\n2\n3\n";
+
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << "--- a.txt\n+++ a.txt\n@@ -1,3 +1,3 @@\n 1\n-2\n+two\n 3\n";
+    }
+
+    Process process(patch_path, { patch_path, "--stats", "-i", "diff.patch", nullptr });
+
+    EXPECT_EQ(process.stdout_data(), "patching file a.txt\n");
+    EXPECT_EQ(process.return_code(), 0);
+    EXPECT_FILE_EQ("a.txt", "1\ntwo\n3\n");
+
+    const auto& stats = process.stderr_data();
+    EXPECT_TRUE(stats.find("patch statistics:\n  wall time: ") == 0);
+    EXPECT_TRUE(stats.find("  load: 1 files, ") != std::string::npos);
+    EXPECT_TRUE(stats.find("  apply: 1 files, ") != std::string::npos);
+    EXPECT_TRUE(stats.find("  write: 1 files, ") != std::string::npos);
+    EXPECT_TRUE(stats.find("  write-behind: 1 files, ") != std::string::npos);
+#ifdef __linux__
+    // The file has only just been written, so is certainly still in memory.
+    EXPECT_TRUE(stats.find("  prefetch: 1 files, 1 of 1 loaded were already in memory (100% hit rate)\n") != std::string::npos);
+#endif
+}
+
+PATCH_TEST(write_behind_writes_every_git_file)
+{
+    std::string patch_content;
+    for (int i = 0; i < 10; ++i) {
+        const auto name = std::to_string(i) + ".txt";
+        Patch::File file(name, std::ios_base::out);
+        file << "1\n2\n3\n";
+
+        patch_content += "diff --git a/" + name + " b/" + name + "\n--- a/" + name + "\n+++ b/" + name + "\n"
+            + "@@ -1,3 +1,3 @@\n 1\n-2\n+" + std::to_string(i) + "\n 3\n";
+    }
+
+    {
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << patch_content;
+    }
+
+    Process process(patch_path, { patch_path, "--stats", "-p1", "-i", "diff.patch", nullptr });
+
+    EXPECT_EQ(process.return_code(), 0);
+    EXPECT_TRUE(process.stderr_data().find("  write-behind: 10 files, ") != std::string::npos);
+    for (int i = 0; i < 10; ++i)
+        EXPECT_FILE_EQ(std::to_string(i) + ".txt", "1\n" + std::to_string(i) + "\n3\n");
+}
+
+PATCH_TEST(many_small_files_written_once_patched)
+{
+    std::string patch_content;
+    for (int i = 0; i < 40; ++i) {
+        const auto name = "dir" + std::to_string(i % 4) + "/" + std::to_string(i) + ".txt";
+        Patch::ensure_parent_directories(name);
+        Patch::File file(name, std::ios_base::out);
+        file << "1\n2\n3\n";
+
+        patch_content += "--- " + name + "\n+++ " + name + "\n@@ -1,3 +1,3 @@\n 1\n-2\n+" + std::to_string(i) + "\n 3\n";
+    }
+
+    {
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << patch_content;
+    }
+
+    Process process(patch_path, { patch_path, "--stats", "-p0", "-i", "diff.patch", nullptr });
+
+    EXPECT_EQ(process.return_code(), 0);
+    EXPECT_TRUE(process.stderr_data().find("  write-behind: 40 files, ") != std::string::npos);
+    for (int i = 0; i < 40; ++i)
+        EXPECT_FILE_EQ("dir" + std::to_string(i % 4) + "/" + std::to_string(i) + ".txt", "1\n" + std::to_string(i) + "\n3\n");
+}
+
+PATCH_TEST(durable_reports_what_was_written_to_disk)
+{
+    {
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "1\n2\n3\n";
+
+        Patch::File to_remove("c.txt", std::ios_base::out);
+        to_remove << "gone\n";
+
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << R"(--- a.txt
++++ a.txt
+@@ -1,3 +1,3 @@
+ 1
+-2
++two
+ 3
+--- /dev/null
++++ new/dir/b.txt
+@@ -0,0 +1 @@
++new
+--- c.txt
++++ /dev/null
+@@ -1 +0,0 @@
+-gone
+)";
+    }
+
+    Process process(patch_path, { patch_path, "-p0", "--durable", "--stats", "-i", "diff.patch", nullptr });
+
+    EXPECT_EQ(process.stdout_data(), "patching file a.txt\npatching file new/dir/b.txt\npatching file c.txt\n");
+    EXPECT_EQ(process.return_code(), 0);
+    EXPECT_FILE_EQ("a.txt", "1\ntwo\n3\n");
+    EXPECT_FILE_EQ("new/dir/b.txt", "new\n");
+    EXPECT_FALSE(Patch::filesystem::exists("c.txt"));
+
+    EXPECT_TRUE(process.stderr_data().find("  durable: 2 files, 3 directories, ") != std::string::npos);
+}
+
+PATCH_TEST(jobs_parse_error_reported_the_same)
+{
+    std::string patch;
+    for (int i = 0; i < 10; ++i) {
+        const auto name = "file" + std::to_string(i) + ".txt";
+        Patch::File file(name, std::ios_base::out);
+        file << "1\n2\n3\n";
+        patch += "diff --git a/" + name + " b/" + name + "\n--- a/" + name + "\n+++ b/" + name + "\n@@ -1,3 +1,3 @@\n 1\n-2\n+two\n 3\n";
+    }
+
+    // The hunk claims more lines than it has, running into the patch after it.
+    patch += "diff --git a/file10.txt b/file10.txt\n--- a/file10.txt\n+++ b/file10.txt\n@@ -1,4 +1,4 @@\n 1\n-2\n+two\n 3\n";
+    patch += "diff --git a/file0.txt b/file0.txt\n--- a/file0.txt\n+++ b/file0.txt\n@@ -1,3 +1,3 @@\n 1\n-two\n+2\n 3\n";
+
+    {
+        Patch::File file("diff.patch", std::ios_base::out);
+        file << patch;
+    }
+
+    Process in_order(patch_path, { patch_path, "-p1", "--dry-run", "-i", "diff.patch", nullptr });
+    Process ahead(patch_path, { patch_path, "-p1", "--dry-run", "--jobs", "4", "-i", "diff.patch", nullptr });
+
+    EXPECT_EQ(ahead.stdout_data(), in_order.stdout_data());
+    EXPECT_EQ(ahead.stderr_data(), in_order.stderr_data());
+    EXPECT_EQ(ahead.return_code(), in_order.return_code());
+    EXPECT_EQ(in_order.return_code(), 2);
+}
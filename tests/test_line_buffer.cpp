@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#include <patch/hunk.h>
+#include <patch/line_buffer.h>
+#include <patch/locator.h>
+#include <patch/piece_table.h>
+#include <patch/test.h>
+#include <stdexcept>
+#include <string>
+
+TEST(line_buffer_splits_lines)
+{
+    const Patch::LineBuffer lines("first\nsecond\r\n\nlast");
+    EXPECT_EQ(lines.size(), 4);
+    EXPECT_EQ(lines.content(), "first\nsecond\r\n\nlast");
+
+    EXPECT_EQ(lines[0].content.to_string(), "first");
+    EXPECT_TRUE(lines[0].newline == Patch::NewLine::LF);
+    EXPECT_EQ(lines[1].content.to_string(), "second");
+    EXPECT_TRUE(lines[1].newline == Patch::NewLine::CRLF);
+    EXPECT_EQ(lines[2].content.to_string(), "");
+    EXPECT_TRUE(lines[2].newline == Patch::NewLine::LF);
+    EXPECT_EQ(lines[3].content.to_string(), "last");
+    EXPECT_TRUE(lines[3].newline == Patch::NewLine::None);
+
+    EXPECT_THROW(lines.at(4), std::out_of_range);
+}
+
+TEST(line_buffer_empty)
+{
+    const Patch::LineBuffer lines("");
+    EXPECT_TRUE(lines.empty());
+    EXPECT_EQ(lines.size(), 0);
+
+    const Patch::LineBuffer default_lines;
+    EXPECT_TRUE(default_lines.empty());
+}
+
+TEST(line_buffer_hashes)
+{
+    const Patch::LineBuffer without_hashes("a\nb\n");
+    EXPECT_FALSE(without_hashes.has_hashes());
+
+    const Patch::LineBuffer lines("a\r\nb\na", true);
+    EXPECT_TRUE(lines.has_hashes());
+    EXPECT_EQ(lines.hash(0), Patch::LineBuffer::hash("a"));
+    EXPECT_EQ(lines.hash(1), Patch::LineBuffer::hash("b"));
+    EXPECT_EQ(lines.hash(2), lines.hash(0));
+}
+
+TEST(line_buffer_piece_table)
+{
+    const Patch::LineBuffer lines("1\n2\n3\n");
+    const Patch::Line added("a", Patch::NewLine::CRLF);
+
+    Patch::BasicPieceTable<Patch::LineBuffer> table(lines);
+    std::vector<Patch::BasicPieceTable<Patch::LineBuffer>::Piece> replacement;
+    table.append_added(replacement, added);
+    table.append_original(replacement, 0);
+    table.replace(1, 1, replacement);
+
+    std::string result;
+    table.for_each_line([&result](const Patch::LineView& line) {
+        result += line.content.to_string() + (line.newline == Patch::NewLine::CRLF ? "\r\n" : "\n");
+    });
+    EXPECT_EQ(result, "1\na\r\n1\n3\n");
+}
+
+TEST(line_buffer_locate_hunk)
+{
+    const Patch::LineBuffer with_hashes("1\n2\n3\n4\n5\n6\n", true);
+    const Patch::LineBuffer without_hashes("1\n2\n3\n4\n5\n6\n");
+
+    Patch::Hunk hunk;
+    hunk.lines = {
+        { ' ', "4" },
+        { '-', "5" },
+        { ' ', "6" },
+    };
+
+    hunk.old_file_range.start_line = 1;
+    hunk.old_file_range.number_of_lines = 3;
+    hunk.new_file_range.start_line = 1;
+    hunk.new_file_range.number_of_lines = 2;
+
+    for (const auto* lines : { &with_hashes, &without_hashes }) {
+        auto location = Patch::locate_hunk(*lines, hunk);
+        EXPECT_TRUE(location.is_found());
+        EXPECT_EQ(location.line_number, 3);
+        EXPECT_EQ(location.offset, 3);
+        EXPECT_EQ(location.fuzz, 0);
+    }
+
+    // Lines with different whitespace do not have the same hash, but still match when
+    // whitespace is ignored.
+    hunk.lines[1].line.content = "5 ";
+    EXPECT_FALSE(Patch::locate_hunk(with_hashes, hunk, false, 0, 0).is_found());
+    EXPECT_TRUE(Patch::locate_hunk(with_hashes, hunk, true, 0, 0).is_found());
+}
@@ -403,3 +403,39 @@ TEST(locator_hunk_at_beginning_of_file_is_offset)
     EXPECT_EQ(location.line_number, 2);
     EXPECT_EQ(location.fuzz, 0); // GNU patch seems to get 2 here
 }
+
+TEST(locator_max_offset_limits_search)
+{
+    const std::vector<Patch::Line> file_content = {
+        { "1", Patch::NewLine::LF },
+        { "2", Patch::NewLine::LF },
+        { "3", Patch::NewLine::LF },
+        { "4", Patch::NewLine::LF },
+        { "5", Patch::NewLine::LF },
+        { "6", Patch::NewLine::LF },
+    };
+
+    Patch::Hunk hunk;
+    hunk.lines = {
+        { ' ', "5" },
+        { '-', "6" },
+    };
+
+    hunk.old_file_range.start_line = 1;
+    hunk.old_file_range.number_of_lines = 2;
+    hunk.new_file_range.start_line = 1;
+    hunk.new_file_range.number_of_lines = 1;
+
+    auto location = Patch::locate_hunk(file_content, hunk, false, 0, 0, 4);
+    EXPECT_TRUE(location.is_found());
+    EXPECT_EQ(location.line_number, 4);
+    EXPECT_EQ(location.offset, 4);
+
+    location = Patch::locate_hunk(file_content, hunk, false, 0, 0, 3);
+    EXPECT_FALSE(location.is_found());
+
+    // The limit is from where the hunk is expected once moved by the offset.
+    location = Patch::locate_hunk(file_content, hunk, false, 6, 0, 2);
+    EXPECT_TRUE(location.is_found());
+    EXPECT_EQ(location.offset, -2);
+}
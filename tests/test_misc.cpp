@@ -3,6 +3,7 @@
 
 #include <patch/file.h>
 #include <patch/process.h>
+#include <patch/system.h>
 #include <patch/test.h>
 #include <patch/utils.h>
 
@@ -29,17 +30,244 @@ patch reads a patch file containing a difference (diff) and applies it to files.
     EXPECT_EQ(process.return_code(), 0);
 }
 
-PATCH_TEST(ed_patches_not_supported)
+PATCH_TEST(skip_unchanged_leaves_file_alone_when_every_hunk_fails)
 {
     {
-        Patch::File file("diff.patch", std::ios_base::out);
-        file << "3d\n";
-        file.close();
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "1\nX\n3\n";
+
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << "--- a.txt\n+++ a.txt\n@@ -1,3 +1,3 @@\n 1\n-2\n+two\n 3\n";
+    }
+
+    Process process(patch_path, { patch_path, "--skip-unchanged", "--verbose", "-i", "diff.patch", nullptr });
+
+    EXPECT_TRUE(process.stdout_data().find("1 out of 1 hunk FAILED -- saving rejects to file a.txt.rej\n"
+                                           "Not rewriting file a.txt as its content is unchanged\n")
+        != std::string::npos);
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 1);
+    EXPECT_FILE_EQ("a.txt", "1\nX\n3\n");
+    EXPECT_FALSE(Patch::filesystem::exists("a.txt.orig"));
+    EXPECT_TRUE(Patch::filesystem::exists("a.txt.rej"));
+}
+
+PATCH_TEST(skip_unchanged_still_writes_changed_file)
+{
+    {
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "1\n2\n3\n";
+
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << "--- a.txt\n+++ a.txt\n@@ -1,3 +1,3 @@\n 1\n-2\n+two\n 3\n";
+    }
+
+    Process process(patch_path, { patch_path, "--skip-unchanged", "-i", "diff.patch", nullptr });
+
+    EXPECT_EQ(process.stdout_data(), "patching file a.txt\n");
+    EXPECT_EQ(process.return_code(), 0);
+    EXPECT_FILE_EQ("a.txt", "1\ntwo\n3\n");
+}
+
+static void set_modification_time(const std::string& path, int64_t seconds)
+{
+    Patch::filesystem::FileTime time;
+    time.seconds = seconds;
+    Patch::filesystem::set_modification_time(path, time);
+}
+
+PATCH_TEST(set_utc_sets_time_of_patched_file)
+{
+    {
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "1\n2\n3\n";
+
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << "--- a.txt\t2022-06-26 03:43:50.000000000 +0000\n"
+                 "+++ a.txt\t2022-06-26 04:00:00.250000000 +0000\n"
+                 "@@ -1,3 +1,3 @@\n 1\n-2\n+two\n 3\n";
+    }
+
+    // The file needs to have the time given for it in the patch.
+    set_modification_time("a.txt", 1656215030);
+
+    Process process(patch_path, { patch_path, "-Z", "-i", "diff.patch", nullptr });
+    EXPECT_EQ(process.stdout_data(), "patching file a.txt\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 0);
+    EXPECT_FILE_EQ("a.txt", "1\ntwo\n3\n");
+
+    const auto time = Patch::filesystem::status("a.txt").modification_time;
+    EXPECT_EQ(time.seconds, 1656216000);
+    EXPECT_EQ(time.nanoseconds, 250000000U);
+}
+
+PATCH_TEST(set_utc_time_mismatch)
+{
+    {
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "1\n2\n3\n";
+
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << "--- a.txt\t2022-06-26 03:43:50.000000000 +0000\n"
+                 "+++ a.txt\t2022-06-26 04:00:00.000000000 +0000\n"
+                 "@@ -1,3 +1,3 @@\n 1\n-2\n+two\n 3\n";
+    }
+
+    set_modification_time("a.txt", 1000);
+
+    Process process(patch_path, { patch_path, "-Z", "-i", "diff.patch", nullptr });
+    EXPECT_EQ(process.stdout_data(), "patching file a.txt\nNot setting time of file a.txt (time mismatch)\n");
+    EXPECT_EQ(process.return_code(), 0);
+    EXPECT_FILE_EQ("a.txt", "1\ntwo\n3\n");
+    EXPECT_TRUE(Patch::filesystem::status("a.txt").modification_time.seconds != 1656216000);
+}
+
+PATCH_TEST(git_rename_keeps_content_exactly)
+{
+    {
+        Patch::File file("a.txt", std::ios_base::out | std::ios_base::binary);
+        file << "1\r\n2\n3";
+
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << "diff --git a/a.txt b/dir/b.txt\n"
+                 "similarity index 100%\n"
+                 "rename from a.txt\n"
+                 "rename to dir/b.txt\n";
+    }
+
+    Process process(patch_path, { patch_path, "--newline-output=preserve", "-p1", "-i", "diff.patch", nullptr });
+
+    EXPECT_EQ(process.stdout_data(), "patching file dir/b.txt (renamed from a.txt)\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 0);
+    EXPECT_FALSE(Patch::filesystem::exists("a.txt"));
+    EXPECT_FILE_EQ("dir/b.txt", "1\r\n2\n3");
+}
+
+PATCH_TEST(git_copy_with_new_mode)
+{
+    {
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "1\n2\n3\n";
+
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << "diff --git a/a.txt b/b.txt\n"
+                 "old mode 100644\n"
+                 "new mode 100755\n"
+                 "similarity index 100%\n"
+                 "copy from a.txt\n"
+                 "copy to b.txt\n";
+    }
+
+    Process process(patch_path, { patch_path, "-i", "diff.patch", nullptr });
+
+    EXPECT_EQ(process.stdout_data(), "patching file b.txt (copied from a.txt)\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 0);
+    EXPECT_FILE_EQ("a.txt", "1\n2\n3\n");
+    EXPECT_FILE_EQ("b.txt", "1\n2\n3\n");
+    EXPECT_EQ(Patch::filesystem::get_permissions("b.txt"), static_cast<Patch::filesystem::perms>(0755));
+}
+
+PATCH_TEST(add_file_without_newline_at_end)
+{
+    {
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << "--- /dev/null\n"
+                 "+++ dir/a.txt\n"
+                 "@@ -0,0 +1,2 @@\n"
+                 "+1\n"
+                 "+2\n"
+                 "\\ No newline at end of file\n";
+    }
+
+    Process process(patch_path, { patch_path, "-p0", "-i", "diff.patch", nullptr });
+
+    EXPECT_EQ(process.stdout_data(), "patching file dir/a.txt\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 0);
+    EXPECT_FILE_EQ("dir/a.txt", "1\n2");
+}
+
+PATCH_TEST(delete_file_with_different_newline_at_end)
+{
+    {
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "1\n2\n";
+
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << "--- a.txt\n"
+                 "+++ /dev/null\n"
+                 "@@ -1,2 +0,0 @@\n"
+                 "-1\n"
+                 "-2\n"
+                 "\\ No newline at end of file\n";
+    }
+
+    Process process(patch_path, { patch_path, "-E", "-i", "diff.patch", nullptr });
+
+    EXPECT_EQ(process.stdout_data(), "patching file a.txt\n"
+                                     "Hunk #1 FAILED at 1.\n"
+                                     "1 out of 1 hunk FAILED -- saving rejects to file a.txt.rej\n"
+                                     "Not deleting file a.txt as content differs from patch\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 1);
+    EXPECT_FILE_EQ("a.txt", "1\n2\n");
+}
+
+PATCH_TEST(max_offset_leaves_hunk_too_far_away)
+{
+    {
+        Patch::File file("a.txt", std::ios_base::out);
+        file << "x\nx\nx\n1\n2\n3\n";
+
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << "--- a.txt\n+++ a.txt\n@@ -1,3 +1,3 @@\n 1\n-2\n+two\n 3\n";
+    }
+
+    Process process(patch_path, { patch_path, "--max-offset=2", "-i", "diff.patch", nullptr });
+
+    EXPECT_EQ(process.stdout_data(), "patching file a.txt\n"
+                                     "Hunk #1 FAILED at 1.\n"
+                                     "1 out of 1 hunk FAILED -- saving rejects to file a.txt.rej\n");
+    EXPECT_EQ(process.return_code(), 1);
+    EXPECT_FILE_EQ("a.txt", "x\nx\nx\n1\n2\n3\n");
+
+    Process far_enough(patch_path, { patch_path, "--max-offset=3", "-i", "diff.patch", nullptr });
+
+    EXPECT_EQ(far_enough.stdout_data(), "patching file a.txt\n"
+                                        "Hunk #1 succeeded at 4 (offset 3 lines).\n");
+    EXPECT_EQ(far_enough.return_code(), 0);
+    EXPECT_FILE_EQ("a.txt", "x\nx\nx\n1\ntwo\n3\n");
+}
+
+PATCH_TEST(filter_patches_stdin_to_stdout)
+{
+    {
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << "--- a.txt\n+++ a.txt\n@@ -2,3 +2,3 @@\n 2\n-3\n+three\n 4\n@@ -9,3 +9,2 @@\n 9\n-10\n 11\n";
+    }
+
+    Process process(patch_path, { patch_path, "--filter", "diff.patch", nullptr }, "1\n2\n3\n4\n5\n6\n7\n8\n9\n10\n11\n12\n");
+
+    EXPECT_EQ(process.stdout_data(), "1\n2\nthree\n4\n5\n6\n7\n8\n9\n11\n12\n");
+    EXPECT_EQ(process.stderr_data(), "");
+    EXPECT_EQ(process.return_code(), 0);
+}
+
+PATCH_TEST(filter_reports_failed_hunks)
+{
+    {
+        Patch::File patch("diff.patch", std::ios_base::out);
+        patch << "--- a.txt\n+++ a.txt\n@@ -1,3 +1,3 @@\n 1\n-2\n+two\n 3\n";
     }
 
-    Process process(patch_path, { patch_path, "-i", "diff.patch", "--ed", nullptr });
+    Process process(patch_path, { patch_path, "--filter", "diff.patch", "-r", "out.rej", nullptr }, "1\nX\n3\n");
 
-    EXPECT_TRUE(Patch::starts_with(process.stdout_data(), ""));
-    EXPECT_EQ(process.stderr_data(), std::string(patch_path) + ": **** ed format patches are not supported by this version of patch\n");
-    EXPECT_EQ(process.return_code(), 2);
+    EXPECT_EQ(process.stdout_data(), "1\nX\n3\n");
+    EXPECT_EQ(process.stderr_data(), "Hunk #1 FAILED at 1.\n"
+                                     "1 out of 1 hunk FAILED -- saving rejects to file out.rej\n");
+    EXPECT_EQ(process.return_code(), 1);
+    EXPECT_FILE_EQ("out.rej", "--- a.txt\n+++ a.txt\n@@ -1,3 +1,3 @@\n 1\n-2\n+two\n 3\n");
 }
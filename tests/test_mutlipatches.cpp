@@ -328,3 +328,203 @@ rename to rename
         EXPECT_EQ(patch2.new_file_path, "rename");
     }
 }
+
+TEST(multi_patch_skip_body_of_first_patch)
+{
+    Patch::File patch_file = Patch::File::create_temporary_with_content(R"(
+--- a/main1.cpp	2022-11-06 12:51:37.191776249 +1300
++++ b/main1.cpp	2022-11-06 12:51:51.941802026 +1300
+@@ -1,3 +1,4 @@
+ int main()
+ {
++	return 0;
+ }
+@@ -10,2 +11,1 @@
+-// a comment
+ // another comment
+--- a/main2.cpp	2022-11-06 12:52:24.101146380 +1300
++++ b/main2.cpp	2022-11-06 12:52:36.291771264 +1300
+@@ -1,3 +1,2 @@
+ //
+-// just a main with a comment
+-//
++// just a main with a changed comment
+)");
+
+    Patch::Parser parser(patch_file);
+
+    {
+        Patch::Patch patch;
+        Patch::PatchHeaderInfo info;
+        EXPECT_TRUE(parser.parse_patch_header(patch, info));
+        const auto body = parser.skip_patch_body(patch);
+
+        EXPECT_EQ(patch.old_file_path, "main1.cpp");
+        EXPECT_EQ(patch.hunks.size(), 2);
+        EXPECT_EQ(patch.hunks[0].old_file_range.start_line, 1);
+        EXPECT_EQ(patch.hunks[0].new_file_range.number_of_lines, 4);
+        EXPECT_TRUE(patch.hunks[0].lines.empty());
+        EXPECT_EQ(patch.hunks[1].old_file_range.start_line, 10);
+        EXPECT_TRUE(patch.hunks[1].lines.empty());
+        EXPECT_EQ(parser.line_number(), 12);
+
+        parser.parse_skipped_patch_body(patch, body);
+
+        EXPECT_EQ(patch.hunks.size(), 2);
+        EXPECT_EQ(patch.hunks[0].lines.size(), 4);
+        EXPECT_EQ(patch.hunks[0].lines[2].operation, '+');
+        EXPECT_EQ(patch.hunks[0].lines[2].line.content, "\treturn 0;");
+        EXPECT_EQ(patch.hunks[1].lines.size(), 2);
+        EXPECT_EQ(parser.line_number(), 12);
+    }
+
+    {
+        Patch::Patch patch;
+        Patch::PatchHeaderInfo info;
+        EXPECT_TRUE(parser.parse_patch_header(patch, info));
+        parser.parse_patch_body(patch);
+
+        EXPECT_EQ(patch.old_file_path, "main2.cpp");
+        EXPECT_EQ(patch.hunks.size(), 1);
+
+        const auto& lines = patch.hunks[0].lines;
+        EXPECT_EQ(lines.size(), 4);
+        EXPECT_EQ(lines[1].line.content, "// just a main with a comment");
+        EXPECT_EQ(lines[1].operation, '-');
+        EXPECT_EQ(lines[3].line.content, "// just a main with a changed comment");
+        EXPECT_EQ(lines[3].operation, '+');
+    }
+}
+
+TEST(multi_patch_skip_body_of_context_patch_with_omitted_parts)
+{
+    Patch::File patch_file = Patch::File::create_temporary_with_content(R"(
+*** a/main1.cpp	2022-11-06 12:51:37.191776249 +1300
+--- b/main1.cpp	2022-11-06 12:51:51.941802026 +1300
+***************
+*** 1,2 ****
+- // a comment
+  // another comment
+--- 1 ----
+***************
+*** 10,12 ****
+--- 9,12 ----
+  int main()
+  {
++ 	return 0;
+  }
+diff -c a/main2.cpp b/main2.cpp
+*** a/main2.cpp	2022-11-06 12:52:24.101146380 +1300
+--- b/main2.cpp	2022-11-06 12:52:36.291771264 +1300
+***************
+*** 1 ****
+! // just a main with a comment
+--- 1 ----
+! // just a main with a changed comment
+)");
+
+    Patch::Parser parser(patch_file);
+
+    {
+        Patch::Patch patch;
+        Patch::PatchHeaderInfo info;
+        EXPECT_TRUE(parser.parse_patch_header(patch, info));
+        parser.skip_patch_body(patch);
+
+        EXPECT_EQ(patch.hunks.size(), 2);
+        EXPECT_EQ(patch.hunks[0].old_file_range.start_line, 1);
+        EXPECT_EQ(patch.hunks[0].old_file_range.number_of_lines, 2);
+        EXPECT_EQ(patch.hunks[0].new_file_range.start_line, 1);
+        EXPECT_EQ(patch.hunks[0].new_file_range.number_of_lines, 1);
+        EXPECT_TRUE(patch.hunks[0].lines.empty());
+        EXPECT_EQ(patch.hunks[1].old_file_range.start_line, 10);
+        EXPECT_EQ(patch.hunks[1].old_file_range.number_of_lines, 3);
+        EXPECT_EQ(patch.hunks[1].new_file_range.start_line, 9);
+        EXPECT_EQ(patch.hunks[1].new_file_range.number_of_lines, 4);
+        EXPECT_TRUE(patch.hunks[1].lines.empty());
+    }
+
+    {
+        Patch::Patch patch;
+        Patch::PatchHeaderInfo info;
+        EXPECT_TRUE(parser.parse_patch_header(patch, info));
+        parser.parse_patch_body(patch);
+
+        EXPECT_EQ(patch.old_file_path, "main2.cpp");
+        EXPECT_EQ(patch.hunks.size(), 1);
+        EXPECT_EQ(patch.hunks[0].lines.size(), 2);
+    }
+}
+
+TEST(multi_patch_parse_ahead_same_as_parsing_in_order)
+{
+    // Text between patches, a patch without any hunks and a removed line which looks like the
+    // start of a patch should all be parsed just the same.
+    const std::string content = R"(Some text before the first patch
+diff --git a/a.cpp b/a.cpp
+--- a/a.cpp
++++ b/a.cpp
+@@ -1,3 +1,3 @@
+ int main()
+--- a comment
++// a comment
+ }
+Text after the first patch
+diff --git a/b.cpp b/c.cpp
+similarity index 100%
+rename from b.cpp
+rename to c.cpp
+diff --git a/d.cpp b/d.cpp
+--- a/d.cpp
++++ b/d.cpp
+@@ -1 +1,2 @@
+ int main()
++{
+@@ -10 +11 @@
+-}
++};
+)";
+
+    struct Parsed {
+        std::string path;
+        size_t hunks;
+        size_t lines;
+        size_t line_number;
+    };
+
+    auto parse = [&](bool parse_ahead) {
+        Patch::File patch_file = Patch::File::create_temporary_with_content(content);
+        Patch::Parser parser(patch_file);
+        if (parse_ahead)
+            parser.parse_ahead(Patch::Format::Unknown, 1, 4);
+
+        std::vector<Parsed> parsed;
+        while (!parser.is_eof()) {
+            Patch::Patch patch;
+            Patch::PatchHeaderInfo info;
+            const bool should_parse_body = parser.parse_patch_header(patch, info, 1);
+            if (patch.format == Patch::Format::Unknown)
+                break;
+            if (should_parse_body)
+                parser.parse_patch_body(patch);
+
+            size_t lines = 0;
+            for (const auto& hunk : patch.hunks)
+                lines += hunk.lines.size();
+            parsed.push_back({ patch.new_file_path, patch.hunks.size(), lines, parser.line_number() });
+        }
+        return parsed;
+    };
+
+    const auto in_order = parse(false);
+    const auto ahead = parse(true);
+
+    EXPECT_EQ(in_order.size(), 3);
+    EXPECT_EQ(ahead.size(), in_order.size());
+    for (size_t i = 0; i < in_order.size(); ++i) {
+        EXPECT_EQ(ahead[i].path, in_order[i].path);
+        EXPECT_EQ(ahead[i].hunks, in_order[i].hunks);
+        EXPECT_EQ(ahead[i].lines, in_order[i].lines);
+        EXPECT_EQ(ahead[i].line_number, in_order[i].line_number);
+    }
+}
@@ -5,6 +5,7 @@
 #include <patch/parser.h>
 #include <patch/system.h>
 #include <patch/test.h>
+#include <patch/timestamp.h>
 
 TEST(parser_simple)
 {
@@ -826,3 +827,41 @@ TEST(parser_unified_patch_that_empties_file_is_not_delete)
     EXPECT_EQ(patch.hunks[0].new_file_range.start_line, 0);
     EXPECT_EQ(patch.hunks[0].new_file_range.number_of_lines, 0);
 }
+
+TEST(parser_timestamp_unified_with_utc_offset)
+{
+    Patch::filesystem::FileTime time;
+    EXPECT_TRUE(Patch::parse_timestamp("2022-06-26 15:43:50.743831486 +1200", false, time));
+    EXPECT_EQ(time.seconds, 1656215030);
+    EXPECT_EQ(time.nanoseconds, 743831486U);
+
+    EXPECT_TRUE(Patch::parse_timestamp("1970-01-01 00:00:00.000000000 +0000", false, time));
+    EXPECT_EQ(time.seconds, 0);
+    EXPECT_EQ(time.nanoseconds, 0U);
+}
+
+TEST(parser_timestamp_assumed_utc)
+{
+    Patch::filesystem::FileTime time;
+    EXPECT_TRUE(Patch::parse_timestamp("2022-06-26 03:43:50.5", true, time));
+    EXPECT_EQ(time.seconds, 1656215030);
+    EXPECT_EQ(time.nanoseconds, 500000000U);
+
+    // diff -c traditionally writes times in the format of ctime(3).
+    EXPECT_TRUE(Patch::parse_timestamp("Sun Jun 26 03:43:50 2022", true, time));
+    EXPECT_EQ(time.seconds, 1656215030);
+    EXPECT_EQ(time.nanoseconds, 0U);
+
+    EXPECT_TRUE(Patch::parse_timestamp("Thu Jan  1 00:00:10 1970", true, time));
+    EXPECT_EQ(time.seconds, 10);
+}
+
+TEST(parser_timestamp_invalid)
+{
+    Patch::filesystem::FileTime time;
+    EXPECT_FALSE(Patch::parse_timestamp("", true, time));
+    EXPECT_FALSE(Patch::parse_timestamp("yesterday", true, time));
+    EXPECT_FALSE(Patch::parse_timestamp("2022-13-26 03:43:50", true, time));
+    EXPECT_FALSE(Patch::parse_timestamp("2022-06-26 03:43:50 +12", true, time));
+    EXPECT_FALSE(Patch::parse_timestamp("2022-06-26 03:43:50 trailing", true, time));
+}
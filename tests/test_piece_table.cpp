@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#include <patch/piece_table.h>
+#include <patch/test.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static std::string as_string(const Patch::PieceTable& table)
+{
+    std::string result;
+    table.for_each_line([&result](const Patch::LineView& line) {
+        result += line.content.to_string() + "\n";
+    });
+    return result;
+}
+
+static std::vector<Patch::Line> make_lines(const std::vector<std::string>& contents)
+{
+    std::vector<Patch::Line> lines;
+    for (const auto& content : contents)
+        lines.emplace_back(content, Patch::NewLine::LF);
+    return lines;
+}
+
+TEST(piece_table_unchanged)
+{
+    const auto lines = make_lines({ "1", "2", "3" });
+    Patch::PieceTable table(lines);
+    EXPECT_EQ(table.size(), 3);
+    EXPECT_EQ(as_string(table), "1\n2\n3\n");
+}
+
+TEST(piece_table_replace_in_current_line_numbers)
+{
+    const auto lines = make_lines({ "1", "2", "3", "4" });
+    const auto added = make_lines({ "a", "b" });
+
+    Patch::PieceTable table(lines);
+
+    std::vector<Patch::PieceTable::Piece> replacement;
+    table.append_added(replacement, added[0]);
+    table.append_added(replacement, added[1]);
+    table.replace(1, 1, replacement);
+    EXPECT_EQ(as_string(table), "1\na\nb\n3\n4\n");
+
+    // Line 3 is now the '3' from the original file.
+    replacement.clear();
+    table.append_added(replacement, Patch::Line("three", Patch::NewLine::LF));
+    table.append_original(replacement, 0);
+    table.replace(3, 1, replacement);
+    EXPECT_EQ(as_string(table), "1\na\nb\nthree\n1\n4\n");
+    EXPECT_EQ(table.size(), 6);
+
+    EXPECT_THROW(table.replace(5, 2, {}), std::out_of_range);
+}
+
+TEST(piece_table_edits_applied_in_line_order)
+{
+    const auto lines = make_lines({ "1", "2", "3", "4", "5" });
+    const auto added = make_lines({ "x", "y" });
+
+    Patch::PieceTable table(lines);
+
+    // Edits refer to the original line numbers, whatever order they are given in.
+    std::vector<Patch::PieceTable::Edit> edits(2);
+    edits[0] = { 3, 4, {} };
+    table.append_added(edits[0].replacement, added[1]);
+    edits[1] = { 0, 2, {} };
+    table.append_added(edits[1].replacement, added[0]);
+
+    table.apply(edits);
+    EXPECT_EQ(as_string(table), "x\n3\ny\n5\n");
+}
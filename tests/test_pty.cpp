@@ -290,3 +290,49 @@ Reversed (or previously applied) patch detected!  Assume -R? [n] Apply anyway? [
     EXPECT_FILE_EQ("a", content);
     EXPECT_FILE_EQ("a.rej", patch);
 }
+
+// GNU patch has no --max-offset.
+PATCH_TEST(COMPAT_XFAIL_pty_reversed_patch_answer_yes_with_max_offset)
+{
+    // With a maximum offset, the file is read as it is patched. It needs to be read again
+    // from the start when the patch is applied again once the question has been answered.
+    std::string content;
+    for (int i = 1; i <= 40; ++i)
+        content += (i == 30 ? "thirty" : std::to_string(i)) + "\n";
+
+    {
+        Patch::File file("a", std::ios_base::out);
+        file << content;
+        file.close();
+    }
+
+    {
+        Patch::File file("diff.patch", std::ios_base::out);
+
+        file << R"(
+--- a	2022-09-27 19:32:58.112960376 +1300
++++ b	2022-09-27 19:33:04.088209645 +1300
+@@ -27,7 +27,7 @@
+ 27
+ 28
+ 29
+-30
++thirty
+ 31
+ 32
+ 33
+)";
+        file.close();
+    }
+
+    PtySpawn term(patch_path, { patch_path, "--max-offset", "5", "-i", "diff.patch", nullptr }, "y\n");
+
+    EXPECT_EQ(term.output(), R"(patching file a
+Reversed (or previously applied) patch detected!  Assume -R? [n] )");
+
+    std::string expected;
+    for (int i = 1; i <= 40; ++i)
+        expected += std::to_string(i) + "\n";
+    EXPECT_FILE_EQ("a", expected);
+    EXPECT_EQ(term.return_code(), 0);
+}
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright 2026 Shannon Booth <shannon.ml.booth@gmail.com>
+
+#include <patch/file.h>
+#include <patch/stat_cache.h>
+#include <patch/system.h>
+#include <patch/test.h>
+
+TEST(stat_cache_remembers_status_until_invalidated)
+{
+    Patch::StatCache cache;
+    EXPECT_FALSE(cache.exists("a.txt"));
+
+    Patch::File::touch("a.txt");
+    EXPECT_FALSE(cache.exists("a.txt"));
+
+    cache.invalidate("a.txt");
+    EXPECT_TRUE(cache.exists("a.txt"));
+    EXPECT_TRUE(cache.is_regular_file("a.txt"));
+}
+
+TEST(stat_cache_status_from_open_file)
+{
+    Patch::StatCache cache;
+    EXPECT_FALSE(cache.exists("a.txt"));
+
+    Patch::File file("a.txt", std::ios_base::out);
+    cache.update("a.txt", file.status());
+    EXPECT_TRUE(cache.is_regular_file("a.txt"));
+}
+
+TEST(stat_cache_directories_created_again_after_removal)
+{
+    Patch::StatCache cache;
+    cache.ensure_parent_directories("a/b/c.txt");
+    Patch::File::touch("a/b/c.txt");
+    cache.ensure_parent_directories("a/b/d.txt");
+    Patch::File::touch("a/b/d.txt");
+
+    EXPECT_TRUE(cache.exists("a/b"));
+    cache.remove_file_and_empty_parent_folders("a/b/c.txt");
+    cache.remove_file_and_empty_parent_folders("a/b/d.txt");
+    EXPECT_FALSE(cache.exists("a/b"));
+    EXPECT_FALSE(Patch::filesystem::exists("a"));
+
+    cache.ensure_parent_directories("a/b/c.txt");
+    EXPECT_TRUE(cache.exists("a/b"));
+}